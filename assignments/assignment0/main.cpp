@@ -8,6 +8,7 @@
 #include <ew/transform.h>
 #include <ew/cameraController.h>
 #include <ew/texture.h>
+#include <ew/textureCache.h>
 
 #include <GLFW/glfw3.h>
 #include <imgui.h>
@@ -41,7 +42,7 @@ int main() {
 	ew::Shader shader = ew::Shader("assets/lit.vert", "assets/lit.frag");
 	ew::Model monkeyModel = ew::Model("assets/suzanne.obj");	
 
-	GLuint brickTexture = ew::loadTexture("assets/brick_color.jpg");
+	ew::TextureHandle brickTexture = ew::getTextureCache().acquire("assets/brick_color.jpg");
 
 	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
 	camera.target = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -69,7 +70,7 @@ int main() {
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, brickTexture);
+		glBindTexture(GL_TEXTURE_2D, brickTexture.get());
 		
 		shader.use();
 		//shader.setMat4("_Model", glm::mat4(1.0f));
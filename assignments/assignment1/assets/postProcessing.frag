@@ -3,11 +3,32 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D screenTexture;
+//Everything after lighting in one pass: blur, bloom composite, exposure and tonemapping.
+//Output is linear, the sRGB framebuffer encodes it.
+uniform sampler2D screenTexture; //Linear HDR
 uniform bool useBlur;
 uniform int bluriness;
-uniform bool useGamma;
-uniform float gamma;
+
+uniform sampler2D _Bloom;
+uniform bool _UseBloom;
+uniform float _BloomIntensity;
+uniform float _Exposure;
+uniform int _Tonemapper; //0 = none (clip), 1 = Reinhard, 2 = ACES
+
+//Narkowicz's fit of the ACES filmic curve
+vec3 ACESFilm(vec3 x)
+{
+    return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
+vec3 Tonemap(vec3 color)
+{
+    if(_Tonemapper == 1)
+        return color / (1.0 + color);
+    if(_Tonemapper == 2)
+        return ACESFilm(color);
+    return clamp(color, 0.0, 1.0);
+}
 
 void main()
 {
@@ -29,11 +50,11 @@ void main()
 
         totalColor /= (bluriness * bluriness);
         finalColor = totalColor;
-    }    
-    if(useGamma)
+    }
+    if(_UseBloom)
     {
-        finalColor = pow(finalColor, vec3(1.0 / gamma));
+        finalColor += textureLod(_Bloom, TexCoords, 0.0).rgb * _BloomIntensity;
     }
 
-    FragColor = vec4(finalColor, 1.0);
-}
\ No newline at end of file
+    FragColor = vec4(Tonemap(finalColor * _Exposure), 1.0);
+}
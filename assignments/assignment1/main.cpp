@@ -8,6 +8,9 @@
 #include <ew/transform.h>
 #include <ew/cameraController.h>
 #include <ew/texture.h>
+#include <ew/textureCache.h>
+#include <ew/bloom.h>
+#include <ew/gpuTimer.h>
 
 #include <GLFW/glfw3.h>
 #include <imgui.h>
@@ -38,10 +41,22 @@ struct Material
 }material;
 
 bool useBlur = false;
-bool useGamma = false;
+//Lighting is linear, GL_FRAMEBUFFER_SRGB encodes the post pass output
+bool srgbOutput = true;
 
 int bluriness = 5.0f;
-float gamma = 2.2f;
+
+//HDR scene color is bloomed, then exposed and tonemapped in the post pass
+ew::Bloom* bloom = nullptr;
+const int BLOOM_UNIT = 1;
+bool useBloom = true;
+float bloomIntensity = 0.05f;
+float exposure = 1.0f;
+int tonemapper = 2;
+
+ew::GpuTimer litTimer;
+ew::GpuTimer bloomTimer;
+ew::GpuTimer postTimer; //Fused blur, bloom composite and tonemap
 
 int main() {
 	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight);
@@ -51,7 +66,9 @@ int main() {
 
 	ew::Shader postProcessShader = ew::Shader("assets/frameBufferScreen.vert", "assets/postProcessing.frag");
 
-	GLuint brickTexture = ew::loadTexture("assets/brick_color.jpg");
+	ew::TextureParams brickParams;
+	brickParams.srgbFormat = true;
+	ew::TextureHandle brickTexture = ew::getTextureCache().acquire("assets/brick_color.jpg", brickParams);
 
 	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
 	camera.target = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -89,7 +106,8 @@ int main() {
 	unsigned int texture;
 	glGenTextures(1, &texture);
 	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, screenWidth, screenHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	//Linear HDR color
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, screenWidth, screenHeight, 0, GL_RGBA, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
@@ -108,8 +126,11 @@ int main() {
 
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
+	bloom = new ew::Bloom("assets/bloom.comp", screenWidth, screenHeight);
+
 	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents();
+		glEnable(GL_FRAMEBUFFER_SRGB);
 
 		float time = (float)glfwGetTime();
 		deltaTime = time - prevFrameTime;
@@ -119,13 +140,14 @@ int main() {
 		cameraController.move(window, &camera, deltaTime);
 
 		// First Pass
+		litTimer.begin();
 		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 		glEnable(GL_DEPTH_TEST);
 		glClearColor(0.6f,0.8f,0.92f,1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, brickTexture);
+		glBindTexture(GL_TEXTURE_2D, brickTexture.get());
 		
 		shader.use();
 		//shader.setMat4("_Model", glm::mat4(1.0f));
@@ -141,29 +163,49 @@ int main() {
 
 		monkeyModel.draw();
 
+		litTimer.end();
+
+		bloomTimer.begin();
+		if (useBloom) {
+			bloom->generate(texture);
+		}
+		bloomTimer.end();
+
 		// Second Pass
+		postTimer.begin();
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (!srgbOutput) {
+			glDisable(GL_FRAMEBUFFER_SRGB);
+		}
 		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		postProcessShader.use();
 		postProcessShader.setBool("useBlur", useBlur);
-		postProcessShader.setBool("useGamma", useGamma);
 		postProcessShader.setInt("bluriness", bluriness);
-		postProcessShader.setFloat("gamma", gamma);
+		postProcessShader.setBool("_UseBloom", useBloom);
+		postProcessShader.setFloat("_BloomIntensity", bloomIntensity);
+		postProcessShader.setFloat("_Exposure", exposure);
+		postProcessShader.setInt("_Tonemapper", tonemapper);
+		bloom->bindTexture(postProcessShader, BLOOM_UNIT);
 
 		glBindVertexArray(quadVAO);
 		glDisable(GL_DEPTH_TEST);
+		glActiveTexture(GL_TEXTURE0);
+		postProcessShader.setInt("screenTexture", 0);
 		glBindTexture(GL_TEXTURE_2D, texture);
-		glDrawArrays(GL_TRIANGLES, 0, 6);		
-		
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		postTimer.end();
 
+		//ImGui's colors are already sRGB
+		glDisable(GL_FRAMEBUFFER_SRGB);
 		drawUI();
 
 		glfwSwapBuffers(window);
 	}
 
 	glDeleteFramebuffers(1, &fbo);
+	delete bloom;
 
 	printf("Shutting down...");
 }
@@ -201,8 +243,23 @@ void drawUI() {
 				bluriness++;
 			}
 		}
-		ImGui::Checkbox("Use Gamma Correction", &useGamma);
-		ImGui::SliderFloat("Gamma", &gamma, 0.0f, 10.0f);
+		ImGui::Checkbox("sRGB Output", &srgbOutput);
+		if (!srgbOutput) {
+			ImGui::Text("Writing linear color, the image is too dark");
+		}
+		ImGui::SliderFloat("Exposure", &exposure, 0.1f, 8.0f);
+		const char* tonemapperNames[3] = { "None (clip)", "Reinhard", "ACES" };
+		ImGui::Combo("Tonemapper", &tonemapper, tonemapperNames, 3);
+		ImGui::Checkbox("Bloom", &useBloom);
+		ImGui::SliderFloat("Bloom Intensity", &bloomIntensity, 0.0f, 0.5f);
+		ImGui::SliderFloat("Bloom Threshold", &bloom->threshold, 0.0f, 4.0f);
+		ImGui::SliderFloat("Bloom Knee", &bloom->knee, 0.0f, 1.0f);
+		ImGui::SliderInt("Bloom Levels", &bloom->numLevels, 1, bloom->getNumLevels());
+	}
+	if (ImGui::CollapsingHeader("GPU Timings")) {
+		ImGui::Text("Lit: %.3f ms", litTimer.ms);
+		ImGui::Text("Bloom: %.3f ms", useBloom ? bloomTimer.ms : 0.0f);
+		ImGui::Text("Post: %.3f ms", postTimer.ms);
 	}
 
 	ImGui::End();
@@ -232,6 +289,7 @@ GLFWwindow* initWindow(const char* title, int width, int height) {
 		return nullptr;
 	}
 
+	glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
 	GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
 	if (window == NULL) {
 		printf("GLFW failed to create window");
@@ -8,6 +8,9 @@
 #include <ew/transform.h>
 #include <ew/cameraController.h>
 #include <ew/texture.h>
+#include <ew/textureCache.h>
+#include <ew/bloom.h>
+#include <ew/gpuTimer.h>
 #include <ew/procGen.h>
 
 #include <vd/animation.h>
@@ -45,10 +48,23 @@ struct Material
 }material;
 
 bool useBlur = false;
-bool useGamma = false;
+//Lighting is linear, GL_FRAMEBUFFER_SRGB encodes the post pass output
+bool srgbOutput = true;
 
 int bluriness = 5.0f;
-float gamma = 2.2f;
+
+//HDR scene color is bloomed, then exposed and tonemapped in the post pass
+ew::Bloom* bloom = nullptr;
+const int BLOOM_UNIT = 1;
+bool useBloom = true;
+float bloomIntensity = 0.05f;
+float exposure = 1.0f;
+int tonemapper = 2;
+
+ew::GpuTimer shadowTimer;
+ew::GpuTimer litTimer;
+ew::GpuTimer bloomTimer;
+ew::GpuTimer postTimer; //Fused blur, bloom composite and tonemap
 
 glm::vec3 lightDir = glm::vec3(0.0f, -1.0f, -0.2f);
 float biasValue = 0.03f;
@@ -65,7 +81,9 @@ int main() {
 
 	ew::Model monkeyModel = ew::Model("assets/suzanne.obj");
 
-	GLuint brickTexture = ew::loadTexture("assets/brick_color.jpg");
+	ew::TextureParams brickParams;
+	brickParams.srgbFormat = true;
+	ew::TextureHandle brickTexture = ew::getTextureCache().acquire("assets/brick_color.jpg", brickParams);
 
 	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
 	camera.target = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -118,7 +136,8 @@ int main() {
 	unsigned int texture;
 	glGenTextures(1, &texture);
 	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, screenWidth, screenHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	//Linear HDR color
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, screenWidth, screenHeight, 0, GL_RGBA, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
@@ -139,8 +158,11 @@ int main() {
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	//Outside the shadow map counts as lit instead of repeating shadows from the other side
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
@@ -154,8 +176,11 @@ int main() {
 	}
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+	bloom = new ew::Bloom("assets/bloom.comp", screenWidth, screenHeight);
+
 	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents();
+		glEnable(GL_FRAMEBUFFER_SRGB);
 
 		float time = (float)glfwGetTime();
 		deltaTime = time - prevFrameTime;
@@ -169,6 +194,7 @@ int main() {
 
 		cameraController.move(window, &camera, deltaTime);
 
+		shadowTimer.begin();
 		glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
 		glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
 
@@ -205,8 +231,10 @@ int main() {
 		}
 		
 		glCullFace(GL_BACK);
+		shadowTimer.end();
 
 		// First Pass
+		litTimer.begin();
 		glViewport(0, 0, screenWidth, screenHeight);
 		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 		glEnable(GL_DEPTH_TEST);
@@ -217,7 +245,7 @@ int main() {
 		glBindTexture(GL_TEXTURE_2D, depthMap);
 		
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, brickTexture);
+		glBindTexture(GL_TEXTURE_2D, brickTexture.get());
 		
 		shader.use();
 		shader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());	
@@ -246,30 +274,50 @@ int main() {
 		shader.setMat4("_Model", planeTransform.modelMatrix());
 		plane.draw();
 
+		litTimer.end();
+
+		bloomTimer.begin();
+		if (useBloom) {
+			bloom->generate(texture);
+		}
+		bloomTimer.end();
+
 		// Second Pass
+		postTimer.begin();
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (!srgbOutput) {
+			glDisable(GL_FRAMEBUFFER_SRGB);
+		}
 		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		postProcessShader.use();
 		postProcessShader.setBool("useBlur", useBlur);
-		postProcessShader.setBool("useGamma", useGamma);
 		postProcessShader.setInt("bluriness", bluriness);
-		postProcessShader.setFloat("gamma", gamma);
+		postProcessShader.setBool("_UseBloom", useBloom);
+		postProcessShader.setFloat("_BloomIntensity", bloomIntensity);
+		postProcessShader.setFloat("_Exposure", exposure);
+		postProcessShader.setInt("_Tonemapper", tonemapper);
+		bloom->bindTexture(postProcessShader, BLOOM_UNIT);
 
 		glBindVertexArray(quadVAO);
 		glBindVertexArray(quadVAO);
 		glDisable(GL_DEPTH_TEST);
+		glActiveTexture(GL_TEXTURE0);
+		postProcessShader.setInt("screenTexture", 0);
 		glBindTexture(GL_TEXTURE_2D, texture);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
-		
+		postTimer.end();
 
+		//ImGui's colors are already sRGB
+		glDisable(GL_FRAMEBUFFER_SRGB);
 		drawUI();
 
 		glfwSwapBuffers(window);
 	}
 
 	glDeleteFramebuffers(1, &fbo);
+	delete bloom;
 
 	printf("Shutting down...");
 }
@@ -307,8 +355,24 @@ void drawUI() {
 				bluriness++;
 			}
 		}
-		ImGui::Checkbox("Use Gamma Correction", &useGamma);
-		ImGui::SliderFloat("Gamma", &gamma, 0.0f, 10.0f);
+		ImGui::Checkbox("sRGB Output", &srgbOutput);
+		if (!srgbOutput) {
+			ImGui::Text("Writing linear color, the image is too dark");
+		}
+		ImGui::SliderFloat("Exposure", &exposure, 0.1f, 8.0f);
+		const char* tonemapperNames[3] = { "None (clip)", "Reinhard", "ACES" };
+		ImGui::Combo("Tonemapper", &tonemapper, tonemapperNames, 3);
+		ImGui::Checkbox("Bloom", &useBloom);
+		ImGui::SliderFloat("Bloom Intensity", &bloomIntensity, 0.0f, 0.5f);
+		ImGui::SliderFloat("Bloom Threshold", &bloom->threshold, 0.0f, 4.0f);
+		ImGui::SliderFloat("Bloom Knee", &bloom->knee, 0.0f, 1.0f);
+		ImGui::SliderInt("Bloom Levels", &bloom->numLevels, 1, bloom->getNumLevels());
+	}
+	if (ImGui::CollapsingHeader("GPU Timings")) {
+		ImGui::Text("Shadows: %.3f ms", shadowTimer.ms);
+		ImGui::Text("Lit: %.3f ms", litTimer.ms);
+		ImGui::Text("Bloom: %.3f ms", useBloom ? bloomTimer.ms : 0.0f);
+		ImGui::Text("Post: %.3f ms", postTimer.ms);
 	}
 	if (ImGui::CollapsingHeader("Shadow Settings")) {
 		ImGui::SliderFloat3("Light Direction", &lightDir.x, -1.0f, 1.0f);
@@ -459,6 +523,7 @@ GLFWwindow* initWindow(const char* title, int width, int height) {
 		return nullptr;
 	}
 
+	glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
 	GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
 	if (window == NULL) {
 		printf("GLFW failed to create window");
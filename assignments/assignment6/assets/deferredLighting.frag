@@ -0,0 +1,50 @@
+#version 450
+//Fullscreen lighting pass over the G-buffer, each pixel is lit once however many triangles covered it
+out vec4 FragColor;
+in vec2 TexCoords;
+
+#include "lighting.glsl"
+
+uniform sampler2D _GAlbedo;
+uniform sampler2D _GNormal;
+uniform sampler2D _GMaterial;
+uniform sampler2D _GDepth;
+uniform mat4 _InverseViewProjection;
+uniform int _DebugView = 0; //0 = lit, 1 = albedo, 2 = normal, 3 = material, 4 = depth, 5 = world position
+
+vec3 OctahedralDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
+void main(){
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	vec4 materialData = texelFetch(_GMaterial, pixel, 0);
+	//Nothing was drawn here, keep the clear color
+	if(materialData.a == 0.0)
+		discard;
+	vec4 albedo = texelFetch(_GAlbedo, pixel, 0);
+	vec3 normal = OctahedralDecode(texelFetch(_GNormal, pixel, 0).xy);
+	float depth = texelFetch(_GDepth, pixel, 0).r;
+	vec2 uv = (vec2(pixel) + 0.5) / vec2(textureSize(_GDepth, 0));
+	vec4 worldPos = _InverseViewProjection * vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	worldPos /= worldPos.w;
+
+	if(_DebugView == 1) { FragColor = vec4(albedo.rgb, 1.0); return; }
+	if(_DebugView == 2) { FragColor = vec4(normal * 0.5 + 0.5, 1.0); return; }
+	if(_DebugView == 3) { FragColor = vec4(materialData.rgb, 1.0); return; }
+	if(_DebugView == 4) { FragColor = vec4(vec3(pow(depth, 32.0)), 1.0); return; }
+	if(_DebugView == 5) { FragColor = vec4(fract(worldPos.xyz), 1.0); return; }
+
+	Material material;
+	material.Ka = albedo.a;
+	material.Kd = materialData.r;
+	material.Ks = materialData.g;
+	material.Shininess = exp2(materialData.b * 10.0);
+	int cascade;
+	vec3 lightColor = ShadeSurface(material, worldPos.xyz, normal, cascade);
+	FragColor = vec4(albedo.rgb * lightColor, 1.0);
+}
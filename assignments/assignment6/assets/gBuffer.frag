@@ -0,0 +1,45 @@
+#version 450
+#ifdef GL_ARB_bindless_texture
+#extension GL_ARB_bindless_texture : enable
+#endif
+#ifdef GL_NV_gpu_shader5
+#extension GL_NV_gpu_shader5 : enable
+#endif
+//Writes surface attributes for the deferred lighting pass, see ew::GBuffer for the layout
+layout(location = 0) out vec4 GAlbedo;
+layout(location = 1) out vec2 GNormal;
+layout(location = 2) out vec4 GMaterial;
+in Surface{
+	vec3 WorldPos; //Vertex position in world space
+	vec3 WorldNormal; //Vertex normal in world space
+	vec2 TexCoord;
+	flat int MaterialIndex;
+}fs_in;
+
+struct Material{
+	float Ka; //Ambient coefficient (0-1)
+	float Kd; //Diffuse coefficient (0-1)
+	float Ks; //Specular coefficient (0-1)
+	float Shininess; //Affects size of specular highlight
+};
+uniform Material _Material;
+uniform sampler2D _MainTex;
+
+#include "materials.glsl"
+
+//Folds the unit sphere onto a square, two components with even precision in every direction
+vec2 OctahedralEncode(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 e = n.xy;
+	if(n.z < 0.0)
+		e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return e;
+}
+
+void main(){
+	vec3 albedo = _UseMaterials ? SampleMaterial(fs_in.MaterialIndex, fs_in.TexCoord).rgb : texture(_MainTex, fs_in.TexCoord).rgb;
+	GAlbedo = vec4(albedo, _Material.Ka);
+	GNormal = OctahedralEncode(normalize(fs_in.WorldNormal));
+	GMaterial = vec4(_Material.Kd, _Material.Ks, log2(max(_Material.Shininess, 1.0)) / 10.0, 1.0);
+}
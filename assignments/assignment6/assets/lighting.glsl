@@ -0,0 +1,284 @@
+//Shared by the forward and deferred lit shaders, included after #version.
+//Everything that lights a surface point: cascaded directional shadows, point and spot lights with
+//their shadows, clustered light lists and the Blinn-Phong material.
+uniform sampler2DArrayShadow _ShadowMap; //One layer per cascade, compare mode on
+uniform sampler2DArray _ShadowMoments; //Blurred, mipmapped moments per cascade for VSM/EVSM
+uniform mat4 _CascadeMatrices[4];
+uniform float _CascadeSplits[4]; //View depth each cascade ends at
+uniform int _NumCascades;
+uniform bool _ShowCascades = false;
+uniform vec3 _EyePos;
+uniform vec3 _CameraForward;
+uniform vec3 _LightDirection;
+uniform vec3 _LightColor = vec3(1.0);
+uniform vec3 _AmbientColor = vec3(0.3,0.4,0.46);
+uniform float _BiasValue = 0.005f;
+uniform int _ShadowFilter = 2; //0 = single hardware PCF tap, 1 = 3x3 grid, 2 = rotated Poisson disk, 3 = VSM, 4 = EVSM
+uniform int _ShadowSamples = 16; //Poisson taps, 1-16
+uniform float _ShadowRadius = 1.5; //Poisson disk radius in texels
+uniform vec2 _Exponents; //EVSM positive and negative exponents
+uniform float _MinVariance = 0.00002;
+uniform float _LightBleedReduction = 0.2;
+
+//Point and spot lights, layouts match ew::PointLight and ew::SpotLight
+struct PointLight{
+	vec3 position;
+	float range;
+	vec3 color;
+	int shadowIndex; //Cube in _PointShadowMaps, -1 for no shadow
+};
+struct SpotLight{
+	vec3 position;
+	float range;
+	vec3 direction;
+	float cosOuter;
+	vec3 color;
+	float cosInner;
+	mat4 shadowMatrix;
+	vec4 atlasRect; //Shadow tile in _ShadowAtlas uvs, zero size for no shadow
+};
+layout(std430, binding = 2) readonly buffer PointLights{
+	PointLight _PointLights[];
+};
+layout(std430, binding = 3) readonly buffer SpotLights{
+	SpotLight _SpotLights[];
+};
+//Clustered lighting, point lights are read from per-cluster lists built by binLights.comp
+layout(std430, binding = 4) readonly buffer ClusterGrid{
+	uvec2 _ClusterGrid[]; //Offset into _ClusterIndices, light count
+};
+layout(std430, binding = 5) readonly buffer ClusterIndices{
+	uint _ClusterIndices[];
+};
+uniform bool _UseClusters = false;
+uniform vec3 _ClusterDims; //Tiles across, tiles down, depth slices
+uniform vec2 _ClusterTileSize; //Pixels
+uniform vec2 _ClusterSliceParams; //slice = log(viewDepth) * x + y
+uniform int _NumPointLights = 0;
+uniform int _NumSpotLights = 0;
+uniform samplerCubeArrayShadow _PointShadowMaps; //Distance / range per cube face
+uniform sampler2DShadow _ShadowAtlas; //Spot light shadow tiles
+uniform float _PointShadowBias = 0.01; //Fraction of the light's range
+uniform float _SpotShadowBias = 0.0005;
+
+struct Material{
+	float Ka; //Ambient coefficient (0-1)
+	float Kd; //Diffuse coefficient (0-1)
+	float Ks; //Specular coefficient (0-1)
+	float Shininess; //Affects size of specular highlight
+};
+
+//First cascade whose range contains this fragment, -1 if it's past the shadow distance
+int SelectCascade(vec3 worldPos)
+{
+	float viewDepth = dot(worldPos - _EyePos, _CameraForward);
+	for(int i = 0; i < _NumCascades; i++)
+	{
+		if(viewDepth < _CascadeSplits[i])
+			return i;
+	}
+	return -1;
+}
+
+const vec2 poissonDisk[16] = vec2[](
+	vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+	vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+	vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+	vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+	vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+	vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+	vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+	vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
+//Per pixel rotation so few taps turn into noise instead of banding
+float InterleavedGradientNoise(vec2 pixel)
+{
+	return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
+
+//Upper bound on the fraction of the filter region closer than depth, rescaled to hide light bleeding
+float Chebyshev(vec2 moments, float depth, float minVariance)
+{
+	if(depth <= moments.x)
+		return 1.0;
+	float variance = max(moments.y - moments.x * moments.x, minVariance);
+	float d = depth - moments.x;
+	float pMax = variance / (variance + d * d);
+	return clamp((pMax - _LightBleedReduction) / (1.0 - _LightBleedReduction), 0.0, 1.0);
+}
+
+//Lit fraction from one trilinear fetch of the moments, however wide the blur
+float MomentsLit(vec2 uv, int cascade, float depth)
+{
+	vec4 moments = texture(_ShadowMoments, vec3(uv, cascade));
+	if(_ShadowFilter == 3)
+		return Chebyshev(moments.xy, depth, _MinVariance);
+	//Same warp as shadowMoments.comp, variance is scaled by the warp's slope
+	float warped = depth * 2.0 - 1.0;
+	float pos = exp(_Exponents.x * warped);
+	float neg = -exp(-_Exponents.y * warped);
+	float posLit = Chebyshev(moments.xy, pos, _MinVariance * pow(_Exponents.x * pos, 2.0));
+	float negLit = Chebyshev(moments.zw, neg, _MinVariance * pow(_Exponents.y * neg, 2.0));
+	return min(posLit, negLit);
+}
+
+//Returns how much the fragment is in shadow (0-1). Every PCF fetch compares against 4 texels in hardware.
+float ShadowCalculation(int cascade, vec3 worldPos, vec3 normal)
+{
+	if(cascade < 0)
+		return 0.0;
+	vec4 lightSpacePos = _CascadeMatrices[cascade] * vec4(worldPos, 1.0);
+    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w;
+    projCoords = projCoords * 0.5 + 0.5;
+	if(projCoords.z > 1.0)
+		return 0.0;
+	float bias = max(_BiasValue * (1.0 - dot(normal, _LightDirection)), _BiasValue);
+	float currentDepth = projCoords.z - bias;
+	vec2 texelSize = 1.0 / textureSize(_ShadowMap, 0).xy;
+
+	float lit = 0.0;
+	if(_ShadowFilter >= 3)
+	{
+		//Outside the map counts as lit, like the PCF border
+		if(any(lessThan(projCoords.xy, vec2(0.0))) || any(greaterThan(projCoords.xy, vec2(1.0))))
+			return 0.0;
+		//No depth bias, the minimum variance keeps receivers from shadowing themselves
+		lit = MomentsLit(projCoords.xy, cascade, projCoords.z);
+	}
+	else if(_ShadowFilter == 0)
+	{
+		lit = texture(_ShadowMap, vec4(projCoords.xy, cascade, currentDepth));
+	}
+	else if(_ShadowFilter == 1)
+	{
+		for(int x = -1; x <= 1; ++x)
+		{
+			for(int y = -1; y <= 1; ++y)
+			{
+				lit += texture(_ShadowMap, vec4(projCoords.xy + vec2(x, y) * texelSize, cascade, currentDepth));
+			}
+		}
+		lit /= 9.0;
+	}
+	else
+	{
+		float angle = InterleavedGradientNoise(gl_FragCoord.xy) * 6.28318530718;
+		mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+		int samples = clamp(_ShadowSamples, 1, 16);
+		for(int i = 0; i < samples; i++)
+		{
+			vec2 offset = rotation * poissonDisk[i] * _ShadowRadius * texelSize;
+			lit += texture(_ShadowMap, vec4(projCoords.xy + offset, cascade, currentDepth));
+		}
+		lit /= float(samples);
+	}
+
+	return 1.0 - lit;
+}
+
+//Combination of diffuse and specular reflection for one light
+float BlinnPhong(Material material, vec3 normal, vec3 toLight, vec3 toEye)
+{
+	float diffuseFactor = max(dot(normal,toLight),0.0);
+	//Blinn-phong uses half angle
+	vec3 h = normalize(toLight + toEye);
+	float specularFactor = pow(max(dot(normal,h),0.0),material.Shininess);
+	return material.Kd * diffuseFactor + material.Ks * specularFactor;
+}
+
+//Inverse square falloff windowed to reach zero at the light's range
+float Attenuation(float dist, float range)
+{
+	float window = clamp(1.0 - pow(dist / range, 4.0), 0.0, 1.0);
+	return window * window / (dist * dist + 1.0);
+}
+
+//Lit fraction (0-1) from the light's cube, one hardware PCF fetch
+float PointShadow(PointLight light, vec3 worldPos)
+{
+	if(light.shadowIndex < 0)
+		return 1.0;
+	vec3 fromLight = worldPos - light.position;
+	float depth = length(fromLight) / light.range - _PointShadowBias;
+	return texture(_PointShadowMaps, vec4(fromLight, light.shadowIndex), depth);
+}
+
+//Lit fraction (0-1) from the light's atlas tile
+float SpotShadow(SpotLight light, vec3 worldPos)
+{
+	if(light.atlasRect.z <= 0.0)
+		return 1.0;
+	vec4 lightSpacePos = light.shadowMatrix * vec4(worldPos, 1.0);
+	vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+	if(projCoords.z > 1.0)
+		return 1.0;
+	//Keep the bilinear footprint inside the tile so neighbours don't bleed in
+	vec2 texelSize = 1.0 / textureSize(_ShadowAtlas, 0);
+	vec2 uv = light.atlasRect.xy + projCoords.xy * light.atlasRect.zw;
+	uv = clamp(uv, light.atlasRect.xy + texelSize, light.atlasRect.xy + light.atlasRect.zw - texelSize);
+	return texture(_ShadowAtlas, vec3(uv, projCoords.z - _SpotShadowBias));
+}
+
+//Offset and length of this fragment's list in _ClusterIndices
+uvec2 FindCluster(vec3 worldPos)
+{
+	float viewDepth = dot(worldPos - _EyePos, _CameraForward);
+	int slice = int(log(max(viewDepth, 1e-4)) * _ClusterSliceParams.x + _ClusterSliceParams.y);
+	ivec3 dims = ivec3(_ClusterDims);
+	ivec3 cluster = clamp(ivec3(ivec2(gl_FragCoord.xy / _ClusterTileSize), slice), ivec3(0), dims - 1);
+	return _ClusterGrid[cluster.x + dims.x * (cluster.y + dims.y * cluster.z)];
+}
+
+vec3 PointAndSpotLights(Material material, vec3 worldPos, vec3 normal, vec3 toEye)
+{
+	vec3 result = vec3(0.0);
+	//Only the lights binned into this cluster, otherwise every light
+	uvec2 cluster = _UseClusters ? FindCluster(worldPos) : uvec2(0, _NumPointLights);
+	for(uint c = 0; c < cluster.y; c++)
+	{
+		PointLight light = _PointLights[_UseClusters ? _ClusterIndices[cluster.x + c] : c];
+		vec3 toLight = light.position - worldPos;
+		float dist = length(toLight);
+		if(dist >= light.range)
+			continue;
+		toLight /= dist;
+		result += PointShadow(light, worldPos) * Attenuation(dist, light.range) * BlinnPhong(material, normal, toLight, toEye) * light.color;
+	}
+	for(int i = 0; i < _NumSpotLights; i++)
+	{
+		SpotLight light = _SpotLights[i];
+		vec3 toLight = light.position - worldPos;
+		float dist = length(toLight);
+		if(dist >= light.range)
+			continue;
+		toLight /= dist;
+		float cone = smoothstep(light.cosOuter, light.cosInner, dot(-toLight, light.direction));
+		if(cone <= 0.0)
+			continue;
+		result += SpotShadow(light, worldPos) * cone * Attenuation(dist, light.range) * BlinnPhong(material, normal, toLight, toEye) * light.color;
+	}
+	return result;
+}
+
+//Light reaching a surface point from the directional light, point and spot lights and the ambient term.
+//Cascade is the directional shadow cascade used, -1 past the shadow distance.
+vec3 ShadeSurface(Material material, vec3 worldPos, vec3 normal, out int cascade)
+{
+	//Light pointing straight down
+	vec3 toLight = normalize(-_LightDirection);
+	//Calculate specularly reflected light
+	vec3 toEye = normalize(_EyePos - worldPos);
+	cascade = SelectCascade(worldPos);
+	float shadow = ShadowCalculation(cascade, worldPos, normal);
+	vec3 lightColor = (1.0f - shadow) * BlinnPhong(material, normal, toLight, toEye) * _LightColor;
+	lightColor += PointAndSpotLights(material, worldPos, normal, toEye);
+	lightColor+=_AmbientColor * material.Ka;
+	
+	if(_ShowCascades && cascade >= 0)
+	{
+		const vec3 cascadeColors[4] = vec3[](vec3(1.0,0.4,0.4), vec3(0.4,1.0,0.4), vec3(0.4,0.4,1.0), vec3(1.0,1.0,0.4));
+		lightColor *= cascadeColors[cascade];
+	}
+	return lightColor;
+}
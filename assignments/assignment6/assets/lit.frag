@@ -1,66 +1,29 @@
 #version 450
+#ifdef GL_ARB_bindless_texture
+#extension GL_ARB_bindless_texture : enable
+#endif
+#ifdef GL_NV_gpu_shader5
+#extension GL_NV_gpu_shader5 : enable
+#endif
 out vec4 FragColor; //The color of this fragment
 in Surface{
 	vec3 WorldPos; //Vertex position in world space
 	vec3 WorldNormal; //Vertex normal in world space
 	vec2 TexCoord;
-	vec4 LightSpacePos;
+	flat int MaterialIndex;
 }fs_in;
 
-uniform sampler2D _MainTex;
-uniform sampler2D _ShadowMap;
-uniform vec3 _EyePos;
-uniform vec3 _LightDirection;
-uniform vec3 _LightColor = vec3(1.0);
-uniform vec3 _AmbientColor = vec3(0.3,0.4,0.46);
-uniform float _BiasValue = 0.005f;
+#include "lighting.glsl"
+#include "materials.glsl"
 
-struct Material{
-	float Ka; //Ambient coefficient (0-1)
-	float Kd; //Diffuse coefficient (0-1)
-	float Ks; //Specular coefficient (0-1)
-	float Shininess; //Affects size of specular highlight
-};
+uniform sampler2D _MainTex;
 uniform Material _Material;
 
-float ShadowCalculation(vec4 lightSpacePos)
-{
-    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w;
-    projCoords = projCoords * 0.5 + 0.5;
-	float currentDepth = projCoords.z;
-	float bias = max(_BiasValue * (1.0 - dot(fs_in.WorldNormal, _LightDirection)), _BiasValue);
-
-	float shadow = 0.0;
-	vec2 texelSize = 1.0 / textureSize(_ShadowMap, 0);
-	for(int x = -1; x <= 1; ++x)
-	{
-		for(int y = -1; y <= 1; ++y)
-		{
-			float pcfDepth = texture(_ShadowMap, projCoords.xy + vec2(x, y) * texelSize).r; 
-			shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;        
-		}    
-	}
-	shadow /= 9.0;
-
-	return shadow;
-}
-
 void main(){
 	//Make sure fragment normal is still length 1 after interpolation.
 	vec3 normal = normalize(fs_in.WorldNormal);
-	//Light pointing straight down
-	vec3 toLight = normalize(-_LightDirection);
-	float diffuseFactor = max(dot(normal,toLight),0.0);
-	//Calculate specularly reflected light
-	vec3 toEye = normalize(_EyePos - fs_in.WorldPos);
-	//Blinn-phong uses half angle
-	vec3 h = normalize(toLight + toEye);
-	float specularFactor = pow(max(dot(normal,h),0.0),_Material.Shininess);
-	//Combination of specular and diffuse reflection
-	float shadow = ShadowCalculation(fs_in.LightSpacePos);
-	vec3 lightColor = (1.0f - shadow) * (_Material.Kd * diffuseFactor + _Material.Ks * specularFactor) * _LightColor;
-	lightColor+=_AmbientColor * _Material.Ka;
-	vec3 objectColor = texture(_MainTex,fs_in.TexCoord).rgb;
-	
+	int cascade;
+	vec3 lightColor = ShadeSurface(_Material, fs_in.WorldPos, normal, cascade);
+	vec3 objectColor = _UseMaterials ? SampleMaterial(fs_in.MaterialIndex, fs_in.TexCoord).rgb : texture(_MainTex,fs_in.TexCoord).rgb;
 	FragColor = vec4(objectColor * lightColor,1.0);
-}
\ No newline at end of file
+}
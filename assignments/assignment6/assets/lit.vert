@@ -6,13 +6,16 @@ layout(location = 2) in vec2 vTexCoord;
 
 uniform mat4 _Model; 
 uniform mat4 _ViewProjection;
-uniform mat4 _LightSpaceMatrix;
+uniform int _MaterialIndex;
+
+//Same depth as the pre-pass, which the GL_EQUAL test relies on
+invariant gl_Position;
 
 out Surface{
 	vec3 WorldPos; //Vertex position in world space
 	vec3 WorldNormal; //Vertex normal in world space
 	vec2 TexCoord;
-	vec4 LightSpacePos;
+	flat int MaterialIndex;
 }vs_out;
 
 void main(){
@@ -21,6 +24,6 @@ void main(){
 	//Transform vertex normal to world space using Normal Matrix
 	vs_out.WorldNormal = transpose(inverse(mat3(_Model))) * vNormal;
 	vs_out.TexCoord = vTexCoord;
-	vs_out.LightSpacePos = _LightSpaceMatrix * vec4(vs_out.WorldPos, 1.0);
+	vs_out.MaterialIndex = _MaterialIndex;
 	gl_Position = _ViewProjection * _Model * vec4(vPos,1.0);
 }
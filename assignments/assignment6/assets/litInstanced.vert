@@ -0,0 +1,37 @@
+#version 450
+//Vertex attributes
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNormal;
+layout(location = 2) in vec2 vTexCoord;
+
+//Model matrices of the instances that survived GPU culling
+layout(std430, binding = 1) readonly buffer Visible{
+	mat4 _Visible[];
+};
+//Material index of each visible instance, see ew::GpuCuller::VISIBLE_MATERIAL_BINDING
+layout(std430, binding = 6) readonly buffer VisibleMaterials{
+	uint _VisibleMaterials[];
+};
+
+uniform mat4 _ViewProjection;
+
+//Same depth as the pre-pass, which the GL_EQUAL test relies on
+invariant gl_Position;
+
+out Surface{
+	vec3 WorldPos; //Vertex position in world space
+	vec3 WorldNormal; //Vertex normal in world space
+	vec2 TexCoord;
+	flat int MaterialIndex;
+}vs_out;
+
+void main(){
+	mat4 model = _Visible[gl_InstanceID];
+	//Transform vertex position to World Space.
+	vs_out.WorldPos = vec3(model * vec4(vPos,1.0));
+	//Transform vertex normal to world space using Normal Matrix
+	vs_out.WorldNormal = transpose(inverse(mat3(model))) * vNormal;
+	vs_out.TexCoord = vTexCoord;
+	vs_out.MaterialIndex = int(_VisibleMaterials[gl_InstanceID]);
+	gl_Position = _ViewProjection * model * vec4(vPos,1.0);
+}
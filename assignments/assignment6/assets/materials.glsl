@@ -0,0 +1,36 @@
+//Material textures packed into arrays by ew::MaterialTextures. Shaders including this should enable
+//GL_ARB_bindless_texture and GL_NV_gpu_shader5 at the top when they're defined.
+
+struct MaterialTexture{
+	uvec2 Handle; //Bindless handle of the array
+	uint Array; //Index into _MaterialArrays when not bindless
+	uint Layer;
+};
+layout(std430, binding = 7) readonly buffer Materials{
+	MaterialTexture _Materials[];
+};
+
+//Must match ew::MaterialTextures::MAX_ARRAYS
+const int MAX_MATERIAL_ARRAYS = 4;
+uniform sampler2DArray _MaterialArrays[MAX_MATERIAL_ARRAYS];
+uniform bool _UseBindless;
+uniform bool _UseMaterials; //Otherwise every object samples _MainTex
+
+vec4 SampleMaterial(int material, vec2 uv)
+{
+	MaterialTexture m = _Materials[material];
+	vec3 coord = vec3(uv, float(m.Layer));
+	//Handles differ between instances of one draw, so they're only used where NV_gpu_shader5 allows that
+#if defined(GL_ARB_bindless_texture) && defined(GL_NV_gpu_shader5)
+	if(_UseBindless)
+		return texture(sampler2DArray(m.Handle), coord);
+#endif
+	//Sampler array indices must be dynamically uniform, instances in one draw can use different arrays
+	switch(m.Array)
+	{
+	case 0: return texture(_MaterialArrays[0], coord);
+	case 1: return texture(_MaterialArrays[1], coord);
+	case 2: return texture(_MaterialArrays[2], coord);
+	default: return texture(_MaterialArrays[3], coord);
+	}
+}
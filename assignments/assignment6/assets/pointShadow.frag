@@ -0,0 +1,11 @@
+#version 450
+in vec3 WorldPos;
+
+uniform vec3 _LightPos;
+uniform float _LightRange;
+
+//Linear distance instead of projected depth, so every face and lookup direction compare the same value
+void main()
+{
+	gl_FragDepth = length(WorldPos - _LightPos) / _LightRange;
+}
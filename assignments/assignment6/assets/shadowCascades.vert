@@ -0,0 +1,10 @@
+#version 450
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 _Model;
+
+//World space position, the geometry shader projects it into each cascade
+void main()
+{
+    gl_Position = _Model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 450
+layout (location = 0) in vec3 aPos;
+
+//Model matrices of the instances that survived GPU culling
+layout(std430, binding = 1) readonly buffer Visible{
+	mat4 _Visible[];
+};
+
+//World space position, the geometry shader projects it into each cascade
+void main()
+{
+    gl_Position = _Visible[gl_InstanceID] * vec4(aPos, 1.0);
+}
@@ -4,6 +4,9 @@ layout (location = 0) in vec3 aPos;
 uniform mat4 _LightSpaceMatrix;
 uniform mat4 _Model;
 
+//Also used for the camera depth pre-pass, which must match the lit pass exactly
+invariant gl_Position;
+
 void main()
 {
     gl_Position = _LightSpaceMatrix * _Model * vec4(aPos, 1.0);
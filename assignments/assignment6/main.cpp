@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include <ew/external/glad.h>
@@ -9,10 +10,31 @@
 #include <ew/cameraController.h>
 #include <ew/texture.h>
 #include <ew/procGen.h>
+#include <ew/uploadManager.h>
+#include <ew/gpuCuller.h>
+#include <ew/frustum.h>
+#include <ew/bvh.h>
+#include <ew/cascadedShadowMap.h>
+#include <ew/shadowMoments.h>
+#include <ew/lights.h>
+#include <ew/pointShadowMaps.h>
+#include <ew/shadowAtlas.h>
+#include <ew/lightClusters.h>
+#include <ew/gBuffer.h>
+#include <ew/compressedTexture.h>
+#include <ew/textureCache.h>
+#include <ew/materialTextures.h>
+#include <ew/glExtensions.h>
+#include <ew/bloom.h>
+#include <ew/gpuTimer.h>
+#include <ew/cameraPath.h>
+#include <ew/profiler.h>
 
 #include <vd/animation.h>
 #include <vd/kinematics.h>
 #include <queue>
+#include <algorithm>
+#include <functional>
 
 #include <GLFW/glfw3.h>
 #include <imgui.h>
@@ -25,6 +47,12 @@ GLFWwindow* initWindow(const char* title, int width, int height);
 void drawUI();
 void animationControls();
 void kinematicsControls(vd::Joint* joint);
+void setLitUniforms(const ew::Shader& shader);
+void selectJoint(vd::Joint* joint);
+void updatePointSpotLights(float time);
+void updateLightSweep(float litPassMs);
+std::vector<unsigned char> createPatternTexture(int pattern, const glm::vec3& tint, int size);
+vd::Joint* pickJoint(const ew::Ray& ray, const ew::BVH& bvh, const std::vector<vd::Joint*>& joints, const ew::AABB& localBounds);
 
 
 //Global state
@@ -49,37 +77,188 @@ struct Material
 }material;
 
 bool useBlur = false;
-bool useGamma = false;
+//Color textures are sRGB and lighting happens in a linear RGBA16F buffer. The post pass writes linear color and
+//GL_FRAMEBUFFER_SRGB encodes it, so there is no pow in any shader.
+bool srgbOutput = true;
 
 int bluriness = 5.0f;
-float gamma = 2.2f;
+
+//Camera paths for renderBenchmark, recorded from the free camera and replayable here
+ew::CameraPath cameraPath;
+const float CAMERA_KEY_INTERVAL = 0.25f; //Seconds between recorded keys
+bool recordingPath = false;
+bool playingPath = false;
+float pathStartTime = 0.0f;
+char cameraPathFile[128] = "recorded.path";
+
+//HDR scene color is bloomed, then exposed and tonemapped in the post pass
+ew::Bloom* bloom = nullptr;
+const int BLOOM_UNIT = 1;
+bool useBloom = true;
+float bloomIntensity = 0.05f;
+float exposure = 1.0f;
+int tonemapper = 2;
 
 glm::vec3 lightDir = glm::vec3(0.0f, -1.0f, -0.2f);
 float biasValue = 0.03f;
-
-unsigned int depthMap;
+int shadowFilter = 2;
+int shadowSamples = 12;
+float shadowRadius = 1.5f;
+
+ew::CascadedShadowMap* shadowMap = nullptr;
+ew::ShadowMoments* shadowMoments = nullptr; //VSM/EVSM filters
+bool showCascades = false;
+
+ew::GpuTimer shadowTimer; //Every shadow pass including moments generation
+ew::GpuTimer litTimer; //Light binning and the main lit pass
+ew::GpuTimer prepassTimer;
+ew::GpuTimer bloomTimer;
+ew::GpuTimer postTimer; //Fused blur, bloom composite and tonemap
+char traceFile[128] = "profile.json"; //Chrome trace export from the profiler
+
+//Depth pre-pass, the lit pass then only shades the visible fragment of each pixel
+bool useDepthPrepass = false;
+float forwardMsWithoutPrepass = 0.0f; //Smoothed lit pass time
+float forwardMsWithPrepass = 0.0f; //Smoothed pre-pass + lit pass time
+//The plane is the only static caster, cached until the light, a cascade projection or the plane changes
+bool cacheStaticShadows = true;
+unsigned int staticDrawsSaved = 0; //This frame
+unsigned int totalStaticDrawsSaved = 0;
+unsigned int staticDirtyMask = 0; //Cascades re-rendered into the cache this frame
+
+bool animatePlane = false;
+float waveAmplitude = 0.3f;
+float waveFrequency = 1.5f;
 
 vd::Joint* selJoint = nullptr;
 
+//Mouse picking
+bool prevLeftMouse = false;
+float lastPickMs = 0.0f;
+
+//Point and spot lights. Point lights shadow into cubes, spot lights into atlas tiles sized by screen coverage.
+std::vector<ew::PointLight> pointLights;
+std::vector<ew::SpotLight> spotLights;
+std::vector<ew::AtlasTile> spotTiles; //Per spot light, size 0 without a shadow
+ew::LightBuffer* lightBuffer = nullptr;
+ew::PointShadowMaps* pointShadows = nullptr;
+ew::ShadowAtlas* shadowAtlas = nullptr;
+int numPointLights = 2;
+int numSpotLights = 3;
+float pointSpotIntensity = 4.0f;
+bool animatePointSpotLights = true;
+bool pointSpotShadows = true;
+
+//Clustered forward lighting for the point lights
+ew::LightClusters* lightClusters = nullptr;
+bool useClusteredLighting = true;
+
+//Deferred shading, the geometry pass fills the G-buffer and one fullscreen pass lights it
+ew::GBuffer* gBuffer = nullptr;
+bool useDeferredShading = false;
+int gBufferView = 0; //0 = lit, otherwise the attachment shown
+
+//Brick texture, loaded from the block compressed file cooked at build time when it exists
+ew::TextureHandle brickTexture;
+float brickLoadMs = 0.0f;
+int textureBudgetMB = (int)(ew::TextureCache::DEFAULT_BUDGET / (1024 * 1024));
+
+//Per object textures, joints cycle through them. Arrays are bound once per pass, or not at all with bindless.
+ew::MaterialTextures* materialTextures = nullptr;
+const int MATERIAL_ARRAY_UNIT = 9; //After the G-buffer's units
+bool useMaterialTextures = true;
+bool useBindlessTextures = true;
+//Uncompressed textures decode and mip on CPU threads, the UI can reload copies of the brick image to measure it
+ew::TextureLoadStats textureLoadStats;
+int mipFilter = 0; //ew::MipFilter
+bool gammaCorrectMips = true;
+int mipBenchCopies = 8;
+
+//Light count sweep: each count is timed with and without clusters, then printed as a table
+const int NUM_SWEEP_COUNTS = 6;
+const int SWEEP_COUNTS[NUM_SWEEP_COUNTS] = { 16, 64, 128, 256, 512, 1024 };
+const int SWEEP_WARMUP_FRAMES = 10;
+const int SWEEP_FRAMES = 60;
+struct LightSweep {
+	bool running = false;
+	int step = 0; //Count index * 2, +1 for clustered
+	int frame = 0;
+	float totalMs = 0.0f;
+	float results[NUM_SWEEP_COUNTS][2] = {};
+	unsigned int dropped[NUM_SWEEP_COUNTS] = {}; //Most lights left out of full clusters in one clustered frame
+	bool hasResults = false;
+	int savedNumPointLights = 0;
+	bool savedUseClusters = true;
+}lightSweep;
+
+//GPU culling views
+const int CAMERA_VIEW = 0;
+const int LIGHT_VIEW = 1;
+ew::GpuCuller* culler = nullptr;
+bool useGpuCulling = false;
+bool useOcclusionCulling = true;
+
+//CPU frustum culling, used when GPU culling is off
+bool useCpuCulling = true;
+bool useBvhCulling = true;
+ew::CullStats shadowCullStats;
+ew::CullStats mainCullStats;
+
 int main() {
 	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight);
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
 	ew::Shader shader = ew::Shader("assets/lit.vert", "assets/lit.frag");
-	ew::Shader simpleDepthShader = ew::Shader("assets/simpleDepthShader.vert", "assets/simpleDepthShader.frag");
+	ew::Shader cascadeDepthShader = ew::Shader("assets/shadowCascades.vert", "assets/shadowCascades.geom", "assets/simpleDepthShader.frag");
 	ew::Shader postProcessShader = ew::Shader("assets/frameBufferScreen.vert", "assets/postProcessing.frag");
+	ew::Shader instancedShader = ew::Shader("assets/litInstanced.vert", "assets/lit.frag");
+	ew::Shader instancedDepthShader = ew::Shader("assets/shadowCascadesInstanced.vert", "assets/shadowCascades.geom", "assets/simpleDepthShader.frag");
+	ew::Shader pointShadowShader = ew::Shader("assets/shadowCascades.vert", "assets/pointShadow.geom", "assets/pointShadow.frag");
+	//Spot light shadows and the camera depth pre-pass
+	ew::Shader depthOnlyShader = ew::Shader("assets/simpleDepthShader.vert", "assets/simpleDepthShader.frag");
+	ew::Shader instancedDepthOnlyShader = ew::Shader("assets/litInstanced.vert", "assets/simpleDepthShader.frag");
+	ew::Shader gBufferShader = ew::Shader("assets/lit.vert", "assets/gBuffer.frag");
+	ew::Shader instancedGBufferShader = ew::Shader("assets/litInstanced.vert", "assets/gBuffer.frag");
+	ew::Shader deferredShader = ew::Shader("assets/frameBufferScreen.vert", "assets/deferredLighting.frag");
 
 	ew::Model monkeyModel = ew::Model("assets/suzanne.obj");
 
-	GLuint brickTexture = ew::loadTexture("assets/brick_color.jpg");
+	culler = new ew::GpuCuller("assets/cullInstances.comp", "assets/hiZDownsample.comp");
+	culler->setDrawCommands(monkeyModel.getDrawCommands());
+	std::vector<ew::CullInstance> jointInstances;
+	const ew::BoundingSphere& monkeyBounds = monkeyModel.getBoundingSphere();
+	const glm::vec4 monkeySphere = glm::vec4(monkeyBounds.center, monkeyBounds.radius);
+	ew::SphereBatch jointSpheres;
+	std::vector<unsigned char> shadowVisible;
+	std::vector<unsigned char> mainVisible;
+	//Joints only move, so the tree is refit every frame and rebuilt when the hierarchy changes.
+	//Used for both culling and picking.
+	std::vector<vd::Joint*> jointList;
+	ew::BVH jointBvh;
+	std::vector<ew::AABB> jointBounds;
+	std::vector<unsigned int> bvhResults[2];
+	std::vector<unsigned int> spotCasters;
+
+	{
+		double loadStart = glfwGetTime();
+		ew::TextureParams brickParams;
+		brickParams.srgbFormat = true;
+		brickTexture = ew::getTextureCache().acquire("assets/brick_color.ewtx", brickParams);
+		if (!brickTexture.isValid()) {
+			printf("assets/brick_color.ewtx not found, loading the uncompressed image\n");
+			brickTexture = ew::getTextureCache().acquire("assets/brick_color.jpg", brickParams);
+		}
+		brickLoadMs = (float)((glfwGetTime() - loadStart) * 1000.0);
+	}
 
 	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
 	camera.target = glm::vec3(0.0f, 0.0f, 0.0f);
 	camera.aspectRatio = (float)screenWidth / screenHeight;
 	camera.fov = 60.0f;
 
-	ew::MeshData planeMeshData = ew::createPlane(10.0f, 10.0f, 1);
-	ew::Mesh plane(planeMeshData);
+	ew::MeshData planeMeshData = ew::createPlane(10.0f, 10.0f, 64);
+	ew::Mesh plane(planeMeshData, ew::MeshUsage::DYNAMIC);
+	bool planeWasAnimated = false;
 	ew::Transform planeTransform;
 	planeTransform.position = glm::vec3(0.0f, -5.0f, 0.0f);
 
@@ -220,185 +399,677 @@ int main() {
 	glGenFramebuffers(1, &fbo);
 	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
+	//The scene target keeps its startup size, every pass that renders into or reads it uses this size, not the window's
+	int sceneWidth = screenWidth, sceneHeight = screenHeight;
 	unsigned int texture;
 	glGenTextures(1, &texture);
 	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, screenWidth, screenHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	//Linear HDR color, 8 bits per channel bands in dark gradients once values are linear
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, sceneWidth, sceneHeight, 0, GL_RGBA, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
 
-	unsigned int rbo;
-	glGenRenderbuffers(1, &rbo);
-	glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, screenWidth, screenHeight);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
-
-	unsigned int depthMapFBO;
-	glGenFramebuffers(1, &depthMapFBO);
-
-	const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-
-	glGenTextures(1, &depthMap);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	//Depth is a texture so the Hi-Z pyramid can be built from it
+	unsigned int sceneDepth;
+	glGenTextures(1, &sceneDepth);
+	glBindTexture(GL_TEXTURE_2D, sceneDepth);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, sceneWidth, sceneHeight);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, sceneDepth, 0);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+
+	shadowMap = new ew::CascadedShadowMap(2048, 4);
+	shadowMoments = new ew::ShadowMoments("assets/shadowMoments.comp");
+	lightBuffer = new ew::LightBuffer();
+	pointShadows = new ew::PointShadowMaps(512, 4);
+	shadowAtlas = new ew::ShadowAtlas(4096, 128, 1024);
+	lightClusters = new ew::LightClusters("assets/binLights.comp");
+	gBuffer = new ew::GBuffer(sceneWidth, sceneHeight);
+	bloom = new ew::Bloom("assets/bloom.comp", sceneWidth, sceneHeight);
+
+	//Brick at 1024 in one array, the patterns at 256 in another
+	materialTextures = new ew::MaterialTextures();
+	materialTextures->addTexture("assets/brick_color.jpg");
+	const glm::vec3 patternTints[4] = { glm::vec3(0.9f, 0.3f, 0.3f), glm::vec3(0.3f, 0.8f, 0.4f), glm::vec3(0.3f, 0.5f, 0.9f), glm::vec3(0.9f, 0.8f, 0.3f) };
+	for (int i = 0; i < 4; i++)
 	{
-		printf("It's so Joever!\n");
+		std::vector<unsigned char> pattern = createPatternTexture(i, patternTints[i], 256);
+		materialTextures->addTexture(pattern.data(), 256, 256);
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	ew::loadBindlessTexture(glfwGetProcAddress);
+	materialTextures->build();
 
 	while (!glfwWindowShouldClose(window)) {
+		ew::getProfiler().beginFrame();
 		glfwPollEvents();
+		ew::getUploadManager().beginFrame();
+		ew::getTextureCache().update();
+		//Only sRGB attachments are affected, the G-buffer albedo is encoded on write
+		glEnable(GL_FRAMEBUFFER_SRGB);
 
 		float time = (float)glfwGetTime();
 		deltaTime = time - prevFrameTime;
 		prevFrameTime = time;
 
 		//monkeyTransform.rotation = glm::rotate(monkeyTransform.rotation, deltaTime, glm::vec3(0.0f, 1.0f, 0.0f));
-		animator.Update(deltaTime);
-		monkeyTransform.position = animator.GetValue(animator.clip->positionKeys, glm::vec3(0.0f, 0.0f, 0.0f));
-		monkeyTransform.rotation = animator.GetValue(animator.clip->rotationKeys, glm::vec3(0.0f, 0.0f, 0.0f)) / 180.0f * 3.14159265358979323846f;
-		monkeyTransform.scale = animator.GetValue(animator.clip->scaleKeys, glm::vec3(1.0f));
+		{
+			EW_PROFILE_SCOPE("Animation update");
+			animator.Update(deltaTime);
+			monkeyTransform.position = animator.GetValue(animator.clip->positionKeys, glm::vec3(0.0f, 0.0f, 0.0f));
+			monkeyTransform.rotation = animator.GetValue(animator.clip->rotationKeys, glm::vec3(0.0f, 0.0f, 0.0f)) / 180.0f * 3.14159265358979323846f;
+			monkeyTransform.scale = animator.GetValue(animator.clip->scaleKeys, glm::vec3(1.0f));
+		}
 
 		cameraController.move(window, &camera, deltaTime);
+		if (recordingPath && (cameraPath.getKeys().empty() || time - pathStartTime >= cameraPath.getDuration() + CAMERA_KEY_INTERVAL)) {
+			cameraPath.addKey(time - pathStartTime, camera.position, camera.target);
+		}
+		if (playingPath) {
+			cameraPath.sample(time - pathStartTime, camera);
+			playingPath = time - pathStartTime < cameraPath.getDuration();
+		}
+
+		//Deform the plane in place, one last time with zero amplitude when turned off
+		if (animatePlane || planeWasAnimated) {
+			float amplitude = animatePlane ? waveAmplitude : 0.0f;
+			for (size_t i = 0; i < planeMeshData.vertices.size(); i++)
+			{
+				ew::Vertex& v = planeMeshData.vertices[i];
+				float phase = waveFrequency * (v.pos.x + v.pos.z) + time * 2.0f;
+				v.pos.y = amplitude * sinf(phase);
+				float slope = amplitude * waveFrequency * cosf(phase);
+				v.normal = glm::normalize(glm::vec3(-slope, 1.0f, -slope));
+			}
+			plane.updateVertices(planeMeshData.vertices);
+			planeWasAnimated = animatePlane;
+			shadowMap->invalidateStatic();
+		}
 
 		//fk updates
-		vd::SolveFK(&root);
+		{
+			EW_PROFILE_SCOPE("FK solve");
+			vd::SolveFK(&root);
+		}
+
+		//One cull instance per joint
+		jointInstances.clear();
+		jointList.clear();
+		{
+			std::queue<vd::Joint*> fkQueue;
+			fkQueue.push(&root);
+			while (!fkQueue.empty())
+			{
+				unsigned int material = (unsigned int)(jointInstances.size() % materialTextures->getNumMaterials());
+				jointInstances.push_back({ fkQueue.front()->m_globalPose, monkeySphere, material });
+				jointList.push_back(fkQueue.front());
+				for (vd::Joint* child : fkQueue.front()->m_children)
+				{
+					fkQueue.push(child);
+				}
+				fkQueue.pop();
+			}
+		}
+		jointBounds.resize(jointInstances.size());
+		for (size_t i = 0; i < jointInstances.size(); i++)
+		{
+			jointBounds[i] = monkeyModel.getBounds().transformed(jointInstances[i].model);
+		}
+		if (jointBvh.getNumObjects() != jointBounds.size()) {
+			jointBvh.build(jointBounds);
+		}
+		else {
+			jointBvh.refit(jointBounds);
+		}
+
+		//Left click selects the joint under the cursor, unless ImGui is using the mouse
+		bool leftMouse = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_1) == GLFW_PRESS;
+		if (leftMouse && !prevLeftMouse && !ImGui::GetIO().WantCaptureMouse) {
+			double mouseX, mouseY;
+			int windowWidth, windowHeight;
+			glfwGetCursorPos(window, &mouseX, &mouseY);
+			glfwGetWindowSize(window, &windowWidth, &windowHeight);
+			double pickStart = glfwGetTime();
+			ew::Ray ray = camera.screenPointToRay((float)mouseX, (float)mouseY, (float)windowWidth, (float)windowHeight);
+			vd::Joint* picked = pickJoint(ray, jointBvh, jointList, monkeyModel.getBounds());
+			if (picked != nullptr) {
+				selectJoint(picked);
+			}
+			lastPickMs = (float)((glfwGetTime() - pickStart) * 1000.0);
+		}
+		prevLeftMouse = leftMouse;
+
 
+		//Fit cascades to the camera, casters are culled against the light volume covering all of them
+		shadowMap->update(camera, lightDir);
+		glm::mat4 shadowCullMatrix = shadowMap->getCullMatrix();
+		glm::mat4 viewProjection = camera.projectionMatrix() * camera.viewMatrix();
 
-		glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-		glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+		if (useGpuCulling) {
+			culler->setInstances(jointInstances);
+			culler->cull(LIGHT_VIEW, shadowCullMatrix, false);
+			culler->cull(CAMERA_VIEW, viewProjection, useOcclusionCulling);
+		}
 
-		float near_plane = -15.0f, far_plane = 15.0f;
-		glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
-		glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f),
-			lightDir,
-			glm::vec3(0.0f, 1.0f, 0.0f));
-		glm::mat4 lightSpaceMatrix = lightProjection * lightView;
+		//Test every joint's world sphere against the light and camera frustums
+		bool planeInShadow = true;
+		bool planeInView = true;
+		shadowCullStats = ew::CullStats();
+		mainCullStats = ew::CullStats();
+		if (!useGpuCulling) {
+			jointSpheres.clear();
+			for (size_t i = 0; i < jointInstances.size(); i++)
+			{
+				jointSpheres.push(monkeyBounds.transformed(jointInstances[i].model));
+			}
+			if (useCpuCulling) {
+				ew::Frustum lightFrustum = ew::extractFrustum(shadowCullMatrix);
+				ew::Frustum cameraFrustum = ew::extractFrustum(viewProjection);
+				if (useBvhCulling) {
+					ew::Frustum frustums[2] = { lightFrustum, cameraFrustum };
+					jointBvh.queryFrustums(frustums, 2, bvhResults);
+					shadowVisible.assign(jointInstances.size(), 0);
+					mainVisible.assign(jointInstances.size(), 0);
+					for (size_t i = 0; i < bvhResults[0].size(); i++)
+					{
+						shadowVisible[bvhResults[0][i]] = 1;
+					}
+					for (size_t i = 0; i < bvhResults[1].size(); i++)
+					{
+						mainVisible[bvhResults[1][i]] = 1;
+					}
+					shadowCullStats.drawn = bvhResults[0].size();
+					mainCullStats.drawn = bvhResults[1].size();
+				}
+				else {
+					shadowCullStats.drawn = ew::cullSpheres(lightFrustum, jointSpheres, shadowVisible);
+					mainCullStats.drawn = ew::cullSpheres(cameraFrustum, jointSpheres, mainVisible);
+				}
 
+				ew::AABB planeBounds = plane.getBounds().transformed(planeTransform.modelMatrix());
+				planeInShadow = ew::isVisible(lightFrustum, planeBounds);
+				planeInView = ew::isVisible(cameraFrustum, planeBounds);
+			}
+			else {
+				shadowVisible.assign(jointSpheres.size(), 1);
+				mainVisible.assign(jointSpheres.size(), 1);
+				shadowCullStats.drawn = jointSpheres.size();
+				mainCullStats.drawn = jointSpheres.size();
+			}
+			shadowCullStats.drawn += planeInShadow ? 1 : 0;
+			mainCullStats.drawn += planeInView ? 1 : 0;
+			shadowCullStats.culled = jointSpheres.size() + 1 - shadowCullStats.drawn;
+			mainCullStats.culled = jointSpheres.size() + 1 - mainCullStats.drawn;
+		}
 		
+		shadowTimer.begin();
+		ew::GpuProfileScope shadowScope("Shadow pass");
 		{//configure shader and matrices
-			simpleDepthShader.use();
-			glClear(GL_DEPTH_BUFFER_BIT);
+			cascadeDepthShader.use();
 			glEnable(GL_DEPTH_TEST);
 
 			glEnable(GL_CULL_FACE);//to avoid peter panning
 			glCullFace(GL_FRONT);
+		}
 
-			simpleDepthShader.setMat4("_LightSpaceMatrix", lightSpaceMatrix);
+		{//render static depth into the cache, only for cascades whose projection changed
+			staticDrawsSaved = 0;
+			if (cacheStaticShadows) {
+				staticDirtyMask = shadowMap->getStaticDirtyMask();
+				if (shadowMap->beginStaticRender()) {
+					shadowMap->setRenderUniforms(cascadeDepthShader);
+					cascadeDepthShader.setMat4("_Model", planeTransform.modelMatrix());
+					plane.draw();
+				}
+				else {
+					staticDrawsSaved = 1;
+				}
+				totalStaticDrawsSaved += staticDrawsSaved;
+				shadowMap->beginDynamicRender();
+			}
+			else {
+				shadowMap->beginRender();
+			}
+			shadowMap->setRenderUniforms(cascadeDepthShader);
 		}
 
-		{//render depth
-			/*simpleDepthShader.setMat4("_Model", monkeyTransform.modelMatrix());
+		{//render dynamic depth, every cascade in one pass
+			/*cascadeDepthShader.setMat4("_Model", monkeyTransform.modelMatrix());
 			monkeyModel.draw();*/
 
-			std::queue<vd::Joint*> fkQueue;
-			fkQueue.push(&root);
+			if (useGpuCulling) {
+				instancedDepthShader.use();
+				shadowMap->setRenderUniforms(instancedDepthShader);
+				culler->draw(LIGHT_VIEW);
+				cascadeDepthShader.use();
+			}
+			else {
+				for (size_t i = 0; i < jointInstances.size(); i++)
+				{
+					if (!shadowVisible[i]) {
+						continue;
+					}
+					cascadeDepthShader.setMat4("_Model", jointInstances[i].model);
+					monkeyModel.draw();
+				}
+			}
+			
+			if (planeInShadow && !cacheStaticShadows) {
+				cascadeDepthShader.setMat4("_Model", planeTransform.modelMatrix());
+				plane.draw();
+			}
+		}
+		
+		//Point and spot light shadows, casters culled against each light's volume
+		if (lightSweep.running) {
+			numPointLights = SWEEP_COUNTS[lightSweep.step / 2];
+			useClusteredLighting = lightSweep.step % 2 == 1;
+		}
+		updatePointSpotLights(time);
+		if (pointSpotShadows) {
+			ew::AABB planeBounds = plane.getBounds().transformed(planeTransform.modelMatrix());
 
-			while (!fkQueue.empty())
+			//Closest looking point lights get the cubes
+			std::vector<std::pair<float, int>> pointOrder;
+			for (size_t i = 0; i < pointLights.size(); i++)
 			{
-				simpleDepthShader.setMat4("_Model", fkQueue.front()->m_globalPose);
-				monkeyModel.draw();
+				pointOrder.push_back({ ew::screenCoverage(camera, pointLights[i].position, pointLights[i].range), (int)i });
+			}
+			std::sort(pointOrder.begin(), pointOrder.end(), std::greater<std::pair<float, int>>());
+			pointShadows->beginRender();
+			pointShadowShader.use();
+			for (int i = 0; i < (int)pointOrder.size() && i < pointShadows->getMaxLights(); i++)
+			{
+				ew::PointLight& light = pointLights[pointOrder[i].second];
+				light.shadowIndex = i;
+				pointShadows->setRenderUniforms(pointShadowShader, light);
+				ew::BoundingSphere lightSphere = { light.position, light.range };
+				for (size_t j = 0; j < jointBounds.size(); j++)
+				{
+					if (!ew::intersects(jointBounds[j], lightSphere)) {
+						continue;
+					}
+					pointShadowShader.setMat4("_Model", jointInstances[j].model);
+					monkeyModel.draw();
+				}
+				if (ew::intersects(planeBounds, lightSphere)) {
+					pointShadowShader.setMat4("_Model", planeTransform.modelMatrix());
+					plane.draw();
+				}
+			}
 
-				for (vd::Joint* child : fkQueue.front()->m_children)
+			//Largest tiles first so the atlas never fragments, lights that don't fit get smaller tiles or none
+			std::vector<std::pair<float, int>> spotOrder;
+			for (size_t i = 0; i < spotLights.size(); i++)
+			{
+				spotOrder.push_back({ ew::screenCoverage(camera, spotLights[i].position, spotLights[i].range), (int)i });
+			}
+			std::sort(spotOrder.begin(), spotOrder.end(), std::greater<std::pair<float, int>>());
+			shadowAtlas->reset();
+			shadowAtlas->beginRender();
+			depthOnlyShader.use();
+			for (size_t i = 0; i < spotOrder.size(); i++)
+			{
+				int index = spotOrder[i].second;
+				ew::SpotLight& light = spotLights[index];
+				ew::AtlasTile& tile = spotTiles[index];
+				if (!shadowAtlas->allocateAtMost(shadowAtlas->tileSizeForCoverage(spotOrder[i].first), &tile)) {
+					continue;
+				}
+				light.shadowMatrix = ew::spotLightMatrix(light);
+				light.atlasRect = shadowAtlas->getTileRect(tile);
+				shadowAtlas->beginTile(tile);
+				depthOnlyShader.setMat4("_LightSpaceMatrix", light.shadowMatrix);
+				ew::Frustum spotFrustum = ew::extractFrustum(light.shadowMatrix);
+				jointBvh.queryFrustum(spotFrustum, spotCasters);
+				for (size_t j = 0; j < spotCasters.size(); j++)
 				{
-					fkQueue.push(child);
+					depthOnlyShader.setMat4("_Model", jointInstances[spotCasters[j]].model);
+					monkeyModel.draw();
+				}
+				if (ew::isVisible(spotFrustum, planeBounds)) {
+					depthOnlyShader.setMat4("_Model", planeTransform.modelMatrix());
+					plane.draw();
 				}
-				fkQueue.pop();
 			}
-			
-			simpleDepthShader.setMat4("_Model", planeTransform.modelMatrix());
-			plane.draw();
 		}
-		
+		lightBuffer->upload(pointLights, spotLights);
+
 		glCullFace(GL_BACK);
 
-		// First Pass
-		glViewport(0, 0, screenWidth, screenHeight);
-		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		//Moments for the VSM/EVSM filters, the PCF filters read depth directly
+		if (shadowFilter >= 3) {
+			shadowMoments->setFormat(shadowFilter == 3 ? ew::MomentFormat::VSM : ew::MomentFormat::EVSM);
+			shadowMoments->generate(*shadowMap);
+		}
+		shadowScope.end();
+		shadowTimer.end();
+
+		//Depth only pass so the lit pass can test GL_EQUAL and shade each pixel once. Deferred already does.
+		bool depthPrepass = useDepthPrepass && !useDeferredShading;
+		if (depthPrepass) {
+			prepassTimer.begin();
+			EW_PROFILE_GPU_SCOPE("Depth pre-pass");
+			glViewport(0, 0, sceneWidth, sceneHeight);
+			glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+			glClearColor(0.6f, 0.8f, 0.92f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glEnable(GL_DEPTH_TEST);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			if (useGpuCulling) {
+				instancedDepthOnlyShader.use();
+				instancedDepthOnlyShader.setMat4("_ViewProjection", viewProjection);
+				culler->draw(CAMERA_VIEW);
+			}
+			depthOnlyShader.use();
+			depthOnlyShader.setMat4("_LightSpaceMatrix", viewProjection);
+			if (!useGpuCulling) {
+				for (size_t i = 0; i < jointInstances.size(); i++)
+				{
+					if (!mainVisible[i]) {
+						continue;
+					}
+					depthOnlyShader.setMat4("_Model", jointInstances[i].model);
+					monkeyModel.draw();
+				}
+			}
+			if (planeInView) {
+				depthOnlyShader.setMat4("_Model", planeTransform.modelMatrix());
+				plane.draw();
+			}
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			prepassTimer.end();
+		}
+
+		litTimer.begin();
+		ew::GpuProfileScope litScope("Lit pass");
+		if (useClusteredLighting) {
+			lightClusters->build(camera, *lightBuffer, sceneWidth, sceneHeight);
+		}
+
+		// First Pass, lit directly or written to the G-buffer
+		const ew::Shader& sceneShader = useDeferredShading ? gBufferShader : shader;
+		const ew::Shader& instancedSceneShader = useDeferredShading ? instancedGBufferShader : instancedShader;
+		if (useDeferredShading) {
+			gBuffer->beginGeometryPass();
+		}
+		else if (depthPrepass) {
+			glViewport(0, 0, sceneWidth, sceneHeight);
+			glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
+		else {
+			glViewport(0, 0, sceneWidth, sceneHeight);
+			glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+			glClearColor(0.6f,0.8f,0.92f,1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
 		glEnable(GL_DEPTH_TEST);
-		glClearColor(0.6f,0.8f,0.92f,1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, depthMap);
 		
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, brickTexture);
+		glBindTexture(GL_TEXTURE_2D, brickTexture.get());
 		
-		shader.use();
-		shader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());	
-		shader.setInt("_MainTex", 0);
-		shader.setInt("_ShadowMap", 1);
-		shader.setVec3("_EyePos", camera.position);
-		shader.setMat4("_LightSpaceMatrix", lightSpaceMatrix);
-
-		shader.setFloat("_Material.Ka", material.Ka);
-		shader.setFloat("_Material.Kd", material.Kd);
-		shader.setFloat("_Material.Ks", material.Ks);
-		shader.setFloat("_Material.Shininess", material.Shininess);
+		if (useGpuCulling) {
+			instancedSceneShader.use();
+			setLitUniforms(instancedSceneShader);
+			culler->draw(CAMERA_VIEW);
+		}
 
-		shader.setVec3("_LightDirection", lightDir);
-		shader.setFloat("_BiasValue", biasValue);
+		sceneShader.use();
+		setLitUniforms(sceneShader);
 
-		std::queue<vd::Joint*> fkQueue;
-		fkQueue.push(&root);
+		if (!useGpuCulling) {
+			for (size_t i = 0; i < jointInstances.size(); i++)
+			{
+				if (!mainVisible[i]) {
+					continue;
+				}
+				sceneShader.setMat4("_Model", jointInstances[i].model);
+				sceneShader.setInt("_MaterialIndex", jointInstances[i].material);
+				monkeyModel.draw();
+			}
+		}
 
-		while (!fkQueue.empty())
-		{
-			shader.setMat4("_Model", fkQueue.front()->m_globalPose);
-			monkeyModel.draw();
+		if (planeInView) {
+			sceneShader.setMat4("_Model", planeTransform.modelMatrix());
+			sceneShader.setInt("_MaterialIndex", 0);
+			plane.draw();
+		}
 
-			for (vd::Joint* child : fkQueue.front()->m_children)
-			{
-				fkQueue.push(child);
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+
+		//Lighting pass, every covered pixel is lit once
+		if (useDeferredShading) {
+			//Scene depth is still needed for the Hi-Z pyramid
+			gBuffer->blitDepth(fbo);
+			glViewport(0, 0, sceneWidth, sceneHeight);
+			glClearColor(0.6f, 0.8f, 0.92f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glDisable(GL_DEPTH_TEST);
+			deferredShader.use();
+			setLitUniforms(deferredShader);
+			gBuffer->bindTextures(deferredShader, 5);
+			deferredShader.setMat4("_InverseViewProjection", glm::inverse(viewProjection));
+			deferredShader.setInt("_DebugView", gBufferView);
+			glBindVertexArray(quadVAO);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+			glEnable(GL_DEPTH_TEST);
+		}
+		litScope.end();
+		litTimer.end();
+		//Timers lag a frame, so a few frames after switching are mixed in, the smoothing hides them
+		if (!useDeferredShading) {
+			if (depthPrepass) {
+				forwardMsWithPrepass = glm::mix(forwardMsWithPrepass, prepassTimer.ms + litTimer.ms, 0.05f);
 			}
-			fkQueue.pop();
+			else {
+				forwardMsWithoutPrepass = glm::mix(forwardMsWithoutPrepass, litTimer.ms, 0.05f);
+			}
+		}
+		if (lightSweep.running) {
+			updateLightSweep(litTimer.ms);
+		}
+
+		//Depth pyramid for next frame's occlusion test
+		if (useGpuCulling && useOcclusionCulling) {
+			culler->buildHiZ(sceneDepth, sceneWidth, sceneHeight, viewProjection);
+		}
+		else {
+			culler->invalidateHiZ();
 		}
 
-		shader.setMat4("_Model", planeTransform.modelMatrix());
-		plane.draw();
+		bloomTimer.begin();
+		if (useBloom) {
+			bloom->generate(texture);
+		}
+		bloomTimer.end();
 
 		// Second Pass
+		postTimer.begin();
+		ew::GpuProfileScope postScope("Post pass");
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (!srgbOutput) {
+			glDisable(GL_FRAMEBUFFER_SRGB);
+		}
 		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		postProcessShader.use();
 		postProcessShader.setBool("useBlur", useBlur);
-		postProcessShader.setBool("useGamma", useGamma);
 		postProcessShader.setInt("bluriness", bluriness);
-		postProcessShader.setFloat("gamma", gamma);
+		postProcessShader.setBool("_UseBloom", useBloom);
+		postProcessShader.setFloat("_BloomIntensity", bloomIntensity);
+		postProcessShader.setFloat("_Exposure", exposure);
+		postProcessShader.setInt("_Tonemapper", tonemapper);
+		bloom->bindTexture(postProcessShader, BLOOM_UNIT);
 
 		glBindVertexArray(quadVAO);
 		glBindVertexArray(quadVAO);
 		glDisable(GL_DEPTH_TEST);
+		glActiveTexture(GL_TEXTURE0);
+		postProcessShader.setInt("screenTexture", 0);
 		glBindTexture(GL_TEXTURE_2D, texture);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
-		
+		postScope.end();
+		postTimer.end();
 
+		//ImGui's colors are already sRGB
+		glDisable(GL_FRAMEBUFFER_SRGB);
 		drawUI();
 
+		ew::getUploadManager().endFrame();
 		glfwSwapBuffers(window);
+		ew::getProfiler().endFrame();
 	}
 
 	glDeleteFramebuffers(1, &fbo);
+	delete materialTextures;
+	delete bloom;
 
 	printf("Shutting down...");
 }
 
+/// <summary>
+/// Sets camera, light and material uniforms shared by the lit shaders
+/// </summary>
+void setLitUniforms(const ew::Shader& shader) {
+	shader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+	shader.setInt("_MainTex", 0);
+	shader.setVec3("_EyePos", camera.position);
+	shader.setVec3("_CameraForward", glm::normalize(camera.target - camera.position));
+	shadowMap->setSampleUniforms(shader, 1);
+	shadowMoments->setSampleUniforms(shader, 2);
+	pointShadows->setSampleUniforms(shader, 3);
+	shadowAtlas->setSampleUniforms(shader, 4);
+	lightBuffer->setUniforms(shader);
+	lightClusters->setUniforms(shader);
+	materialTextures->setUniforms(shader, MATERIAL_ARRAY_UNIT);
+	shader.setBool("_UseMaterials", useMaterialTextures);
+	shader.setBool("_UseClusters", useClusteredLighting);
+	shader.setBool("_ShowCascades", showCascades);
+
+	shader.setFloat("_Material.Ka", material.Ka);
+	shader.setFloat("_Material.Kd", material.Kd);
+	shader.setFloat("_Material.Ks", material.Ks);
+	shader.setFloat("_Material.Shininess", material.Shininess);
+
+	shader.setVec3("_LightDirection", lightDir);
+	shader.setFloat("_BiasValue", biasValue);
+	shader.setInt("_ShadowFilter", shadowFilter);
+	shader.setInt("_ShadowSamples", shadowSamples);
+	shader.setFloat("_ShadowRadius", shadowRadius);
+}
+
+/// <summary>
+/// Point lights circle above the rig and spot lights on a ring aim at the plane's center.
+/// Shadow indices and atlas tiles are cleared, the shadow pass assigns them.
+/// </summary>
+void updatePointSpotLights(float time) {
+	static const glm::vec3 colors[4] = { glm::vec3(1.0f, 0.5f, 0.3f), glm::vec3(0.3f, 0.6f, 1.0f), glm::vec3(0.4f, 1.0f, 0.5f), glm::vec3(1.0f, 0.9f, 0.5f) };
+	float t = animatePointSpotLights ? time : 0.0f;
+	//Golden angle spiral over the plane, ranges shrink as more lights share it
+	pointLights.resize(numPointLights);
+	float pointRange = glm::clamp(8.0f / sqrtf(numPointLights / 4.0f), 1.5f, 8.0f);
+	for (int i = 0; i < numPointLights; i++)
+	{
+		float angle = t * 0.5f + i * 2.3999632f;
+		float radius = 4.5f * sqrtf((i + 0.5f) / numPointLights);
+		pointLights[i].position = glm::vec3(cosf(angle) * radius, -3.0f + sinf(t + i) * 1.0f, sinf(angle) * radius);
+		pointLights[i].range = pointRange;
+		pointLights[i].color = colors[i % 4] * pointSpotIntensity;
+		pointLights[i].shadowIndex = -1;
+	}
+	spotLights.resize(numSpotLights);
+	spotTiles.assign(numSpotLights, ew::AtlasTile());
+	for (int i = 0; i < numSpotLights; i++)
+	{
+		float angle = -t * 0.3f + i * 6.2831853f / numSpotLights;
+		ew::SpotLight& light = spotLights[i];
+		light.position = glm::vec3(cosf(angle) * 4.5f, 2.0f, sinf(angle) * 4.5f);
+		light.direction = glm::normalize(glm::vec3(0.0f, -5.0f, 0.0f) - light.position);
+		light.range = 15.0f;
+		light.cosOuter = cosf(glm::radians(30.0f));
+		light.cosInner = cosf(glm::radians(24.0f));
+		light.color = colors[(i + 2) % 4] * pointSpotIntensity;
+		light.atlasRect = glm::vec4(0.0f);
+	}
+}
+
+/// <summary>
+/// Advances the light count sweep by one frame, moving to the next count and mode after SWEEP_FRAMES timed frames
+/// </summary>
+void updateLightSweep(float litPassMs) {
+	lightSweep.frame++;
+	if (lightSweep.frame <= SWEEP_WARMUP_FRAMES) {
+		return;
+	}
+	lightSweep.totalMs += litPassMs;
+	if (lightSweep.step % 2 == 1) {
+		//Stats lag a few frames, the warmup covers that
+		unsigned int& dropped = lightSweep.dropped[lightSweep.step / 2];
+		dropped = glm::max(dropped, lightClusters->getNumDropped());
+	}
+	if (lightSweep.frame < SWEEP_WARMUP_FRAMES + SWEEP_FRAMES) {
+		return;
+	}
+	lightSweep.results[lightSweep.step / 2][lightSweep.step % 2] = lightSweep.totalMs / SWEEP_FRAMES;
+	lightSweep.step++;
+	lightSweep.frame = 0;
+	lightSweep.totalMs = 0.0f;
+	if (lightSweep.step < NUM_SWEEP_COUNTS * 2) {
+		return;
+	}
+	lightSweep.running = false;
+	lightSweep.hasResults = true;
+	numPointLights = lightSweep.savedNumPointLights;
+	useClusteredLighting = lightSweep.savedUseClusters;
+	printf("%-8s %14s %14s %14s\n", "Lights", "All lights ms", "Clustered ms", "Dropped");
+	for (int i = 0; i < NUM_SWEEP_COUNTS; i++)
+	{
+		printf("%-8d %14.3f %14.3f %14u\n", SWEEP_COUNTS[i], lightSweep.results[i][0], lightSweep.results[i][1], lightSweep.dropped[i]);
+	}
+}
+
+/// <summary>
+/// Square tinted test pattern: 0 checker, 1 stripes, 2 dots, 3 rings
+/// </summary>
+std::vector<unsigned char> createPatternTexture(int pattern, const glm::vec3& tint, int size) {
+	std::vector<unsigned char> rgba((size_t)size * size * 4);
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			glm::vec2 uv = glm::vec2(x + 0.5f, y + 0.5f) / (float)size;
+			float v;
+			switch (pattern) {
+			case 0:
+				v = ((x / 32 + y / 32) & 1) ? 1.0f : 0.35f;
+				break;
+			case 1:
+				v = ((x + y) / 24) & 1 ? 1.0f : 0.35f;
+				break;
+			case 2:
+				v = glm::length(glm::fract(uv * 8.0f) - 0.5f) < 0.3f ? 1.0f : 0.35f;
+				break;
+			default:
+				v = 0.35f + 0.65f * (0.5f + 0.5f * cosf(glm::length(uv - 0.5f) * 60.0f));
+				break;
+			}
+			glm::vec3 color = tint * v;
+			for (int c = 0; c < 3; c++)
+			{
+				rgba[((size_t)y * size + x) * 4 + c] = (unsigned char)(color[c] * 255.0f);
+			}
+			rgba[((size_t)y * size + x) * 4 + 3] = 255;
+		}
+	}
+	return rgba;
+}
+
 void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
 	camera->position = glm::vec3(0, 0, 5.0f);
 	camera->target = glm::vec3(0);
@@ -406,6 +1077,7 @@ void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
 }
 
 void drawUI() {
+	EW_PROFILE_GPU_SCOPE("UI");
 	ImGui_ImplGlfw_NewFrame();
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui::NewFrame();
@@ -416,6 +1088,30 @@ void drawUI() {
 	if (ImGui::Button("Reset Camera")) {
 		resetCamera(&camera, &cameraController);
 	}
+	if (ImGui::CollapsingHeader("Camera Path")) {
+		if (ImGui::Button(recordingPath ? "Stop Recording" : "Record")) {
+			recordingPath = !recordingPath;
+			playingPath = false;
+			if (recordingPath) {
+				cameraPath.clear();
+				pathStartTime = (float)glfwGetTime();
+			}
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Play") && !recordingPath && !cameraPath.getKeys().empty()) {
+			playingPath = true;
+			pathStartTime = (float)glfwGetTime();
+		}
+		ImGui::Text("%d keys, %.1f s", (int)cameraPath.getKeys().size(), cameraPath.getDuration());
+		ImGui::InputText("File", cameraPathFile, sizeof(cameraPathFile));
+		if (ImGui::Button("Save")) {
+			cameraPath.save(cameraPathFile);
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Load")) {
+			cameraPath.load(cameraPathFile);
+		}
+	}
 	if (ImGui::CollapsingHeader("Material")) {
 		ImGui::SliderFloat("AmbientK", &material.Ka, 0.0f, 1.0f);
 		ImGui::SliderFloat("DiffuseK", &material.Kd, 0.0f, 1.0f);
@@ -432,12 +1128,241 @@ void drawUI() {
 				bluriness++;
 			}
 		}
-		ImGui::Checkbox("Use Gamma Correction", &useGamma);
-		ImGui::SliderFloat("Gamma", &gamma, 0.0f, 10.0f);
+		ImGui::Checkbox("sRGB Output", &srgbOutput);
+		if (!srgbOutput) {
+			ImGui::Text("Writing linear color, the image is too dark");
+		}
+		ImGui::SliderFloat("Exposure", &exposure, 0.1f, 8.0f);
+		const char* tonemapperNames[3] = { "None (clip)", "Reinhard", "ACES" };
+		ImGui::Combo("Tonemapper", &tonemapper, tonemapperNames, 3);
+		ImGui::Checkbox("Bloom", &useBloom);
+		ImGui::SliderFloat("Bloom Intensity", &bloomIntensity, 0.0f, 0.5f);
+		ImGui::SliderFloat("Bloom Threshold", &bloom->threshold, 0.0f, 4.0f);
+		ImGui::SliderFloat("Bloom Knee", &bloom->knee, 0.0f, 1.0f);
+		ImGui::SliderInt("Bloom Levels", &bloom->numLevels, 1, bloom->getNumLevels());
+		ImGui::Text("Bloom GPU: %.3f ms", bloomTimer.ms);
+		ImGui::Text("Blur + composite + tonemap GPU: %.3f ms", postTimer.ms);
 	}
 	if (ImGui::CollapsingHeader("Shadow Settings")) {
 		ImGui::SliderFloat3("Light Direction", &lightDir.x, -1.0f, 1.0f);
 		ImGui::SliderFloat("Bias Value", &biasValue, 0.0f, 0.5f);
+		const char* filterNames[5] = { "Hardware PCF (1 tap)", "3x3 PCF (9 taps)", "Poisson Disk", "VSM", "EVSM" };
+		ImGui::Combo("Shadow Filter", &shadowFilter, filterNames, 5);
+		if (shadowFilter == 2) {
+			ImGui::SliderInt("Quality (taps)", &shadowSamples, 1, 16);
+			ImGui::SliderFloat("Softness (texels)", &shadowRadius, 0.5f, 6.0f);
+		}
+		if (shadowFilter >= 3) {
+			ImGui::SliderInt("Blur Radius (texels)", &shadowMoments->blurRadius, 0, 8);
+			ImGui::SliderFloat("Light Bleed Reduction", &shadowMoments->lightBleedReduction, 0.0f, 0.9f);
+			ImGui::SliderFloat("Min Variance", &shadowMoments->minVariance, 0.0f, 0.0005f, "%.6f");
+		}
+		if (shadowFilter == 4) {
+			ImGui::SliderFloat("Positive Exponent", &shadowMoments->positiveExponent, 0.0f, ew::ShadowMoments::MAX_EXPONENT_16F);
+			ImGui::SliderFloat("Negative Exponent", &shadowMoments->negativeExponent, 0.0f, ew::ShadowMoments::MAX_EXPONENT_16F);
+		}
+		ImGui::Text("Shadow pass GPU: %.3f ms", shadowTimer.ms);
+		int numCascades = shadowMap->getNumCascades();
+		if (ImGui::SliderInt("Cascades", &numCascades, 1, ew::CascadedShadowMap::MAX_CASCADES))
+			shadowMap->setNumCascades(numCascades);
+		ImGui::SliderFloat("Split Lambda", &shadowMap->splitLambda, 0.0f, 1.0f);
+		ImGui::SliderFloat("Shadow Distance", &shadowMap->shadowDistance, 5.0f, 100.0f);
+		ImGui::SliderFloat("Caster Distance", &shadowMap->casterDistance, 0.0f, 50.0f);
+		ImGui::Checkbox("Show Cascades", &showCascades);
+		if (ImGui::Checkbox("Cache Static Shadows", &cacheStaticShadows))
+			shadowMap->invalidateStatic();
+		if (cacheStaticShadows) {
+			ImGui::Text("Static draws saved: %u this frame, %u total", staticDrawsSaved, totalStaticDrawsSaved);
+			ImGui::Text("Re-rendered cascades:");
+			for (int i = 0; i < shadowMap->getNumCascades(); i++)
+			{
+				ImGui::SameLine();
+				ImGui::Text("%d%s", i, (staticDirtyMask & (1 << i)) ? "*" : "");
+			}
+		}
+	}
+	if (ImGui::CollapsingHeader("Point & Spot Lights")) {
+		//No more than fit in one cluster, so clustered lighting never drops any
+		ImGui::SliderInt("Point Lights", &numPointLights, 0, ew::LightClusters::MAX_LIGHTS_PER_CLUSTER);
+		ImGui::SliderInt("Spot Lights", &numSpotLights, 0, 16);
+		ImGui::SliderFloat("Intensity", &pointSpotIntensity, 0.0f, 20.0f);
+		ImGui::Checkbox("Animate", &animatePointSpotLights);
+		ImGui::Checkbox("Cast Shadows", &pointSpotShadows);
+		if (pointSpotShadows) {
+			ImGui::Text("Point shadows: %d cubes of %d", glm::min(numPointLights, pointShadows->getMaxLights()), pointShadows->getResolution());
+			ImGui::Text("Atlas: %d tiles, %.0f%% used", shadowAtlas->getNumTiles(), shadowAtlas->getUsage() * 100.0f);
+			for (size_t i = 0; i < spotTiles.size(); i++)
+			{
+				ImGui::Text("Spot %zu: %d x %d", i, spotTiles[i].size, spotTiles[i].size);
+			}
+			//The atlas itself has depth comparison on, ImGui samples it as a regular texture
+			if (shadowAtlas->getPreviewTexture() != 0) {
+				ImGui::Image((ImTextureID)shadowAtlas->getPreviewTexture(), ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
+			}
+		}
+	}
+	if (ImGui::CollapsingHeader("Clustered Lighting")) {
+		ImGui::Checkbox("Use Clusters", &useClusteredLighting);
+		glm::ivec3 dims = lightClusters->getDimensions();
+		ImGui::Text("%d x %d tiles, %d slices", dims.x, dims.y, dims.z);
+		if (useClusteredLighting) {
+			ImGui::Text("Average lights per cluster: %.2f", lightClusters->getNumIndices() / (float)lightClusters->getNumClusters());
+			ImGui::Text("Dropped from full clusters: %u", lightClusters->getNumDropped());
+		}
+		ImGui::Text("Binning + lit pass GPU: %.3f ms", litTimer.ms);
+		if (lightSweep.running) {
+			ImGui::Text("Sweeping %d lights (%s)...", SWEEP_COUNTS[lightSweep.step / 2], lightSweep.step % 2 ? "clustered" : "all lights");
+		}
+		else if (ImGui::Button("Run Light Count Sweep")) {
+			lightSweep = LightSweep();
+			lightSweep.running = true;
+			lightSweep.savedNumPointLights = numPointLights;
+			lightSweep.savedUseClusters = useClusteredLighting;
+		}
+		if (lightSweep.hasResults) {
+			for (int i = 0; i < NUM_SWEEP_COUNTS; i++)
+			{
+				ImGui::Text("%5d lights: %7.3f ms all, %7.3f ms clustered, %u dropped", SWEEP_COUNTS[i], lightSweep.results[i][0], lightSweep.results[i][1], lightSweep.dropped[i]);
+			}
+		}
+	}
+	if (ImGui::CollapsingHeader("Depth Pre-Pass")) {
+		ImGui::Checkbox("Use Depth Pre-Pass", &useDepthPrepass);
+		if (useDeferredShading) {
+			ImGui::Text("Not used with deferred shading");
+		}
+		else {
+			if (useDepthPrepass) {
+				ImGui::Text("Pre-pass GPU: %.3f ms, lit pass GPU: %.3f ms", prepassTimer.ms, litTimer.ms);
+			}
+			ImGui::Text("Forward without pre-pass: %.3f ms", forwardMsWithoutPrepass);
+			ImGui::Text("Forward with pre-pass: %.3f ms", forwardMsWithPrepass);
+			//Both need a measurement before they can be compared
+			if (forwardMsWithoutPrepass > 0.0f && forwardMsWithPrepass > 0.0f) {
+				float saved = forwardMsWithoutPrepass - forwardMsWithPrepass;
+				ImGui::Text(saved >= 0.0f ? "Pre-pass saves %.3f ms in this scene" : "Pre-pass costs %.3f ms in this scene", glm::abs(saved));
+			}
+		}
+	}
+	if (ImGui::CollapsingHeader("Deferred Shading")) {
+		ImGui::Checkbox("Use Deferred Shading", &useDeferredShading);
+		const char* viewNames[6] = { "Lit", "Albedo", "Normal (octahedral)", "Material (Kd, Ks, Shininess)", "Depth", "World Position" };
+		ImGui::Combo("G-Buffer View", &gBufferView, viewNames, 6);
+		ImGui::Text("G-buffer: %d x %d, 12 bytes per pixel + depth", gBuffer->getWidth(), gBuffer->getHeight());
+	}
+	if (ImGui::CollapsingHeader("Texture Compression")) {
+		const ew::TextureEntry* brick = brickTexture.getEntry();
+		if (brick != nullptr) {
+			//Full chain as RGBA8 is 4/3 of the top level
+			float uncompressedMB = brick->width * brick->height * 4 * (4.0f / 3.0f) / (1024.0f * 1024.0f);
+			float residentMB = brick->bytes / (1024.0f * 1024.0f);
+			ImGui::Text("Brick texture: %s, loaded in %.2f ms", brick->formatName, brickLoadMs);
+			ImGui::Text("VRAM: %.2f MB, %.2f MB as RGBA8 (%.1fx smaller)", residentMB, uncompressedMB, uncompressedMB / residentMB);
+			if (brick->internalFormat == GL_RGBA8 || brick->internalFormat == GL_SRGB8_ALPHA8) {
+				ImGui::Text("Not compressed, build the cookAssetsA6 target");
+			}
+		}
+	}
+	if (ImGui::CollapsingHeader("Material Textures")) {
+		ImGui::Checkbox("Per Object Textures", &useMaterialTextures);
+		if (materialTextures->hasHandles()) {
+			if (ImGui::Checkbox("Bindless Textures", &useBindlessTextures)) {
+				materialTextures->setBindless(useBindlessTextures);
+			}
+		}
+		else {
+			ImGui::Text("ARB_bindless_texture or NV_gpu_shader5 not supported, arrays are bound");
+		}
+		ImGui::Text("%d materials in %d arrays, %.2f MB", materialTextures->getNumMaterials(), materialTextures->getNumArrays(),
+			materialTextures->getMemory() / (1024.0f * 1024.0f));
+		ImGui::Text("Texture binds per lit pass: %d", useMaterialTextures ? materialTextures->getBindsPerPass() : 1);
+	}
+	if (ImGui::CollapsingHeader("Texture Cache")) {
+		ew::TextureCache& cache = ew::getTextureCache();
+		if (ImGui::SliderInt("Budget (MB)", &textureBudgetMB, 1, 512)) {
+			cache.setBudget((size_t)textureBudgetMB * 1024 * 1024);
+		}
+		const ew::TextureCacheStats& stats = cache.getStats();
+		ImGui::Text("Resident: %.2f / %d MB", cache.getResidentBytes() / (1024.0f * 1024.0f), textureBudgetMB);
+		ImGui::Text("Hits %u, misses %u, evictions %u, mip drops %u, restores %u", stats.hits, stats.misses, stats.evictions, stats.mipDrops, stats.restores);
+		for (const ew::TextureEntry* entry : cache.getEntries())
+		{
+			size_t slash = entry->path.find_last_of('/');
+			const char* name = entry->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+			ImGui::Text("%s: %s %dx%d, %.2f MB, %d refs, last used %llu frames ago", name, entry->formatName,
+				entry->width >> entry->firstLevel, entry->height >> entry->firstLevel, entry->bytes / (1024.0f * 1024.0f),
+				entry->refCount, cache.getFrame() - entry->lastUsedFrame);
+		}
+	}
+	if (ImGui::CollapsingHeader("CPU Mip Generation")) {
+		const char* filterNames[2] = { "Box", "Kaiser" };
+		ImGui::Combo("Filter", &mipFilter, filterNames, 2);
+		ImGui::Checkbox("Gamma Correct", &gammaCorrectMips);
+		ImGui::SliderInt("Copies", &mipBenchCopies, 1, 32);
+		if (ImGui::Button("Load Brick Copies")) {
+			std::vector<const char*> paths(mipBenchCopies, "assets/brick_color.jpg");
+			std::vector<unsigned int> textures = ew::loadTextures(paths, (ew::MipFilter)mipFilter, gammaCorrectMips, &textureLoadStats);
+			glDeleteTextures((int)textures.size(), textures.data());
+		}
+		if (textureLoadStats.numTextures > 0) {
+			ImGui::Text("%d textures, %.2f MB decoded + %.2f MB mips", textureLoadStats.numTextures,
+				textureLoadStats.decodedBytes / (1024.0f * 1024.0f), textureLoadStats.mipBytes / (1024.0f * 1024.0f));
+			ImGui::Text("Decode %.1f ms, mips %.1f ms (summed over threads)", textureLoadStats.decodeMs, textureLoadStats.mipMs);
+			ImGui::Text("Wall %.1f ms, %.0f MB/s, upload %.1f ms", textureLoadStats.cpuMs, textureLoadStats.getThroughputMBs(), textureLoadStats.uploadMs);
+		}
+	}
+	if (ImGui::CollapsingHeader("Dynamic Plane")) {
+		ImGui::Checkbox("Animate Plane", &animatePlane);
+		ImGui::SliderFloat("Wave Amplitude", &waveAmplitude, 0.0f, 1.0f);
+		ImGui::SliderFloat("Wave Frequency", &waveFrequency, 0.1f, 5.0f);
+	}
+	if (ImGui::CollapsingHeader("GPU Culling")) {
+		ImGui::Checkbox("Use GPU Culling", &useGpuCulling);
+		ImGui::Checkbox("Occlusion Culling (Hi-Z)", &useOcclusionCulling);
+		if (useGpuCulling) {
+			ImGui::Text("Camera: %u / %u visible", culler->getNumVisible(CAMERA_VIEW), culler->getNumInstances());
+			ImGui::Text("Light: %u / %u visible", culler->getNumVisible(LIGHT_VIEW), culler->getNumInstances());
+		}
+	}
+	if (ImGui::CollapsingHeader("CPU Culling")) {
+		ImGui::Checkbox("Use CPU Culling", &useCpuCulling);
+		ImGui::Checkbox("Use BVH", &useBvhCulling);
+		ImGui::Text("Batch test: %s", ew::getCullSimdName());
+		if (useGpuCulling) {
+			ImGui::Text("Disabled while GPU culling is on");
+		}
+		else {
+			ImGui::Text("Shadow pass: %u drawn, %u culled", shadowCullStats.drawn, shadowCullStats.culled);
+			ImGui::Text("Main pass: %u drawn, %u culled", mainCullStats.drawn, mainCullStats.culled);
+		}
+	}
+	if (ImGui::CollapsingHeader("GPU Timings")) {
+		ImGui::Text("Shadows: %.3f ms", shadowTimer.ms);
+		ImGui::Text("Depth pre-pass: %.3f ms", useDepthPrepass && !useDeferredShading ? prepassTimer.ms : 0.0f);
+		ImGui::Text("Binning + lit: %.3f ms", litTimer.ms);
+		ImGui::Text("Bloom: %.3f ms", useBloom ? bloomTimer.ms : 0.0f);
+		ImGui::Text("Post: %.3f ms", postTimer.ms);
+	}
+	if (ImGui::CollapsingHeader("Profiler")) {
+		ew::Profiler& profiler = ew::getProfiler();
+		ImGui::Checkbox("Record", &profiler.enabled);
+		ImGui::SameLine();
+		ImGui::Checkbox("Pause", &profiler.paused);
+		ImGui::InputText("Trace File", traceFile, sizeof(traceFile));
+		if (ImGui::Button("Export Chrome Trace")) {
+			profiler.exportChromeTrace(traceFile);
+		}
+		profiler.drawTimeline();
+	}
+	if (ImGui::CollapsingHeader("Upload Stats")) {
+		const ew::UploadManager& uploadManager = ew::getUploadManager();
+		const ew::UploadStats& stats = uploadManager.getStats();
+		ImGui::Text("Bytes uploaded last frame: %zu", stats.bytesLastFrame);
+		ImGui::Text("Uploads last frame: %u", stats.uploadsLastFrame);
+		ImGui::Text("Stalls last frame: %u", stats.stallsLastFrame);
+		ImGui::Text("Total stalls: %u", stats.totalStalls);
+		ImGui::Text("Total uploaded: %.2f MB", stats.totalBytes / (1024.0f * 1024.0f));
+		ImGui::Text("Ring in flight: %zu / %zu", uploadManager.getBytesInFlight(), uploadManager.getCapacity());
 	}
 
 	/*ImGui::Begin("Shadow Map");
@@ -447,12 +1372,13 @@ void drawUI() {
 		ImVec2 windowSize = ImGui::GetWindowSize();
 		//Invert 0-1 V to flip vertically for ImGui display
 		//shadowMap is the texture2D handle
-		ImGui::Image((ImTextureID)depthMap, windowSize, ImVec2(0, 1), ImVec2(1, 0));
+		ImGui::Image((ImTextureID)shadowMap->getTexture(), windowSize, ImVec2(0, 1), ImVec2(1, 0));
 		ImGui::EndChild();
 	ImGui::End();*/
 
 	if (selJoint != nullptr)
 	{
+		ImGui::Text("Selected: %s (left click a joint to pick, %.3f ms)", selJoint->m_name.c_str(), lastPickMs);
 		glm::vec3 euler = glm::eulerAngles(selJoint->m_localPose.m_rotation);
 		ImGui::DragFloat3("Position", &selJoint->m_localPose.m_translation.x, 0.1f);
 		ImGui::DragFloat3("Rotation", &euler.x, 0.1f);
@@ -578,12 +1504,13 @@ void kinematicsControls(vd::Joint* joint)
 	ImGui::Begin("Kinematics Controls");
 	{
 		ImGuiTreeNodeFlags flag = ImGuiTreeNodeFlags_DefaultOpen;
+		if (joint->m_clicked)
+			flag |= ImGuiTreeNodeFlags_Selected;
 		if (ImGui::TreeNodeEx(joint->m_name.c_str(), flag))
 		{
 			if (ImGui::IsItemClicked())
 			{
-				//joint->m_clicked = true;
-				selJoint = joint;
+				selectJoint(joint);
 			}
 
 			for (int i = 0; i < joint->m_children.size(); i++)
@@ -619,6 +1546,7 @@ GLFWwindow* initWindow(const char* title, int width, int height) {
 		return nullptr;
 	}
 
+	glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
 	GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
 	if (window == NULL) {
 		printf("GLFW failed to create window");
@@ -640,3 +1568,32 @@ GLFWwindow* initWindow(const char* title, int width, int height) {
 	return window;
 }
 
+void selectJoint(vd::Joint* joint)
+{
+	if (selJoint != nullptr)
+		selJoint->m_clicked = false;
+	selJoint = joint;
+	selJoint->m_clicked = true;
+}
+
+/// <summary>
+/// Finds the closest joint whose oriented mesh bounds the ray hits. The BVH narrows it down to joints whose
+/// world AABB is hit, those are visited near to far until no remaining box can beat the best hit.
+/// </summary>
+vd::Joint* pickJoint(const ew::Ray& ray, const ew::BVH& bvh, const std::vector<vd::Joint*>& joints, const ew::AABB& localBounds)
+{
+	std::vector<ew::RayHit> hits;
+	bvh.raycastAll(ray, hits);
+	vd::Joint* picked = nullptr;
+	float closest = FLT_MAX;
+	for (size_t i = 0; i < hits.size() && hits[i].t < closest; i++)
+	{
+		vd::Joint* joint = joints[hits[i].object];
+		float t;
+		if (ew::intersectRay(localBounds, joint->m_globalPose, ray, closest, &t)) {
+			closest = t;
+			picked = joint;
+		}
+	}
+	return picked;
+}
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include <ew/bvh.h>
+#include <ew/camera.h>
+
+//Times BVH build, refit and queries against brute force for growing object counts.
+//Objects are scattered with constant density, so a query sees roughly the same number of them at every size.
+
+const int NUM_SIZES = 4;
+const unsigned int SIZES[NUM_SIZES] = { 1000, 10000, 100000, 1000000 };
+const int NUM_REFITS = 10;
+const int NUM_FRUSTUMS = 64;
+const int NUM_RAYS = 10000;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+double elapsedMs(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+float randomRange(float min, float max) {
+	return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+glm::vec3 randomPoint(float halfSize) {
+	return glm::vec3(randomRange(-halfSize, halfSize), randomRange(-halfSize, halfSize), randomRange(-halfSize, halfSize));
+}
+
+void scatterObjects(std::vector<ew::AABB>& bounds, float halfSize) {
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		glm::vec3 center = randomPoint(halfSize);
+		glm::vec3 extents = glm::vec3(randomRange(0.25f, 0.75f));
+		bounds[i].min = center - extents;
+		bounds[i].max = center + extents;
+	}
+}
+
+//Small random motion, like joints moving a little every frame
+void jitterObjects(std::vector<ew::AABB>& bounds) {
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		glm::vec3 offset = randomPoint(0.1f);
+		bounds[i].min += offset;
+		bounds[i].max += offset;
+	}
+}
+
+int main() {
+	srand(300);
+	printf("%-9s %10s %10s %12s %12s %12s %12s %12s\n",
+		"Objects", "Build ms", "Refit ms", "Frustum us", "Brute us", "2x batch us", "Ray us", "Brute ray us");
+
+	for (int s = 0; s < NUM_SIZES; s++)
+	{
+		unsigned int numObjects = SIZES[s];
+		float halfSize = 5.0f * cbrtf((float)numObjects);
+		std::vector<ew::AABB> bounds(numObjects);
+		scatterObjects(bounds, halfSize);
+
+		ew::BVH bvh;
+		Clock::time_point start = Clock::now();
+		bvh.build(bounds);
+		double buildMs = elapsedMs(start);
+
+		double refitMs = 0.0;
+		for (int i = 0; i < NUM_REFITS; i++)
+		{
+			jitterObjects(bounds);
+			start = Clock::now();
+			bvh.refit(bounds);
+			refitMs += elapsedMs(start);
+		}
+		refitMs /= NUM_REFITS;
+
+		//Cameras inside the volume looking at random points, plus an ortho shadow-style view of the same area
+		std::vector<ew::Frustum> frustums(NUM_FRUSTUMS);
+		std::vector<ew::Frustum> shadowFrustums(NUM_FRUSTUMS);
+		for (int i = 0; i < NUM_FRUSTUMS; i++)
+		{
+			ew::Camera camera;
+			camera.position = randomPoint(halfSize);
+			camera.target = randomPoint(halfSize);
+			camera.aspectRatio = 16.0f / 9.0f;
+			camera.farPlane = 50.0f;
+			frustums[i] = ew::extractFrustum(camera.projectionMatrix() * camera.viewMatrix());
+			camera.orthographic = true;
+			camera.orthoHeight = 40.0f;
+			shadowFrustums[i] = ew::extractFrustum(camera.projectionMatrix() * camera.viewMatrix());
+		}
+
+		std::vector<unsigned int> results[2];
+		size_t bvhVisible = 0;
+		start = Clock::now();
+		for (int i = 0; i < NUM_FRUSTUMS; i++)
+		{
+			bvh.queryFrustum(frustums[i], results[0]);
+			bvhVisible += results[0].size();
+		}
+		double frustumUs = elapsedMs(start) * 1000.0 / NUM_FRUSTUMS;
+
+		size_t bruteVisible = 0;
+		start = Clock::now();
+		for (int i = 0; i < NUM_FRUSTUMS; i++)
+		{
+			for (unsigned int j = 0; j < numObjects; j++)
+			{
+				bruteVisible += ew::isVisible(frustums[i], bounds[j]) ? 1 : 0;
+			}
+		}
+		double bruteUs = elapsedMs(start) * 1000.0 / NUM_FRUSTUMS;
+
+		//Camera and shadow frustum in one traversal
+		start = Clock::now();
+		for (int i = 0; i < NUM_FRUSTUMS; i++)
+		{
+			ew::Frustum pair[2] = { frustums[i], shadowFrustums[i] };
+			bvh.queryFrustums(pair, 2, results);
+		}
+		double batchUs = elapsedMs(start) * 1000.0 / NUM_FRUSTUMS;
+
+		std::vector<ew::Ray> rays(NUM_RAYS);
+		for (int i = 0; i < NUM_RAYS; i++)
+		{
+			rays[i].origin = randomPoint(halfSize);
+			rays[i].direction = glm::normalize(randomPoint(1.0f));
+		}
+		//Brute force rays are slow at high counts, so only a slice of them is timed
+		int numBruteRays = glm::max(1, (int)(NUM_RAYS * 1000 / numObjects));
+		numBruteRays = glm::min(numBruteRays, NUM_RAYS);
+
+		size_t bvhHits = 0;
+		size_t bvhSliceHits = 0;
+		start = Clock::now();
+		for (int i = 0; i < NUM_RAYS; i++)
+		{
+			ew::RayHit hit;
+			bool isHit = bvh.raycast(rays[i], &hit);
+			bvhHits += isHit ? 1 : 0;
+			bvhSliceHits += isHit && i < numBruteRays ? 1 : 0;
+		}
+		double rayUs = elapsedMs(start) * 1000.0 / NUM_RAYS;
+
+		size_t bruteHits = 0;
+		start = Clock::now();
+		for (int i = 0; i < numBruteRays; i++)
+		{
+			float t = 0.0f;
+			bool isHit = false;
+			for (unsigned int j = 0; j < numObjects; j++)
+			{
+				isHit = ew::intersectRay(bounds[j], rays[i], FLT_MAX, &t) || isHit;
+			}
+			bruteHits += isHit ? 1 : 0;
+		}
+		double bruteRayUs = elapsedMs(start) * 1000.0 / numBruteRays;
+
+		printf("%-9u %10.2f %10.3f %12.1f %12.1f %12.1f %12.2f %12.1f\n",
+			numObjects, buildMs, refitMs, frustumUs, bruteUs, batchUs, rayUs, bruteRayUs);
+		if (bvhVisible != bruteVisible) {
+			printf("  Frustum results differ: BVH %zu, brute force %zu\n", bvhVisible, bruteVisible);
+		}
+		if (bvhSliceHits != bruteHits) {
+			printf("  Ray results differ: BVH %zu, brute force %zu\n", bvhSliceHits, bruteHits);
+		}
+		printf("  %u nodes, %.1f visible per frustum, %zu / %d rays hit\n",
+			bvh.getNumNodes(), bvhVisible / (float)NUM_FRUSTUMS, bvhHits, NUM_RAYS);
+	}
+	return 0;
+}
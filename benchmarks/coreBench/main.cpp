@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include <ew/transform.h>
+#include <ew/camera.h>
+#include <ew/procGen.h>
+#include <vd/kinematics.h>
+#include <vd/animation.h>
+
+//CPU only micro-benchmarks for core math and geometry, so changes to core can be measured without a GPU.
+//Usage: core_bench [--benchmark_filter=regex] [--benchmark_format=json] [--benchmark_out=file]
+//Inputs are generated before timing starts with a fixed seed, so runs compare like for like.
+
+const int NUM_INPUTS = 1024; //Cycled through so one cached value isn't measured over and over
+const char* METHOD_NAMES[4] = { "Linear", "Cubic", "Cosine", "Exponential" };
+
+float randomRange(float min, float max) {
+	return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+glm::vec3 randomPoint(float halfSize) {
+	return glm::vec3(randomRange(-halfSize, halfSize), randomRange(-halfSize, halfSize), randomRange(-halfSize, halfSize));
+}
+
+std::vector<ew::Transform> createTransforms() {
+	srand(300);
+	std::vector<ew::Transform> transforms(NUM_INPUTS);
+	for (ew::Transform& transform : transforms)
+	{
+		transform.position = randomPoint(10.0f);
+		transform.rotation = glm::quat(randomPoint(3.14159f));
+		transform.scale = glm::vec3(randomRange(0.5f, 2.0f));
+	}
+	return transforms;
+}
+
+std::vector<ew::Camera> createCameras(bool orthographic) {
+	srand(300);
+	std::vector<ew::Camera> cameras(NUM_INPUTS);
+	for (ew::Camera& camera : cameras)
+	{
+		camera.position = randomPoint(10.0f);
+		camera.target = randomPoint(1.0f);
+		camera.fov = randomRange(30.0f, 90.0f);
+		camera.aspectRatio = randomRange(1.0f, 2.0f);
+		camera.orthographic = orthographic;
+	}
+	return cameras;
+}
+
+static void BM_TransformModelMatrix(benchmark::State& state) {
+	std::vector<ew::Transform> transforms = createTransforms();
+	int i = 0;
+	for (auto _ : state)
+	{
+		glm::mat4 m = transforms[i].modelMatrix();
+		benchmark::DoNotOptimize(m);
+		i = (i + 1) % NUM_INPUTS;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransformModelMatrix);
+
+static void BM_CameraViewMatrix(benchmark::State& state) {
+	std::vector<ew::Camera> cameras = createCameras(false);
+	int i = 0;
+	for (auto _ : state)
+	{
+		glm::mat4 m = cameras[i].viewMatrix();
+		benchmark::DoNotOptimize(m);
+		i = (i + 1) % NUM_INPUTS;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CameraViewMatrix);
+
+//Arg 0 is perspective, 1 is orthographic
+static void BM_CameraProjectionMatrix(benchmark::State& state) {
+	std::vector<ew::Camera> cameras = createCameras(state.range(0) != 0);
+	int i = 0;
+	for (auto _ : state)
+	{
+		glm::mat4 m = cameras[i].projectionMatrix();
+		benchmark::DoNotOptimize(m);
+		i = (i + 1) % NUM_INPUTS;
+	}
+	state.SetItemsProcessed(state.iterations());
+	state.SetLabel(state.range(0) != 0 ? "Orthographic" : "Perspective");
+}
+BENCHMARK(BM_CameraProjectionMatrix)->Arg(0)->Arg(1);
+
+//Arg is the number of joints, each with up to 3 children like the assignment's skeleton
+static void BM_SolveFK(benchmark::State& state) {
+	srand(300);
+	int numJoints = (int)state.range(0);
+	std::vector<std::unique_ptr<vd::Joint>> joints;
+	for (int i = 0; i < numJoints; i++)
+	{
+		joints.emplace_back(new vd::Joint());
+		vd::Joint* joint = joints.back().get();
+		joint->m_localPose.m_translation = randomPoint(1.0f);
+		joint->m_localPose.m_rotation = glm::quat(randomPoint(3.14159f));
+		if (i > 0) {
+			joint->m_parent = joints[(i - 1) / 3].get();
+			joint->m_parent->m_children.push_back(joint);
+		}
+	}
+	for (auto _ : state)
+	{
+		vd::SolveFK(joints[0].get());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * numJoints);
+}
+BENCHMARK(BM_SolveFK)->RangeMultiplier(8)->Range(8, 4096);
+
+//Arg is the number of keys in the clip, the playback time moves across the whole clip
+static void BM_AnimatorGetValue(benchmark::State& state) {
+	srand(300);
+	int numKeys = (int)state.range(0);
+	vd::AnimationClip clip;
+	clip.duration = 10.0f;
+	for (int i = 0; i < numKeys; i++)
+	{
+		clip.positionKeys.push_back(vd::KeyFrame<glm::vec3>(clip.duration * i / (numKeys - 1), randomPoint(5.0f), i % 4));
+	}
+	vd::Animator animator;
+	delete animator.clip;
+	animator.clip = &clip;
+	int i = 0;
+	for (auto _ : state)
+	{
+		animator.playbackTime = clip.duration * i / NUM_INPUTS;
+		glm::vec3 value = animator.GetValue(clip.positionKeys, glm::vec3(0.0f));
+		benchmark::DoNotOptimize(value);
+		i = (i + 1) % NUM_INPUTS;
+	}
+	animator.clip = nullptr;
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AnimatorGetValue)->RangeMultiplier(4)->Range(2, 512);
+
+//Arg is the vd::IntMethod
+template<typename T>
+static void BM_PickInterpolation(benchmark::State& state, const std::vector<T>& values) {
+	vd::IntMethod method = vd::IntMethod(state.range(0));
+	int i = 0;
+	for (auto _ : state)
+	{
+		T value = vd::PickInterpolation(values[i], values[(i + 1) % NUM_INPUTS], (float)i / NUM_INPUTS, method);
+		benchmark::DoNotOptimize(value);
+		i = (i + 1) % NUM_INPUTS;
+	}
+	state.SetItemsProcessed(state.iterations());
+	state.SetLabel(METHOD_NAMES[method]);
+}
+
+static void BM_PickInterpolationFloat(benchmark::State& state) {
+	srand(300);
+	std::vector<float> values(NUM_INPUTS);
+	for (float& value : values)
+	{
+		value = randomRange(-10.0f, 10.0f);
+	}
+	BM_PickInterpolation(state, values);
+}
+BENCHMARK(BM_PickInterpolationFloat)->DenseRange(vd::Linear, vd::Exponential);
+
+static void BM_PickInterpolationVec3(benchmark::State& state) {
+	srand(300);
+	std::vector<glm::vec3> values(NUM_INPUTS);
+	for (glm::vec3& value : values)
+	{
+		value = randomPoint(10.0f);
+	}
+	BM_PickInterpolation(state, values);
+}
+BENCHMARK(BM_PickInterpolationVec3)->DenseRange(vd::Linear, vd::Exponential);
+
+static void BM_CreateCube(benchmark::State& state) {
+	for (auto _ : state)
+	{
+		ew::MeshData mesh = ew::createCube(1.0f);
+		benchmark::DoNotOptimize(mesh.vertices.data());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CreateCube);
+
+//Procedural meshes, arg is the number of subdivisions
+static void BM_CreatePlane(benchmark::State& state) {
+	size_t numVertices = 0;
+	for (auto _ : state)
+	{
+		ew::MeshData mesh = ew::createPlane(10.0f, 10.0f, (int)state.range(0));
+		numVertices = mesh.vertices.size();
+		benchmark::DoNotOptimize(mesh.vertices.data());
+	}
+	state.SetItemsProcessed(state.iterations() * numVertices);
+}
+BENCHMARK(BM_CreatePlane)->RangeMultiplier(4)->Range(4, 256);
+
+static void BM_CreateSphere(benchmark::State& state) {
+	size_t numVertices = 0;
+	for (auto _ : state)
+	{
+		ew::MeshData mesh = ew::createSphere(1.0f, (int)state.range(0));
+		numVertices = mesh.vertices.size();
+		benchmark::DoNotOptimize(mesh.vertices.data());
+	}
+	state.SetItemsProcessed(state.iterations() * numVertices);
+}
+BENCHMARK(BM_CreateSphere)->RangeMultiplier(4)->Range(4, 256);
+
+static void BM_CreateCylinder(benchmark::State& state) {
+	size_t numVertices = 0;
+	for (auto _ : state)
+	{
+		ew::MeshData mesh = ew::createCylinder(1.0f, 2.0f, (int)state.range(0));
+		numVertices = mesh.vertices.size();
+		benchmark::DoNotOptimize(mesh.vertices.data());
+	}
+	state.SetItemsProcessed(state.iterations() * numVertices);
+}
+BENCHMARK(BM_CreateCylinder)->RangeMultiplier(4)->Range(4, 256);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,45 @@
+#version 450
+out vec4 FragColor;
+in Surface{
+	vec3 WorldPos;
+	vec3 WorldNormal;
+	vec4 LightSpacePos;
+}fs_in;
+
+uniform sampler2DShadow _ShadowMap;
+uniform vec3 _Color;
+uniform vec3 _EyePos;
+uniform vec3 _LightDirection;
+uniform vec3 _LightColor = vec3(3.0);
+uniform vec3 _AmbientColor = vec3(0.1, 0.12, 0.15);
+uniform float _Bias = 0.002;
+
+//3x3 hardware PCF
+float Shadow(vec4 lightSpacePos)
+{
+	vec3 p = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+	if(p.z > 1.0)
+		return 1.0;
+	vec2 texel = 1.0 / textureSize(_ShadowMap, 0);
+	float lit = 0.0;
+	for(int y = -1; y <= 1; y++)
+	{
+		for(int x = -1; x <= 1; x++)
+		{
+			lit += texture(_ShadowMap, vec3(p.xy + vec2(x, y) * texel, p.z - _Bias));
+		}
+	}
+	return lit / 9.0;
+}
+
+void main()
+{
+	vec3 normal = normalize(fs_in.WorldNormal);
+	vec3 toLight = normalize(-_LightDirection);
+	vec3 toEye = normalize(_EyePos - fs_in.WorldPos);
+	vec3 h = normalize(toLight + toEye);
+	float diffuse = max(dot(normal, toLight), 0.0);
+	float specular = pow(max(dot(normal, h), 0.0), 64.0) * 0.5;
+	vec3 light = (diffuse + specular) * _LightColor * Shadow(fs_in.LightSpacePos) + _AmbientColor;
+	FragColor = vec4(_Color * light, 1.0);
+}
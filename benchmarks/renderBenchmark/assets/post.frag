@@ -0,0 +1,12 @@
+#version 450
+out vec4 FragColor;
+in vec2 TexCoords;
+
+uniform sampler2D _Scene; //Linear HDR
+
+//Reinhard, written as is since the headless framebuffer is plain RGBA8
+void main()
+{
+	vec3 color = texture(_Scene, TexCoords).rgb;
+	FragColor = vec4(color / (1.0 + color), 1.0);
+}
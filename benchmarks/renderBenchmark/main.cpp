@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <ew/headlessContext.h>
+#include <ew/external/glad.h>
+#include <ew/shader.h>
+#include <ew/model.h>
+#include <ew/mesh.h>
+#include <ew/procGen.h>
+#include <ew/camera.h>
+#include <ew/cameraPath.h>
+#include <ew/transform.h>
+
+//Replays a camera path over a grid of monkeys with a shadow, lit and post pass, headless so it runs on build
+//servers. Every run sees the same frames: the camera is sampled at a fixed step along the path rather than by
+//wall time. Per frame it records CPU submit time, frame time, GPU time and triangles per pass and draw calls,
+//and writes their percentiles as JSON so runs from different commits can be compared.
+//Usage: renderBenchmark [-config file] [-out file.json] [-label name] [-backend egl|osmesa]
+//Run from bin, the config and camera path are read from bin/benchmarkAssets.
+
+typedef std::chrono::high_resolution_clock Clock;
+
+const char* ASSET_DIR = "benchmarkAssets/";
+
+enum Pass {
+	SHADOW_PASS,
+	LIT_PASS,
+	POST_PASS,
+	NUM_PASSES
+};
+
+//Query results are read this many frames after they're issued, so reading them doesn't stall the CPU
+const int QUERY_LATENCY = 3;
+//Frames still waiting to be read plus the one issuing new queries
+const int QUERY_SLOTS = QUERY_LATENCY + 1;
+
+struct Config {
+	int numFrames = 600;
+	int numWarmupFrames = 60;
+	int width = 1280;
+	int height = 720;
+	int gridSize = 16;
+	int shadowResolution = 2048;
+	std::string cameraPath = "orbit.path";
+};
+
+struct FrameStats {
+	double cpuMs = 0.0; //Submitting the frame
+	double frameMs = 0.0; //Start of this frame to the start of the next
+	double gpuMs[NUM_PASSES] = {};
+	double gpuTotalMs = 0.0;
+	double triangles = 0.0;
+	double drawCalls = 0.0;
+};
+
+struct Percentiles {
+	double mean, min, max, p50, p95, p99;
+};
+
+bool loadConfig(const std::string& filePath, Config& config) {
+	FILE* file = fopen(filePath.c_str(), "r");
+	if (file == NULL) {
+		printf("Failed to open config %s\n", filePath.c_str());
+		return false;
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		char key[64], value[192];
+		if (line[0] == '#' || sscanf(line, "%63s %191s", key, value) != 2) {
+			continue;
+		}
+		if (strcmp(key, "frames") == 0) config.numFrames = atoi(value);
+		else if (strcmp(key, "warmup") == 0) config.numWarmupFrames = atoi(value);
+		else if (strcmp(key, "width") == 0) config.width = atoi(value);
+		else if (strcmp(key, "height") == 0) config.height = atoi(value);
+		else if (strcmp(key, "gridSize") == 0) config.gridSize = atoi(value);
+		else if (strcmp(key, "shadowResolution") == 0) config.shadowResolution = atoi(value);
+		else if (strcmp(key, "cameraPath") == 0) config.cameraPath = value;
+		else printf("Unknown config key %s\n", key);
+	}
+	fclose(file);
+	return config.numFrames > 0 && config.width > 0 && config.height > 0 && config.gridSize > 0;
+}
+
+//Nearest rank percentiles
+Percentiles computePercentiles(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	size_t n = values.size();
+	auto rank = [&](double p) {
+		size_t i = (size_t)(p * n + 0.999999);
+		return values[i > 0 ? (i <= n ? i - 1 : n - 1) : 0];
+	};
+	double sum = 0.0;
+	for (double v : values)
+	{
+		sum += v;
+	}
+	return { sum / n, values.front(), values.back(), rank(0.5), rank(0.95), rank(0.99) };
+}
+
+void writeMetric(FILE* file, const char* name, const std::vector<double>& values, bool last = false) {
+	Percentiles p = computePercentiles(values);
+	fprintf(file, "    \"%s\": { \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f }%s\n",
+		name, p.mean, p.min, p.max, p.p50, p.p95, p.p99, last ? "" : ",");
+	printf("%-16s %10.3f %10.3f %10.3f %10.3f\n", name, p.mean, p.p50, p.p95, p.p99);
+}
+
+int main(int argc, char* argv[]) {
+	std::string configPath = std::string(ASSET_DIR) + "default.cfg";
+	std::string outputPath = "renderBenchmark.json";
+	std::string label = "unlabeled";
+	ew::HeadlessBackend backend = ew::HeadlessBackend::NONE;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-config") == 0) configPath = argv[i + 1];
+		else if (strcmp(argv[i], "-out") == 0) outputPath = argv[i + 1];
+		else if (strcmp(argv[i], "-label") == 0) label = argv[i + 1];
+		else if (strcmp(argv[i], "-backend") == 0) backend = strcmp(argv[i + 1], "osmesa") == 0 ? ew::HeadlessBackend::OSMESA : ew::HeadlessBackend::EGL;
+		else {
+			printf("Usage: renderBenchmark [-config file] [-out file.json] [-label name] [-backend egl|osmesa]\n");
+			return 1;
+		}
+	}
+	Config config;
+	ew::CameraPath cameraPath;
+	if (!loadConfig(configPath, config) || !cameraPath.load((ASSET_DIR + config.cameraPath).c_str())) {
+		return 1;
+	}
+	ew::HeadlessContext context;
+	if (!context.create(config.width, config.height, backend)) {
+		return 1;
+	}
+
+	ew::Shader depthShader = ew::Shader(std::string(ASSET_DIR) + "shadowDepth.vert", std::string(ASSET_DIR) + "shadowDepth.frag");
+	ew::Shader litShader = ew::Shader(std::string(ASSET_DIR) + "lit.vert", std::string(ASSET_DIR) + "lit.frag");
+	ew::Shader postShader = ew::Shader(std::string(ASSET_DIR) + "post.vert", std::string(ASSET_DIR) + "post.frag");
+	ew::Model monkeyModel = ew::Model(std::string(ASSET_DIR) + "Suzanne.obj");
+	ew::Mesh plane = ew::Mesh(ew::createPlane(100.0f, 100.0f, 1));
+
+	//Monkeys 3 units apart, centered on the origin
+	std::vector<glm::mat4> monkeys;
+	float offset = (config.gridSize - 1) * 1.5f;
+	for (int z = 0; z < config.gridSize; z++)
+	{
+		for (int x = 0; x < config.gridSize; x++)
+		{
+			ew::Transform transform;
+			transform.position = glm::vec3(x * 3.0f - offset, 0.0f, z * 3.0f - offset);
+			transform.rotation = glm::angleAxis((x * 7 + z * 13) * 0.3f, glm::vec3(0.0f, 1.0f, 0.0f));
+			monkeys.push_back(transform.modelMatrix());
+		}
+	}
+	glm::mat4 planeModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+
+	unsigned int shadowMap, shadowFbo;
+	glGenTextures(1, &shadowMap);
+	glBindTexture(GL_TEXTURE_2D, shadowMap);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, config.shadowResolution, config.shadowResolution);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glGenFramebuffers(1, &shadowFbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, shadowFbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadowMap, 0);
+	glDrawBuffer(GL_NONE);
+
+	unsigned int sceneColor, sceneDepth, sceneFbo;
+	glGenTextures(1, &sceneColor);
+	glBindTexture(GL_TEXTURE_2D, sceneColor);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, config.width, config.height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glGenRenderbuffers(1, &sceneDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, sceneDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, config.width, config.height);
+	glGenFramebuffers(1, &sceneFbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sceneColor, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, sceneDepth);
+	unsigned int emptyVAO;
+	glGenVertexArrays(1, &emptyVAO);
+
+	//Directional light fitted around the grid
+	glm::vec3 lightDirection = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+	float extent = offset + 4.0f;
+	glm::mat4 lightSpaceMatrix = glm::ortho(-extent, extent, -extent, extent, 0.1f, 4.0f * extent) *
+		glm::lookAt(-lightDirection * 2.0f * extent, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	ew::Camera camera;
+	camera.aspectRatio = (float)config.width / config.height;
+	camera.fov = 60.0f;
+
+	glEnable(GL_CULL_FACE);
+	glEnable(GL_DEPTH_TEST);
+
+	GLuint timerQueries[QUERY_SLOTS][NUM_PASSES];
+	GLuint primitiveQueries[QUERY_SLOTS][NUM_PASSES];
+	glGenQueries(QUERY_SLOTS * NUM_PASSES, &timerQueries[0][0]);
+	glGenQueries(QUERY_SLOTS * NUM_PASSES, &primitiveQueries[0][0]);
+
+	int totalFrames = config.numWarmupFrames + config.numFrames;
+	std::vector<FrameStats> frames(totalFrames);
+	Clock::time_point previousStart = Clock::now();
+	for (int frame = 0; frame < totalFrames + QUERY_LATENCY; frame++)
+	{
+		if (frame < totalFrames) {
+			Clock::time_point start = Clock::now();
+			if (frame > 0) {
+				frames[frame - 1].frameMs = std::chrono::duration<double, std::milli>(start - previousStart).count();
+			}
+			previousStart = start;
+			FrameStats& stats = frames[frame];
+			int slot = frame % QUERY_SLOTS;
+			//Warmup frames hold the first key, measured frames cover the whole path
+			int measured = frame - config.numWarmupFrames;
+			float t = measured <= 0 || config.numFrames == 1 ? 0.0f : measured / (float)(config.numFrames - 1);
+			cameraPath.sample(t * cameraPath.getDuration(), camera);
+
+			//Shadow pass
+			glBeginQuery(GL_TIME_ELAPSED, timerQueries[slot][SHADOW_PASS]);
+			glBeginQuery(GL_PRIMITIVES_GENERATED, primitiveQueries[slot][SHADOW_PASS]);
+			glBindFramebuffer(GL_FRAMEBUFFER, shadowFbo);
+			glViewport(0, 0, config.shadowResolution, config.shadowResolution);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			glCullFace(GL_FRONT);
+			depthShader.use();
+			depthShader.setMat4("_LightSpaceMatrix", lightSpaceMatrix);
+			for (const glm::mat4& model : monkeys)
+			{
+				depthShader.setMat4("_Model", model);
+				monkeyModel.draw();
+				stats.drawCalls++;
+			}
+			glEndQuery(GL_PRIMITIVES_GENERATED);
+			glEndQuery(GL_TIME_ELAPSED);
+
+			//Lit pass
+			glBeginQuery(GL_TIME_ELAPSED, timerQueries[slot][LIT_PASS]);
+			glBeginQuery(GL_PRIMITIVES_GENERATED, primitiveQueries[slot][LIT_PASS]);
+			glBindFramebuffer(GL_FRAMEBUFFER, sceneFbo);
+			glViewport(0, 0, config.width, config.height);
+			glClearColor(0.6f, 0.8f, 0.92f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glCullFace(GL_BACK);
+			litShader.use();
+			litShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+			litShader.setMat4("_LightSpaceMatrix", lightSpaceMatrix);
+			litShader.setVec3("_EyePos", camera.position);
+			litShader.setVec3("_LightDirection", lightDirection);
+			litShader.setInt("_ShadowMap", 0);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, shadowMap);
+			litShader.setVec3("_Color", 0.8f, 0.5f, 0.3f);
+			for (const glm::mat4& model : monkeys)
+			{
+				litShader.setMat4("_Model", model);
+				monkeyModel.draw();
+				stats.drawCalls++;
+			}
+			litShader.setVec3("_Color", 0.5f, 0.5f, 0.5f);
+			litShader.setMat4("_Model", planeModel);
+			plane.draw();
+			stats.drawCalls++;
+			glEndQuery(GL_PRIMITIVES_GENERATED);
+			glEndQuery(GL_TIME_ELAPSED);
+
+			//Post pass
+			glBeginQuery(GL_TIME_ELAPSED, timerQueries[slot][POST_PASS]);
+			glBeginQuery(GL_PRIMITIVES_GENERATED, primitiveQueries[slot][POST_PASS]);
+			context.bindFramebuffer();
+			glDisable(GL_DEPTH_TEST);
+			postShader.use();
+			postShader.setInt("_Scene", 0);
+			glBindTexture(GL_TEXTURE_2D, sceneColor);
+			glBindVertexArray(emptyVAO);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			stats.drawCalls++;
+			glEnable(GL_DEPTH_TEST);
+			glEndQuery(GL_PRIMITIVES_GENERATED);
+			glEndQuery(GL_TIME_ELAPSED);
+			glFlush();
+			stats.cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+
+		//Results of the frame issued QUERY_LATENCY frames ago
+		int resolved = frame - QUERY_LATENCY;
+		if (resolved >= 0) {
+			FrameStats& stats = frames[resolved];
+			int slot = resolved % QUERY_SLOTS;
+			for (int pass = 0; pass < NUM_PASSES; pass++)
+			{
+				GLuint64 ns = 0, primitives = 0;
+				glGetQueryObjectui64v(timerQueries[slot][pass], GL_QUERY_RESULT, &ns);
+				glGetQueryObjectui64v(primitiveQueries[slot][pass], GL_QUERY_RESULT, &primitives);
+				stats.gpuMs[pass] = ns / 1000000.0;
+				stats.gpuTotalMs += stats.gpuMs[pass];
+				stats.triangles += (double)primitives;
+			}
+		}
+	}
+	glFinish();
+	frames[totalFrames - 1].frameMs = std::chrono::duration<double, std::milli>(Clock::now() - previousStart).count();
+	frames.erase(frames.begin(), frames.begin() + config.numWarmupFrames);
+
+	FILE* file = fopen(outputPath.c_str(), "w");
+	if (file == NULL) {
+		printf("Failed to open %s for writing\n", outputPath.c_str());
+		return 1;
+	}
+	fprintf(file, "{\n");
+	fprintf(file, "  \"label\": \"%s\",\n", label.c_str());
+	fprintf(file, "  \"backend\": \"%s\",\n", ew::getHeadlessBackendName(context.getBackend()));
+	fprintf(file, "  \"renderer\": \"%s\",\n", (const char*)glGetString(GL_RENDERER));
+	fprintf(file, "  \"config\": { \"frames\": %d, \"warmup\": %d, \"width\": %d, \"height\": %d, \"gridSize\": %d, \"shadowResolution\": %d, \"cameraPath\": \"%s\" },\n",
+		config.numFrames, config.numWarmupFrames, config.width, config.height, config.gridSize, config.shadowResolution, config.cameraPath.c_str());
+	fprintf(file, "  \"metrics\": {\n");
+	printf("%-16s %10s %10s %10s %10s\n", "Metric", "Mean", "p50", "p95", "p99");
+	const int NUM_METRICS = 5 + NUM_PASSES;
+	const char* metricNames[NUM_METRICS] = { "cpuMs", "frameMs", "gpuTotalMs", "triangles", "drawCalls", "gpuShadowMs", "gpuLitMs", "gpuPostMs" };
+	std::vector<double> values[NUM_METRICS];
+	for (const FrameStats& frame : frames)
+	{
+		values[0].push_back(frame.cpuMs);
+		values[1].push_back(frame.frameMs);
+		values[2].push_back(frame.gpuTotalMs);
+		values[3].push_back(frame.triangles);
+		values[4].push_back(frame.drawCalls);
+		for (int pass = 0; pass < NUM_PASSES; pass++)
+		{
+			values[5 + pass].push_back(frame.gpuMs[pass]);
+		}
+	}
+	for (int i = 0; i < NUM_METRICS; i++)
+	{
+		writeMetric(file, metricNames[i], values[i], i == NUM_METRICS - 1);
+	}
+	fprintf(file, "  }\n}\n");
+	fclose(file);
+	return 0;
+}
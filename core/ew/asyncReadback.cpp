@@ -0,0 +1,67 @@
+#include "asyncReadback.h"
+#include "external/glad.h"
+
+namespace ew {
+	AsyncReadback::AsyncReadback(size_t size)
+		: m_size(size), m_result(size, 0)
+	{
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, m_size * NUM_SLOTS, NULL, GL_STREAM_READ);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	AsyncReadback::~AsyncReadback()
+	{
+		for (void* fence : m_fences)
+		{
+			if (fence != nullptr) {
+				glDeleteSync((GLsync)fence);
+			}
+		}
+		glDeleteBuffers(1, &m_buffer);
+	}
+
+	/// <summary>
+	/// A slot still in flight when it comes round again is overwritten. Its copy is ordered before the new one,
+	/// so nothing is lost but that result.
+	/// </summary>
+	void AsyncReadback::copy(unsigned int buffer, size_t offset)
+	{
+		int slot = m_next;
+		m_next = (m_next + 1) % NUM_SLOTS;
+		if (m_fences[slot] != nullptr) {
+			glDeleteSync((GLsync)m_fences[slot]);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, m_size * slot, m_size);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		m_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		poll();
+	}
+
+	/// <summary>
+	/// Checks slots oldest first, so the last one read is the newest finished copy
+	/// </summary>
+	void AsyncReadback::poll()
+	{
+		for (int i = 0; i < NUM_SLOTS; i++)
+		{
+			int slot = (m_next + i) % NUM_SLOTS;
+			if (m_fences[slot] == nullptr) {
+				continue;
+			}
+			GLenum result = glClientWaitSync((GLsync)m_fences[slot], 0, 0);
+			if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+				continue;
+			}
+			glDeleteSync((GLsync)m_fences[slot]);
+			m_fences[slot] = nullptr;
+			glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, m_size * slot, m_size, m_result.data());
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+namespace ew {
+	//Reads a few bytes of a GPU buffer back without stalling. Each copy() goes into its own slot behind a fence,
+	//and the newest slot whose fence has signaled becomes the result, so values lag by up to NUM_SLOTS copies.
+	//Meant for counters shown as stats, where a frame or two of delay doesn't matter.
+	class AsyncReadback {
+	public:
+		static const int NUM_SLOTS = 3;
+
+		AsyncReadback(size_t size);
+		~AsyncReadback();
+		AsyncReadback(const AsyncReadback&) = delete;
+		AsyncReadback& operator=(const AsyncReadback&) = delete;
+		//Queues a copy of size bytes starting at offset in buffer, then picks up any earlier copies that finished
+		void copy(unsigned int buffer, size_t offset);
+		//Zero until the first copy has finished
+		template<typename T>
+		inline T get(size_t offset = 0)const {
+			T value;
+			memcpy(&value, m_result.data() + offset, sizeof(T));
+			return value;
+		}
+	private:
+		void poll();
+
+		size_t m_size;
+		unsigned int m_buffer = 0; //NUM_SLOTS * size bytes
+		void* m_fences[NUM_SLOTS] = {}; //GLsync per slot, null once read
+		int m_next = 0;
+		std::vector<unsigned char> m_result;
+	};
+}
@@ -0,0 +1,607 @@
+#include "blockCompression.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace ew {
+	const char* getBlockFormatName(BlockFormat format)
+	{
+		switch (format) {
+		case BlockFormat::BC1:
+			return "BC1";
+		case BlockFormat::BC3:
+			return "BC3";
+		case BlockFormat::BC5:
+			return "BC5";
+		default:
+			return "BC7";
+		}
+	}
+
+	size_t getBlockSize(BlockFormat format)
+	{
+		return format == BlockFormat::BC1 ? 8 : 16;
+	}
+
+	size_t getCompressedSize(BlockFormat format, int width, int height)
+	{
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+	}
+
+	static int clampInt(int v, int min, int max) {
+		return v < min ? min : (v > max ? max : v);
+	}
+
+	/// <summary>
+	/// Mean and principal axis of n points with dims components, by power iteration on the covariance matrix.
+	/// The axis is unit length, or zero if every point is the same.
+	/// </summary>
+	static void principalAxis(const float* points, int n, int dims, float* mean, float* axis) {
+		for (int d = 0; d < dims; d++)
+		{
+			mean[d] = 0.0f;
+			for (int i = 0; i < n; i++)
+			{
+				mean[d] += points[i * dims + d];
+			}
+			mean[d] /= n;
+		}
+		float covariance[4][4] = {};
+		for (int i = 0; i < n; i++)
+		{
+			for (int a = 0; a < dims; a++)
+			{
+				for (int b = 0; b < dims; b++)
+				{
+					covariance[a][b] += (points[i * dims + a] - mean[a]) * (points[i * dims + b] - mean[b]);
+				}
+			}
+		}
+		for (int d = 0; d < dims; d++)
+		{
+			axis[d] = 1.0f;
+		}
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (int a = 0; a < dims; a++)
+			{
+				for (int b = 0; b < dims; b++)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length += next[a] * next[a];
+			}
+			length = sqrtf(length);
+			for (int d = 0; d < dims; d++)
+			{
+				axis[d] = length > 1e-8f ? next[d] / length : 0.0f;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Endpoints at the extremes of the points projected onto their principal axis, pulled in slightly
+	/// because the extremes are rarely hit exactly after quantization
+	/// </summary>
+	static void fitEndpoints(const float* points, int n, int dims, float* e0, float* e1) {
+		float mean[4], axis[4];
+		principalAxis(points, n, dims, mean, axis);
+		float minT = 0.0f, maxT = 0.0f;
+		for (int i = 0; i < n; i++)
+		{
+			float t = 0.0f;
+			for (int d = 0; d < dims; d++)
+			{
+				t += (points[i * dims + d] - mean[d]) * axis[d];
+			}
+			minT = t < minT ? t : minT;
+			maxT = t > maxT ? t : maxT;
+		}
+		float inset = (maxT - minT) / 32.0f;
+		for (int d = 0; d < dims; d++)
+		{
+			e0[d] = mean[d] + axis[d] * (maxT - inset);
+			e1[d] = mean[d] + axis[d] * (minT + inset);
+		}
+	}
+
+	//----BC1----
+
+	static unsigned short packRGB565(const float* c) {
+		int r = clampInt((int)(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		int g = clampInt((int)(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		int b = clampInt((int)(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return (unsigned short)((r << 11) | (g << 5) | b);
+	}
+
+	static void unpackRGB565(unsigned short c, int* rgb) {
+		int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	static void bc1Palette(unsigned short c0, unsigned short c1, int palette[4][4]) {
+		unpackRGB565(c0, palette[0]);
+		unpackRGB565(c1, palette[1]);
+		palette[0][3] = palette[1][3] = 255;
+		palette[2][3] = palette[3][3] = 255;
+		for (int i = 0; i < 3; i++)
+		{
+			if (c0 > c1) {
+				palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+				palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+			}
+			else {
+				palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+				palette[3][i] = 0;
+			}
+		}
+		if (c0 <= c1) {
+			palette[3][3] = 0;
+		}
+	}
+
+	//Nearest palette entry per texel, returns the total squared error
+	static int bc1Indices(const float* colors, unsigned short c0, unsigned short c1, unsigned int* indices) {
+		int palette[4][4];
+		bc1Palette(c0, c1, palette);
+		int error = 0;
+		*indices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = 0x7fffffff;
+			for (int p = 0; p < 4; p++)
+			{
+				int e = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int d = (int)colors[i * 3 + c] - palette[p][c];
+					e += d * d;
+				}
+				if (e < bestError) {
+					bestError = e;
+					best = p;
+				}
+			}
+			error += bestError;
+			*indices |= best << (i * 2);
+		}
+		return error;
+	}
+
+	/// <summary>
+	/// Least squares endpoints for fixed indices, each texel is a known blend of the two endpoints
+	/// </summary>
+	static bool refineBC1(const float* colors, unsigned int indices, float* e0, float* e1) {
+		static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa = 0, ab = 0, bb = 0;
+		float ax[3] = {}, bx[3] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			float a = weights[(indices >> (i * 2)) & 3];
+			float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < 3; c++)
+			{
+				ax[c] += a * colors[i * 3 + c];
+				bx[c] += b * colors[i * 3 + c];
+			}
+		}
+		float det = aa * bb - ab * ab;
+		if (fabsf(det) < 1e-6f) {
+			return false;
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+			e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+		}
+		return true;
+	}
+
+	static void writeBC1(unsigned short c0, unsigned short c1, unsigned int indices, unsigned char* block) {
+		block[0] = c0 & 0xff;
+		block[1] = c0 >> 8;
+		block[2] = c1 & 0xff;
+		block[3] = c1 >> 8;
+		for (int i = 0; i < 4; i++)
+		{
+			block[4 + i] = (indices >> (i * 8)) & 0xff;
+		}
+	}
+
+	/// <summary>
+	/// Principal axis endpoints, then one least squares refinement. Always uses the 4 color mode, so it's valid inside BC3.
+	/// </summary>
+	void encodeBC1Block(const unsigned char* rgba, unsigned char* block)
+	{
+		float colors[16 * 3];
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				colors[i * 3 + c] = rgba[i * 4 + c];
+			}
+		}
+		float e0[3], e1[3];
+		fitEndpoints(colors, 16, 3, e0, e1);
+		unsigned short c0 = packRGB565(e0), c1 = packRGB565(e1);
+		if (c0 == c1) {
+			writeBC1(c0, c1, 0, block);
+			return;
+		}
+		if (c0 < c1) {
+			unsigned short t = c0; c0 = c1; c1 = t;
+		}
+		unsigned int indices;
+		int error = bc1Indices(colors, c0, c1, &indices);
+
+		if (refineBC1(colors, indices, e0, e1)) {
+			unsigned short r0 = packRGB565(e0), r1 = packRGB565(e1);
+			if (r0 < r1) {
+				unsigned short t = r0; r0 = r1; r1 = t;
+			}
+			unsigned int refinedIndices;
+			if (r0 != r1 && bc1Indices(colors, r0, r1, &refinedIndices) < error) {
+				c0 = r0;
+				c1 = r1;
+				indices = refinedIndices;
+			}
+		}
+		writeBC1(c0, c1, indices, block);
+	}
+
+	void decodeBC1Block(const unsigned char* block, unsigned char* rgba)
+	{
+		unsigned short c0 = block[0] | (block[1] << 8);
+		unsigned short c1 = block[2] | (block[3] << 8);
+		unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+		int palette[4][4];
+		bc1Palette(c0, c1, palette);
+		for (int i = 0; i < 16; i++)
+		{
+			int index = (indices >> (i * 2)) & 3;
+			for (int c = 0; c < 4; c++)
+			{
+				rgba[i * 4 + c] = (unsigned char)palette[index][c];
+			}
+		}
+	}
+
+	//----BC4----
+
+	static void bc4Palette(int a0, int a1, int* palette) {
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1) {
+			for (int i = 1; i < 7; i++)
+			{
+				palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+			}
+		}
+		else {
+			for (int i = 1; i < 5; i++)
+			{
+				palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	/// <summary>
+	/// Single channel block with the channel's min and max as endpoints and 8 interpolated values
+	/// </summary>
+	/// <param name="values">First texel's value, the next is stride bytes after it</param>
+	void encodeBC4Block(const unsigned char* values, int stride, unsigned char* block)
+	{
+		int a0 = 0, a1 = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			int v = values[i * stride];
+			a0 = v > a0 ? v : a0;
+			a1 = v < a1 ? v : a1;
+		}
+		int palette[8];
+		bc4Palette(a0, a1, palette);
+		unsigned long long indices = 0;
+		if (a0 != a1) {
+			for (int i = 0; i < 16; i++)
+			{
+				int v = values[i * stride];
+				int best = 0, bestError = 256;
+				for (int p = 0; p < 8; p++)
+				{
+					int e = abs(v - palette[p]);
+					if (e < bestError) {
+						bestError = e;
+						best = p;
+					}
+				}
+				indices |= (unsigned long long)best << (i * 3);
+			}
+		}
+		block[0] = (unsigned char)a0;
+		block[1] = (unsigned char)a1;
+		for (int i = 0; i < 6; i++)
+		{
+			block[2 + i] = (indices >> (i * 8)) & 0xff;
+		}
+	}
+
+	void decodeBC4Block(const unsigned char* block, unsigned char* values, int stride)
+	{
+		int palette[8];
+		bc4Palette(block[0], block[1], palette);
+		unsigned long long indices = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			indices |= (unsigned long long)block[2 + i] << (i * 8);
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			values[i * stride] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+		}
+	}
+
+	//----BC7 mode 6----
+
+	static const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BitWriter {
+		unsigned char* data;
+		int position = 0;
+		void write(unsigned int value, int bits) {
+			for (int i = 0; i < bits; i++, position++)
+			{
+				if ((value >> i) & 1) {
+					data[position >> 3] |= 1 << (position & 7);
+				}
+			}
+		}
+	};
+
+	struct BitReader {
+		const unsigned char* data;
+		int position = 0;
+		unsigned int read(int bits) {
+			unsigned int value = 0;
+			for (int i = 0; i < bits; i++, position++)
+			{
+				value |= ((data[position >> 3] >> (position & 7)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	//Nearest of the 16 interpolated colors per texel for 8 bit endpoints, returns the total squared error
+	static int bc7Indices(const int* texels, const int* e0, const int* e1, int* indices) {
+		int palette[16][4];
+		for (int p = 0; p < 16; p++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				palette[p][c] = ((64 - BC7_WEIGHTS4[p]) * e0[c] + BC7_WEIGHTS4[p] * e1[c] + 32) >> 6;
+			}
+		}
+		int error = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = 0x7fffffff;
+			for (int p = 0; p < 16; p++)
+			{
+				int e = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					int d = texels[i * 4 + c] - palette[p][c];
+					e += d * d;
+				}
+				if (e < bestError) {
+					bestError = e;
+					best = p;
+				}
+			}
+			error += bestError;
+			indices[i] = best;
+		}
+		return error;
+	}
+
+	/// <summary>
+	/// Mode 6: RGBA endpoints with 7 bits per channel plus a shared low bit per endpoint, and 16 interpolation steps.
+	/// All four combinations of the low bits are tried.
+	/// </summary>
+	void encodeBC7Block(const unsigned char* rgba, unsigned char* block)
+	{
+		float points[16 * 4];
+		int texels[16 * 4];
+		for (int i = 0; i < 16 * 4; i++)
+		{
+			points[i] = rgba[i];
+			texels[i] = rgba[i];
+		}
+		float e0[4], e1[4];
+		fitEndpoints(points, 16, 4, e0, e1);
+
+		int bestError = 0x7fffffff;
+		int bestQ0[4] = {}, bestQ1[4] = {}, bestP0 = 0, bestP1 = 0, bestIndices[16] = {};
+		for (int p = 0; p < 4; p++)
+		{
+			int p0 = p & 1, p1 = p >> 1;
+			int q0[4], q1[4], full0[4], full1[4];
+			for (int c = 0; c < 4; c++)
+			{
+				q0[c] = clampInt((int)floorf((e0[c] - p0) / 2.0f + 0.5f), 0, 127);
+				q1[c] = clampInt((int)floorf((e1[c] - p1) / 2.0f + 0.5f), 0, 127);
+				full0[c] = (q0[c] << 1) | p0;
+				full1[c] = (q1[c] << 1) | p1;
+			}
+			int indices[16];
+			int error = bc7Indices(texels, full0, full1, indices);
+			if (error < bestError) {
+				bestError = error;
+				memcpy(bestQ0, q0, sizeof(q0));
+				memcpy(bestQ1, q1, sizeof(q1));
+				memcpy(bestIndices, indices, sizeof(indices));
+				bestP0 = p0;
+				bestP1 = p1;
+			}
+		}
+
+		//The first texel's index is stored without its top bit, so it must be below 8
+		if (bestIndices[0] >= 8) {
+			for (int c = 0; c < 4; c++)
+			{
+				int t = bestQ0[c]; bestQ0[c] = bestQ1[c]; bestQ1[c] = t;
+			}
+			int t = bestP0; bestP0 = bestP1; bestP1 = t;
+			for (int i = 0; i < 16; i++)
+			{
+				bestIndices[i] = 15 - bestIndices[i];
+			}
+		}
+
+		memset(block, 0, 16);
+		BitWriter writer = { block };
+		writer.write(1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			writer.write(bestQ0[c], 7);
+			writer.write(bestQ1[c], 7);
+		}
+		writer.write(bestP0, 1);
+		writer.write(bestP1, 1);
+		for (int i = 0; i < 16; i++)
+		{
+			writer.write(bestIndices[i], i == 0 ? 3 : 4);
+		}
+	}
+
+	void decodeBC7Block(const unsigned char* block, unsigned char* rgba)
+	{
+		BitReader reader = { block };
+		int mode = 0;
+		while (mode < 8 && reader.read(1) == 0) {
+			mode++;
+		}
+		if (mode != 6) {
+			for (int i = 0; i < 16; i++)
+			{
+				rgba[i * 4 + 0] = 255;
+				rgba[i * 4 + 1] = 0;
+				rgba[i * 4 + 2] = 255;
+				rgba[i * 4 + 3] = 255;
+			}
+			return;
+		}
+		int e0[4], e1[4];
+		for (int c = 0; c < 4; c++)
+		{
+			e0[c] = reader.read(7) << 1;
+			e1[c] = reader.read(7) << 1;
+		}
+		int p0 = reader.read(1), p1 = reader.read(1);
+		for (int c = 0; c < 4; c++)
+		{
+			e0[c] |= p0;
+			e1[c] |= p1;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			int w = BC7_WEIGHTS4[reader.read(i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; c++)
+			{
+				rgba[i * 4 + c] = (unsigned char)(((64 - w) * e0[c] + w * e1[c] + 32) >> 6);
+			}
+		}
+	}
+
+	//----Images----
+
+	std::vector<unsigned char> compressImage(const unsigned char* rgba, int width, int height, BlockFormat format)
+	{
+		int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		size_t blockSize = getBlockSize(format);
+		std::vector<unsigned char> result(blocksX * blocksY * blockSize);
+		unsigned char texels[16 * 4];
+		for (int by = 0; by < blocksY; by++)
+		{
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				for (int i = 0; i < 16; i++)
+				{
+					int x = clampInt(bx * 4 + (i & 3), 0, width - 1);
+					int y = clampInt(by * 4 + (i >> 2), 0, height - 1);
+					memcpy(&texels[i * 4], &rgba[((size_t)y * width + x) * 4], 4);
+				}
+				unsigned char* block = &result[((size_t)by * blocksX + bx) * blockSize];
+				switch (format) {
+				case BlockFormat::BC1:
+					encodeBC1Block(texels, block);
+					break;
+				case BlockFormat::BC3:
+					encodeBC4Block(texels + 3, 4, block);
+					encodeBC1Block(texels, block + 8);
+					break;
+				case BlockFormat::BC5:
+					encodeBC4Block(texels, 4, block);
+					encodeBC4Block(texels + 1, 4, block + 8);
+					break;
+				case BlockFormat::BC7:
+					encodeBC7Block(texels, block);
+					break;
+				}
+			}
+		}
+		return result;
+	}
+
+	std::vector<unsigned char> decompressImage(const unsigned char* data, int width, int height, BlockFormat format)
+	{
+		int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		size_t blockSize = getBlockSize(format);
+		std::vector<unsigned char> result((size_t)width * height * 4);
+		unsigned char texels[16 * 4];
+		for (int by = 0; by < blocksY; by++)
+		{
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				const unsigned char* block = &data[((size_t)by * blocksX + bx) * blockSize];
+				switch (format) {
+				case BlockFormat::BC1:
+					decodeBC1Block(block, texels);
+					break;
+				case BlockFormat::BC3:
+					decodeBC1Block(block + 8, texels);
+					decodeBC4Block(block, texels + 3, 4);
+					break;
+				case BlockFormat::BC5:
+					decodeBC4Block(block, texels, 4);
+					decodeBC4Block(block + 8, texels + 1, 4);
+					for (int i = 0; i < 16; i++)
+					{
+						texels[i * 4 + 2] = 0;
+						texels[i * 4 + 3] = 255;
+					}
+					break;
+				case BlockFormat::BC7:
+					decodeBC7Block(block, texels);
+					break;
+				}
+				for (int i = 0; i < 16; i++)
+				{
+					int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+					if (x < width && y < height) {
+						memcpy(&result[((size_t)y * width + x) * 4], &texels[i * 4], 4);
+					}
+				}
+			}
+		}
+		return result;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+
+namespace ew {
+	//Block compressed formats, each encodes 4x4 texel blocks
+	enum class BlockFormat {
+		BC1, //RGB, 8 bytes per block (0.5 bytes per texel)
+		BC3, //RGBA, BC1 color + BC4 alpha, 16 bytes per block
+		BC5, //RG as two BC4 channels, 16 bytes per block. For normal maps.
+		BC7 //RGBA, 16 bytes per block. Only mode 6 is encoded, one 4 bit index per texel and RGBA endpoints.
+	};
+
+	const char* getBlockFormatName(BlockFormat format);
+	size_t getBlockSize(BlockFormat format);
+	//Bytes for a width x height image, partial blocks at the edges count as whole blocks
+	size_t getCompressedSize(BlockFormat format, int width, int height);
+
+	//Encoders take 16 RGBA8 texels in row order and write one block
+	void encodeBC1Block(const unsigned char* rgba, unsigned char* block);
+	void encodeBC4Block(const unsigned char* values, int stride, unsigned char* block);
+	void encodeBC7Block(const unsigned char* rgba, unsigned char* block);
+
+	//Decoders write 16 RGBA8 texels. BC7 blocks that aren't mode 6 decode to magenta.
+	void decodeBC1Block(const unsigned char* block, unsigned char* rgba);
+	void decodeBC4Block(const unsigned char* block, unsigned char* values, int stride);
+	void decodeBC7Block(const unsigned char* block, unsigned char* rgba);
+
+	//Compresses a whole RGBA8 image. Edge blocks repeat the last row and column.
+	std::vector<unsigned char> compressImage(const unsigned char* rgba, int width, int height, BlockFormat format);
+	//Decompresses to RGBA8, e.g. for drivers without S3TC or to measure encoding error
+	std::vector<unsigned char> decompressImage(const unsigned char* data, int width, int height, BlockFormat format);
+}
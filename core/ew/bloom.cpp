@@ -0,0 +1,105 @@
+#include "bloom.h"
+#include "profiler.h"
+#include "external/glad.h"
+#include <glm/glm.hpp>
+
+namespace ew {
+	enum BloomMode {
+		BLOOM_PREFILTER = 0,
+		BLOOM_DOWNSAMPLE = 1,
+		BLOOM_UPSAMPLE = 2
+	};
+
+	/// <summary>
+	/// Loads the bloom compute shader and creates the mip chain
+	/// </summary>
+	/// <param name="bloomShader">File path to the prefilter, downsample and upsample compute shader</param>
+	/// <param name="width">Width of the scene texture</param>
+	/// <param name="height">Height of the scene texture</param>
+	Bloom::Bloom(const std::string& bloomShader, int width, int height)
+		: m_shader(bloomShader)
+	{
+		glGenSamplers(1, &m_sourceSampler);
+		glSamplerParameteri(m_sourceSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glSamplerParameteri(m_sourceSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glSamplerParameteri(m_sourceSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glSamplerParameteri(m_sourceSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		m_width = glm::max(width / 2, 1);
+		m_height = glm::max(height / 2, 1);
+		m_numLevels = 1;
+		while (m_numLevels < MAX_LEVELS && (m_width >> m_numLevels) >= MIN_LEVEL_SIZE && (m_height >> m_numLevels) >= MIN_LEVEL_SIZE) {
+			m_numLevels++;
+		}
+		glGenTextures(1, &m_texture);
+		glBindTexture(GL_TEXTURE_2D, m_texture);
+		glTexStorage2D(GL_TEXTURE_2D, m_numLevels, GL_RGBA16F, m_width, m_height);
+		//Passes read one exact level with textureLod, bilinear within it
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	Bloom::~Bloom()
+	{
+		glDeleteTextures(1, &m_texture);
+		glDeleteSamplers(1, &m_sourceSampler);
+	}
+
+	/// <summary>
+	/// Prefilters into level 0, downsamples to the last level, then upsamples back up adding each level to the one
+	/// above it. Each pass reads one level through a sampler and writes the next as an image, so a pass never
+	/// reads the texels it writes.
+	/// </summary>
+	/// <param name="sceneTexture">HDR scene color</param>
+	void Bloom::generate(unsigned int sceneTexture)
+	{
+		EW_PROFILE_GPU_SCOPE("Bloom");
+		int levels = glm::clamp(numLevels, 1, m_numLevels);
+		//Soft knee curve, see the shader
+		float kneeWidth = glm::max(threshold * knee, 0.0001f);
+
+		m_shader.use();
+		m_shader.setInt("_Src", 0);
+		m_shader.setVec4("_Threshold", threshold, threshold - kneeWidth, 2.0f * kneeWidth, 0.25f / kneeWidth);
+		glActiveTexture(GL_TEXTURE0);
+
+		glBindSampler(0, m_sourceSampler);
+		glBindTexture(GL_TEXTURE_2D, sceneTexture);
+		glBindImageTexture(0, m_texture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+		m_shader.setInt("_Mode", BLOOM_PREFILTER);
+		m_shader.setFloat("_SrcLod", 0.0f);
+		m_shader.dispatch((m_width + 7) / 8, (m_height + 7) / 8);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+		glBindSampler(0, 0);
+		glBindTexture(GL_TEXTURE_2D, m_texture);
+		m_shader.setInt("_Mode", BLOOM_DOWNSAMPLE);
+		for (int level = 1; level < levels; level++)
+		{
+			glBindImageTexture(0, m_texture, level, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+			m_shader.setFloat("_SrcLod", (float)(level - 1));
+			m_shader.dispatch(((m_width >> level) + 7) / 8, ((m_height >> level) + 7) / 8);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		}
+
+		m_shader.setInt("_Mode", BLOOM_UPSAMPLE);
+		for (int level = levels - 2; level >= 0; level--)
+		{
+			glBindImageTexture(0, m_texture, level, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+			m_shader.setFloat("_SrcLod", (float)(level + 1));
+			m_shader.dispatch(((m_width >> level) + 7) / 8, ((m_height >> level) + 7) / 8);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	void Bloom::bindTexture(const Shader& shader, int textureUnit) const
+	{
+		glActiveTexture(GL_TEXTURE0 + textureUnit);
+		glBindTexture(GL_TEXTURE_2D, m_texture);
+		shader.setInt("_Bloom", textureUnit);
+	}
+}
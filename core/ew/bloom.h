@@ -0,0 +1,38 @@
+#pragma once
+#include "shader.h"
+
+namespace ew {
+	//Mip chain bloom for an HDR scene texture. Bright pixels are thresholded into a half resolution texture and
+	//downsampled level by level, then each level is upsampled and added to the one above it. Every pass is a
+	//small dual filter kernel whose taps land between texels, so the blur radius comes from the chain depth and
+	//each level costs a quarter of the one above it.
+	class Bloom {
+	public:
+		static const int MAX_LEVELS = 8;
+		//Levels smaller than this aren't worth a dispatch
+		static const int MIN_LEVEL_SIZE = 4;
+
+		//Sized for one scene size, create a new Bloom if the scene target is recreated
+		Bloom(const std::string& bloomShader, int width, int height);
+		~Bloom();
+		Bloom(const Bloom&) = delete;
+		Bloom& operator=(const Bloom&) = delete;
+		//Fills the chain from sceneTexture, which should be the size given to the constructor
+		void generate(unsigned int sceneTexture);
+		//Binds the result to textureUnit and sets the _Bloom sampler
+		void bindTexture(const Shader& shader, int textureUnit)const;
+		inline unsigned int getTexture()const { return m_texture; }
+		inline int getNumLevels()const { return m_numLevels; }
+
+		float threshold = 1.0f; //Linear brightness bloom starts at
+		float knee = 0.5f; //Width of the soft transition below the threshold, 0 is a hard cut
+		int numLevels = 6; //Requested depth, clamped so the smallest level stays above MIN_LEVEL_SIZE
+	private:
+		ew::Shader m_shader;
+		unsigned int m_texture = 0; //RGBA16F, level 0 is half the scene size
+		unsigned int m_sourceSampler = 0; //Clamped bilinear for the scene texture, which may repeat
+		int m_width = 0; //Level 0
+		int m_height = 0;
+		int m_numLevels = 0; //Allocated
+	};
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <glm/glm.hpp>
+
+namespace ew {
+	struct AABB {
+		glm::vec3 min = glm::vec3(0.0f);
+		glm::vec3 max = glm::vec3(0.0f);
+
+		inline glm::vec3 center()const { return (min + max) * 0.5f; }
+		inline glm::vec3 extents()const { return (max - min) * 0.5f; }
+		inline void expand(const glm::vec3& p) {
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+		}
+		inline void expand(const AABB& other) {
+			min = glm::min(min, other.min);
+			max = glm::max(max, other.max);
+		}
+		//Box enclosing this box after transformation (Arvo's method)
+		inline AABB transformed(const glm::mat4& m)const {
+			glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+			glm::vec3 e = extents();
+			glm::vec3 worldExtents = glm::abs(glm::vec3(m[0])) * e.x + glm::abs(glm::vec3(m[1])) * e.y + glm::abs(glm::vec3(m[2])) * e.z;
+			AABB result;
+			result.min = c - worldExtents;
+			result.max = c + worldExtents;
+			return result;
+		}
+	};
+
+	struct Ray {
+		glm::vec3 origin = glm::vec3(0.0f);
+		glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f); //Doesn't need to be normalized, t is in units of its length
+	};
+
+	struct BoundingSphere {
+		glm::vec3 center = glm::vec3(0.0f);
+		float radius = 0.0f;
+
+		//Sphere enclosing this sphere after transformation. Non-uniform scale uses the largest axis.
+		inline BoundingSphere transformed(const glm::mat4& m)const {
+			BoundingSphere result;
+			result.center = glm::vec3(m * glm::vec4(center, 1.0f));
+			float scale = glm::max(glm::max(glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1]))), glm::length(glm::vec3(m[2])));
+			result.radius = radius * scale;
+			return result;
+		}
+	};
+
+	//Closest point on the box is within the sphere's radius
+	inline bool intersects(const AABB& box, const BoundingSphere& sphere) {
+		glm::vec3 closest = glm::clamp(sphere.center, box.min, box.max);
+		glm::vec3 offset = closest - sphere.center;
+		return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+	}
+}
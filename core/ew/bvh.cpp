@@ -0,0 +1,421 @@
+#include "bvh.h"
+#include "profiler.h"
+#include <algorithm>
+
+namespace ew {
+	static float surfaceArea(const glm::vec3& min, const glm::vec3& max) {
+		glm::vec3 d = max - min;
+		return d.x * d.y + d.y * d.z + d.z * d.x;
+	}
+
+	/// <summary>
+	/// Slab test against precomputed 1 / direction. Returns the entry distance, or -1 on a miss.
+	/// </summary>
+	static float rayBoxEntry(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& invDir, float maxT) {
+		glm::vec3 t1 = (min - origin) * invDir;
+		glm::vec3 t2 = (max - origin) * invDir;
+		glm::vec3 tNear = glm::min(t1, t2);
+		glm::vec3 tFar = glm::max(t1, t2);
+		float entry = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+		float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxT));
+		return entry <= exit ? entry : -1.0f;
+	}
+
+	bool intersectRay(const AABB& box, const Ray& ray, float maxT, float* t) {
+		float entry = rayBoxEntry(box.min, box.max, ray.origin, 1.0f / ray.direction, maxT);
+		if (entry < 0.0f) {
+			return false;
+		}
+		*t = entry;
+		return true;
+	}
+
+	/// <summary>
+	/// Moves the ray into the box's local space instead of transforming the box, so rotated boxes
+	/// stay tight. The local direction isn't renormalized, which keeps t comparable with world space hits.
+	/// </summary>
+	bool intersectRay(const AABB& localBox, const glm::mat4& model, const Ray& ray, float maxT, float* t) {
+		glm::mat4 invModel = glm::inverse(model);
+		Ray localRay;
+		localRay.origin = glm::vec3(invModel * glm::vec4(ray.origin, 1.0f));
+		localRay.direction = glm::vec3(invModel * glm::vec4(ray.direction, 0.0f));
+		return intersectRay(localBox, localRay, maxT, t);
+	}
+
+	/// <summary>
+	/// Builds the tree from scratch. Use refit() instead when only positions changed.
+	/// </summary>
+	/// <param name="bounds">World space bounds, one per object</param>
+	void BVH::build(const std::vector<AABB>& bounds)
+	{
+		EW_PROFILE_SCOPE("BVH build");
+		m_nodes.clear();
+		m_objectIndices.resize(bounds.size());
+		m_leafBounds.resize(bounds.size());
+		if (bounds.empty()) {
+			return;
+		}
+		//Partitioning a contiguous copy keeps every pass over a node's objects linear in memory
+		std::vector<BuildEntry> entries(bounds.size());
+		for (size_t i = 0; i < bounds.size(); i++)
+		{
+			entries[i].bounds = bounds[i];
+			entries[i].centroid = bounds[i].center();
+			entries[i].object = i;
+		}
+		//A binary tree with n leaves never has more than 2n - 1 nodes
+		m_nodes.reserve(bounds.size() * 2 - 1);
+		m_nodes.push_back(BVHNode());
+		buildNode(0, 0, bounds.size(), entries);
+		m_nodes.shrink_to_fit();
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			m_objectIndices[i] = entries[i].object;
+			m_leafBounds[i] = entries[i].bounds;
+		}
+	}
+
+	/// <summary>
+	/// Fills in a node for entries [first, first + count) and recursively splits it where the
+	/// surface area heuristic says it's cheaper than a leaf
+	/// </summary>
+	void BVH::buildNode(unsigned int nodeIndex, unsigned int first, unsigned int count, std::vector<BuildEntry>& entries)
+	{
+		AABB nodeBounds = entries[first].bounds;
+		glm::vec3 centroidMin = entries[first].centroid;
+		glm::vec3 centroidMax = centroidMin;
+		for (unsigned int i = first + 1; i < first + count; i++)
+		{
+			nodeBounds.expand(entries[i].bounds);
+			centroidMin = glm::min(centroidMin, entries[i].centroid);
+			centroidMax = glm::max(centroidMax, entries[i].centroid);
+		}
+		m_nodes[nodeIndex].min = nodeBounds.min;
+		m_nodes[nodeIndex].max = nodeBounds.max;
+		m_nodes[nodeIndex].leftOrFirst = first;
+		m_nodes[nodeIndex].count = count;
+		if (count == 1) {
+			return;
+		}
+
+		//Bin centroids along each axis and sweep for the cheapest split plane
+		struct Bin {
+			glm::vec3 min = glm::vec3(FLT_MAX);
+			glm::vec3 max = glm::vec3(-FLT_MAX);
+			unsigned int count = 0;
+		};
+		//Small nodes don't need more bins than objects
+		unsigned int numBins = glm::min(count, SAH_BINS);
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		unsigned int bestSplit = 0;
+		glm::vec3 centroidExtent = centroidMax - centroidMin;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (centroidExtent[axis] <= 0.0f) {
+				continue;
+			}
+			Bin bins[SAH_BINS];
+			float scale = numBins / centroidExtent[axis];
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				unsigned int b = glm::min((unsigned int)((entries[i].centroid[axis] - centroidMin[axis]) * scale), numBins - 1);
+				bins[b].count++;
+				bins[b].min = glm::min(bins[b].min, entries[i].bounds.min);
+				bins[b].max = glm::max(bins[b].max, entries[i].bounds.max);
+			}
+			//rightCost[i] is the cost of bins (i, numBins)
+			float rightCost[SAH_BINS];
+			Bin right;
+			for (unsigned int i = numBins - 1; i > 0; i--)
+			{
+				right.count += bins[i].count;
+				right.min = glm::min(right.min, bins[i].min);
+				right.max = glm::max(right.max, bins[i].max);
+				rightCost[i - 1] = right.count > 0 ? right.count * surfaceArea(right.min, right.max) : 0.0f;
+			}
+			Bin left;
+			for (unsigned int i = 0; i < numBins - 1; i++)
+			{
+				left.count += bins[i].count;
+				left.min = glm::min(left.min, bins[i].min);
+				left.max = glm::max(left.max, bins[i].max);
+				if (left.count == 0 || left.count == count) {
+					continue;
+				}
+				float cost = left.count * surfaceArea(left.min, left.max) + rightCost[i];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i;
+				}
+			}
+		}
+
+		//Traversing a node costs about as much as testing one object
+		float area = surfaceArea(nodeBounds.min, nodeBounds.max);
+		float leafCost = count * area;
+		unsigned int mid = first + count / 2;
+		if (bestAxis < 0) {
+			//Every centroid is in the same place, no plane can separate them
+			if (count <= MAX_LEAF_SIZE) {
+				return;
+			}
+		}
+		else {
+			if (bestCost + area >= leafCost && count <= MAX_LEAF_SIZE) {
+				return;
+			}
+			float scale = numBins / centroidExtent[bestAxis];
+			float axisMin = centroidMin[bestAxis];
+			BuildEntry* split = std::partition(entries.data() + first, entries.data() + first + count,
+				[&](const BuildEntry& entry) {
+					return glm::min((unsigned int)((entry.centroid[bestAxis] - axisMin) * scale), numBins - 1) <= bestSplit;
+				});
+			mid = split - entries.data();
+		}
+
+		unsigned int leftIndex = m_nodes.size();
+		m_nodes.push_back(BVHNode());
+		buildNode(leftIndex, first, mid - first, entries);
+		unsigned int rightIndex = m_nodes.size();
+		m_nodes.push_back(BVHNode());
+		buildNode(rightIndex, mid, first + count - mid, entries);
+		m_nodes[nodeIndex].leftOrFirst = rightIndex;
+		m_nodes[nodeIndex].count = 0;
+	}
+
+	/// <summary>
+	/// Recomputes every node's bounds bottom up. Children are always stored after their parent,
+	/// so this is a single reverse pass over the node array.
+	/// </summary>
+	/// <param name="bounds">New bounds, indexed the same way as in build()</param>
+	void BVH::refit(const std::vector<AABB>& bounds)
+	{
+		EW_PROFILE_SCOPE("BVH refit");
+		for (size_t i = m_nodes.size(); i-- > 0;)
+		{
+			BVHNode& node = m_nodes[i];
+			if (node.isLeaf()) {
+				m_leafBounds[node.leftOrFirst] = bounds[m_objectIndices[node.leftOrFirst]];
+				AABB leafBounds = m_leafBounds[node.leftOrFirst];
+				for (unsigned int j = node.leftOrFirst + 1; j < node.leftOrFirst + node.count; j++)
+				{
+					m_leafBounds[j] = bounds[m_objectIndices[j]];
+					leafBounds.expand(m_leafBounds[j]);
+				}
+				node.min = leafBounds.min;
+				node.max = leafBounds.max;
+			}
+			else {
+				const BVHNode& left = m_nodes[i + 1];
+				const BVHNode& right = m_nodes[node.leftOrFirst];
+				node.min = glm::min(left.min, right.min);
+				node.max = glm::max(left.max, right.max);
+			}
+		}
+	}
+
+	//Per frustum traversal state. Low 6 bits are planes that still need testing, the box is fully inside the rest.
+	static const unsigned char ALL_PLANES = 0x3F;
+	static const unsigned char FRUSTUM_ACTIVE = 0x40;
+
+	/// <summary>
+	/// Tests a box against the planes left in mask
+	/// </summary>
+	/// <returns>-1 if the box is fully outside a plane, otherwise mask without the planes it is fully inside of</returns>
+	static int classifyBox(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max, int mask) {
+		glm::vec3 center = (min + max) * 0.5f;
+		glm::vec3 extents = (max - min) * 0.5f;
+		for (int p = 0; p < 6; p++)
+		{
+			if (!(mask & (1 << p))) {
+				continue;
+			}
+			glm::vec3 n = glm::vec3(frustum.planes[p]);
+			float d = glm::dot(n, center) + frustum.planes[p].w;
+			float r = glm::dot(glm::abs(n), extents);
+			if (d < -r) {
+				return -1;
+			}
+			if (d >= r) {
+				mask &= ~(1 << p);
+			}
+		}
+		return mask;
+	}
+
+	/// <summary>
+	/// Culls against several frustums (e.g. camera and shadow) in one walk of the tree. Each frustum keeps
+	/// its own plane mask, so subtrees fully inside a plane skip it and subtrees fully inside a frustum
+	/// are accepted without further tests.
+	/// </summary>
+	/// <param name="frustums">Up to MAX_QUERY_FRUSTUMS frustums</param>
+	/// <param name="numFrustums">Number of frustums and result vectors</param>
+	/// <param name="results">Cleared and filled with visible object indices, one vector per frustum</param>
+	void BVH::queryFrustums(const Frustum* frustums, int numFrustums, std::vector<unsigned int>* results) const
+	{
+		numFrustums = glm::min(numFrustums, MAX_QUERY_FRUSTUMS);
+		for (int f = 0; f < numFrustums; f++)
+		{
+			results[f].clear();
+		}
+		if (m_nodes.empty()) {
+			return;
+		}
+		struct Entry {
+			unsigned int node;
+			unsigned char masks[MAX_QUERY_FRUSTUMS];
+		};
+		std::vector<Entry> stack;
+		stack.reserve(64);
+		Entry root;
+		root.node = 0;
+		for (int f = 0; f < MAX_QUERY_FRUSTUMS; f++)
+		{
+			root.masks[f] = f < numFrustums ? (FRUSTUM_ACTIVE | ALL_PLANES) : 0;
+		}
+		stack.push_back(root);
+		while (!stack.empty()) {
+			Entry entry = stack.back();
+			stack.pop_back();
+			const BVHNode& node = m_nodes[entry.node];
+			bool anyActive = false;
+			for (int f = 0; f < numFrustums; f++)
+			{
+				if (entry.masks[f] & ALL_PLANES) {
+					int planes = classifyBox(frustums[f], node.min, node.max, entry.masks[f] & ALL_PLANES);
+					entry.masks[f] = planes < 0 ? 0 : (unsigned char)(FRUSTUM_ACTIVE | planes);
+				}
+				anyActive = anyActive || entry.masks[f] != 0;
+			}
+			if (!anyActive) {
+				continue;
+			}
+			if (!node.isLeaf()) {
+				//Push right first so the left child, which is next in memory, is visited first
+				Entry child = entry;
+				child.node = node.leftOrFirst;
+				stack.push_back(child);
+				child.node = entry.node + 1;
+				stack.push_back(child);
+				continue;
+			}
+			for (int f = 0; f < numFrustums; f++)
+			{
+				int planes = entry.masks[f] & ALL_PLANES;
+				if (!entry.masks[f]) {
+					continue;
+				}
+				for (unsigned int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+				{
+					if (planes == 0 || classifyBox(frustums[f], m_leafBounds[i].min, m_leafBounds[i].max, planes) >= 0) {
+						results[f].push_back(m_objectIndices[i]);
+					}
+				}
+			}
+		}
+	}
+
+	void BVH::queryFrustum(const Frustum& frustum, std::vector<unsigned int>& results) const
+	{
+		queryFrustums(&frustum, 1, &results);
+	}
+
+	/// <summary>
+	/// Finds the nearest object bounds along a ray, visiting near children first and skipping
+	/// nodes farther than the closest hit so far
+	/// </summary>
+	/// <param name="ray">World space ray</param>
+	/// <param name="hit">Filled with the closest object and its entry distance</param>
+	/// <param name="maxT">Ignore hits farther than this</param>
+	/// <returns>True if anything was hit</returns>
+	bool BVH::raycast(const Ray& ray, RayHit* hit, float maxT) const
+	{
+		if (m_nodes.empty()) {
+			return false;
+		}
+		glm::vec3 invDir = 1.0f / ray.direction;
+		bool found = false;
+		float closest = maxT;
+		std::vector<unsigned int> stack;
+		stack.reserve(64);
+		if (rayBoxEntry(m_nodes[0].min, m_nodes[0].max, ray.origin, invDir, closest) >= 0.0f) {
+			stack.push_back(0);
+		}
+		while (!stack.empty()) {
+			const BVHNode& node = m_nodes[stack.back()];
+			unsigned int nodeIndex = stack.back();
+			stack.pop_back();
+			if (node.isLeaf()) {
+				for (unsigned int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+				{
+					float t = rayBoxEntry(m_leafBounds[i].min, m_leafBounds[i].max, ray.origin, invDir, closest);
+					if (t >= 0.0f && (!found || t < closest)) {
+						found = true;
+						closest = t;
+						hit->object = m_objectIndices[i];
+						hit->t = t;
+					}
+				}
+				continue;
+			}
+			//Visit the nearer child first so the farther one is more likely to be pruned
+			unsigned int leftIndex = nodeIndex + 1;
+			unsigned int rightIndex = node.leftOrFirst;
+			float tLeft = rayBoxEntry(m_nodes[leftIndex].min, m_nodes[leftIndex].max, ray.origin, invDir, closest);
+			float tRight = rayBoxEntry(m_nodes[rightIndex].min, m_nodes[rightIndex].max, ray.origin, invDir, closest);
+			if (tLeft >= 0.0f && tRight >= 0.0f && tLeft < tRight) {
+				std::swap(leftIndex, rightIndex);
+				std::swap(tLeft, tRight);
+			}
+			if (tLeft >= 0.0f) {
+				stack.push_back(leftIndex);
+			}
+			if (tRight >= 0.0f) {
+				stack.push_back(rightIndex);
+			}
+		}
+		return found;
+	}
+
+	/// <summary>
+	/// Collects every object whose bounds the ray enters. Useful when hits need a finer test,
+	/// since the nearest box isn't always the nearest surface.
+	/// </summary>
+	void BVH::raycastAll(const Ray& ray, std::vector<RayHit>& hits, float maxT) const
+	{
+		hits.clear();
+		if (m_nodes.empty()) {
+			return;
+		}
+		glm::vec3 invDir = 1.0f / ray.direction;
+		std::vector<unsigned int> stack;
+		stack.reserve(64);
+		stack.push_back(0);
+		while (!stack.empty()) {
+			const BVHNode& node = m_nodes[stack.back()];
+			unsigned int nodeIndex = stack.back();
+			stack.pop_back();
+			if (rayBoxEntry(node.min, node.max, ray.origin, invDir, maxT) < 0.0f) {
+				continue;
+			}
+			if (!node.isLeaf()) {
+				stack.push_back(node.leftOrFirst);
+				stack.push_back(nodeIndex + 1);
+				continue;
+			}
+			for (unsigned int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+			{
+				float t = rayBoxEntry(m_leafBounds[i].min, m_leafBounds[i].max, ray.origin, invDir, maxT);
+				if (t >= 0.0f) {
+					RayHit hit;
+					hit.object = m_objectIndices[i];
+					hit.t = t;
+					hits.push_back(hit);
+				}
+			}
+		}
+		std::sort(hits.begin(), hits.end(), [](const RayHit& a, const RayHit& b) { return a.t < b.t; });
+	}
+}
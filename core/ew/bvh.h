@@ -0,0 +1,64 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <float.h>
+#include "bounds.h"
+#include "frustum.h"
+
+namespace ew {
+	struct RayHit {
+		unsigned int object = 0;
+		float t = 0.0f; //Entry distance along the ray
+	};
+
+	//32 bytes, two nodes per cache line. Stored depth first, so a node's left child always directly follows it.
+	struct BVHNode {
+		glm::vec3 min;
+		unsigned int leftOrFirst; //Interior: index of the right child. Leaf: first entry in the object index list.
+		glm::vec3 max;
+		unsigned int count; //Number of objects in a leaf, 0 for interior nodes
+		inline bool isLeaf()const { return count > 0; }
+	};
+
+	//Slab test. Returns true and the entry distance if the ray hits the box before maxT.
+	bool intersectRay(const AABB& box, const Ray& ray, float maxT, float* t);
+	//Same test against a local space box placed by a model matrix, i.e. an oriented box. t is in world space ray units.
+	bool intersectRay(const AABB& localBox, const glm::mat4& model, const Ray& ray, float maxT, float* t);
+
+	//Bounding volume hierarchy over object AABBs, built with the binned surface area heuristic.
+	//Objects are referred to by their index in the bounds vector passed to build().
+	class BVH {
+	public:
+		static const unsigned int MAX_LEAF_SIZE = 4;
+		static const unsigned int SAH_BINS = 16;
+		//Number of frustums queryFrustums() can test in one traversal
+		static const int MAX_QUERY_FRUSTUMS = 8;
+
+		BVH() {};
+		void build(const std::vector<AABB>& bounds);
+		//Updates node bounds after objects moved without changing the tree. Bounds must be the same size as in build().
+		void refit(const std::vector<AABB>& bounds);
+		//Fills results[i] with the objects whose bounds intersect frustums[i], testing every frustum in one traversal
+		void queryFrustums(const Frustum* frustums, int numFrustums, std::vector<unsigned int>* results)const;
+		void queryFrustum(const Frustum& frustum, std::vector<unsigned int>& results)const;
+		//Closest object whose bounds the ray enters
+		bool raycast(const Ray& ray, RayHit* hit, float maxT = FLT_MAX)const;
+		//Every object whose bounds the ray enters, sorted near to far
+		void raycastAll(const Ray& ray, std::vector<RayHit>& hits, float maxT = FLT_MAX)const;
+		inline unsigned int getNumNodes()const { return m_nodes.size(); }
+		inline unsigned int getNumObjects()const { return m_objectIndices.size(); }
+		inline const std::vector<BVHNode>& getNodes()const { return m_nodes; }
+		inline AABB getBounds()const { return m_nodes.empty() ? AABB() : AABB{ m_nodes[0].min, m_nodes[0].max }; }
+	private:
+		struct BuildEntry {
+			AABB bounds;
+			glm::vec3 centroid;
+			unsigned int object;
+		};
+		void buildNode(unsigned int nodeIndex, unsigned int first, unsigned int count, std::vector<BuildEntry>& entries);
+
+		std::vector<BVHNode> m_nodes;
+		std::vector<unsigned int> m_objectIndices; //Reordered so every leaf owns a contiguous range
+		std::vector<AABB> m_leafBounds; //Object bounds in m_objectIndices order, so leaf tests read linearly
+	};
+}
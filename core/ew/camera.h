@@ -5,6 +5,7 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "bounds.h"
 
 namespace ew {
 	struct Camera {
@@ -42,6 +43,17 @@ namespace ew {
 				return glm::perspective(glm::radians(fov), aspectRatio, nearPlane, farPlane);
 			}
 		}
+		//World space ray through a point in window coordinates (origin top left), starting on the near plane
+		inline Ray screenPointToRay(float x, float y, float screenWidth, float screenHeight)const {
+			glm::vec2 ndc = glm::vec2(x / screenWidth, 1.0f - y / screenHeight) * 2.0f - 1.0f;
+			glm::mat4 invViewProjection = glm::inverse(projectionMatrix() * viewMatrix());
+			glm::vec4 nearPoint = invViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+			glm::vec4 farPoint = invViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+			Ray ray;
+			ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+			ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+			return ray;
+		}
 	};
 
 }
@@ -0,0 +1,87 @@
+#include "cameraPath.h"
+#include <stdio.h>
+
+namespace ew {
+	static glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t) {
+		float t2 = t * t;
+		float t3 = t2 * t;
+		return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+	}
+
+	void CameraPath::addKey(float time, const glm::vec3& position, const glm::vec3& target)
+	{
+		m_keys.push_back({ time, position, target });
+	}
+
+	/// <summary>
+	/// Interpolates between the two keys around time. The keys before and after them shape the curve, the end
+	/// keys are repeated at the ends of the path.
+	/// </summary>
+	void CameraPath::sample(float time, Camera& camera) const
+	{
+		if (m_keys.empty()) {
+			return;
+		}
+		int last = (int)m_keys.size() - 1;
+		if (time <= m_keys[0].time || last == 0) {
+			camera.position = m_keys[0].position;
+			camera.target = m_keys[0].target;
+			return;
+		}
+		if (time >= m_keys[last].time) {
+			camera.position = m_keys[last].position;
+			camera.target = m_keys[last].target;
+			return;
+		}
+		int i = 0;
+		while (i < last - 1 && m_keys[i + 1].time <= time) {
+			i++;
+		}
+		const CameraKey& k0 = m_keys[i > 0 ? i - 1 : 0];
+		const CameraKey& k1 = m_keys[i];
+		const CameraKey& k2 = m_keys[i + 1];
+		const CameraKey& k3 = m_keys[i + 2 <= last ? i + 2 : last];
+		float span = k2.time - k1.time;
+		float t = span > 0.0f ? (time - k1.time) / span : 0.0f;
+		camera.position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+		camera.target = catmullRom(k0.target, k1.target, k2.target, k3.target, t);
+	}
+
+	bool CameraPath::save(const char* filePath) const
+	{
+		FILE* file = fopen(filePath, "w");
+		if (file == NULL) {
+			printf("Failed to open %s for writing\n", filePath);
+			return false;
+		}
+		fprintf(file, "#time px py pz tx ty tz\n");
+		for (const CameraKey& key : m_keys)
+		{
+			fprintf(file, "%.4f %.4f %.4f %.4f %.4f %.4f %.4f\n", key.time,
+				key.position.x, key.position.y, key.position.z, key.target.x, key.target.y, key.target.z);
+		}
+		fclose(file);
+		return true;
+	}
+
+	bool CameraPath::load(const char* filePath)
+	{
+		FILE* file = fopen(filePath, "r");
+		if (file == NULL) {
+			printf("Failed to open camera path %s\n", filePath);
+			return false;
+		}
+		m_keys.clear();
+		char line[256];
+		while (fgets(line, sizeof(line), file) != NULL) {
+			CameraKey key;
+			if (line[0] == '#' || sscanf(line, "%f %f %f %f %f %f %f", &key.time,
+				&key.position.x, &key.position.y, &key.position.z, &key.target.x, &key.target.y, &key.target.z) != 7) {
+				continue;
+			}
+			m_keys.push_back(key);
+		}
+		fclose(file);
+		return !m_keys.empty();
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "camera.h"
+#include <vector>
+
+namespace ew {
+	struct CameraKey {
+		float time; //Seconds from the start of the path
+		glm::vec3 position;
+		glm::vec3 target;
+	};
+
+	//Camera motion recorded from a session or written by hand, so benchmarks and captures see the same views on
+	//every run. Keys are interpolated with Catmull-Rom splines, so a sparse recording still moves smoothly.
+	class CameraPath {
+	public:
+		//Keys must be added in time order
+		void addKey(float time, const glm::vec3& position, const glm::vec3& target);
+		//Sets the camera's position and target at a time, clamped to the path
+		void sample(float time, Camera& camera)const;
+		void clear() { m_keys.clear(); }
+		//One key per line: time px py pz tx ty tz. Lines starting with # are comments.
+		bool save(const char* filePath)const;
+		bool load(const char* filePath);
+		inline float getDuration()const { return m_keys.empty() ? 0.0f : m_keys.back().time; }
+		inline const std::vector<CameraKey>& getKeys()const { return m_keys; }
+	private:
+		std::vector<CameraKey> m_keys;
+	};
+}
@@ -0,0 +1,240 @@
+#include "cascadedShadowMap.h"
+#include "profiler.h"
+#include "external/glad.h"
+#include <stdio.h>
+#include <math.h>
+
+namespace ew {
+	/// <summary>
+	/// Creates a depth texture array with one layer per possible cascade
+	/// </summary>
+	static unsigned int createDepthArray(int resolution, int layers) {
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, resolution, resolution, layers);
+		//Depth comparison with linear filtering gives a bilinear 2x2 PCF result per fetch through a sampler2DArrayShadow
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		//Outside a cascade counts as lit
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		return texture;
+	}
+
+	/// <summary>
+	/// Depth only framebuffer with every layer of the array attached, gl_Layer picks the cascade
+	/// </summary>
+	static unsigned int createLayeredFramebuffer(unsigned int depthArray) {
+		unsigned int fbo;
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			printf("Cascaded shadow map framebuffer incomplete\n");
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return fbo;
+	}
+
+	/// <summary>
+	/// Creates the cascade depth array and a layered framebuffer for it. The static cache is created on first use.
+	/// </summary>
+	/// <param name="resolution">Width and height of each cascade</param>
+	/// <param name="numCascades">Cascades in use, 1 to MAX_CASCADES</param>
+	CascadedShadowMap::CascadedShadowMap(int resolution, int numCascades)
+		: m_resolution(resolution)
+	{
+		setNumCascades(numCascades);
+		for (int i = 0; i < MAX_CASCADES; i++)
+		{
+			m_lightMatrices[i] = glm::mat4(1.0f);
+			m_staticMatrices[i] = glm::mat4(1.0f);
+			m_splits[i] = 0.0f;
+		}
+		m_depthArray = createDepthArray(m_resolution, MAX_CASCADES);
+		m_fbo = createLayeredFramebuffer(m_depthArray);
+	}
+
+	void CascadedShadowMap::setNumCascades(int numCascades)
+	{
+		m_numCascades = glm::clamp(numCascades, 1, MAX_CASCADES);
+		m_staticValid = false;
+	}
+
+	/// <summary>
+	/// Splits the camera's view range with the practical split scheme (a blend of logarithmic and uniform
+	/// splits) and fits a projection to each range
+	/// </summary>
+	/// <param name="camera">Camera whose frustum is covered</param>
+	/// <param name="lightDirection">Direction the light travels in</param>
+	void CascadedShadowMap::update(const Camera& camera, const glm::vec3& lightDirection)
+	{
+		EW_PROFILE_SCOPE("Fit cascades");
+		glm::vec3 direction = glm::normalize(lightDirection);
+		glm::vec3 up = glm::vec3(0, 1, 0);
+		if (glm::abs(glm::dot(direction, up)) >= 0.99f) {
+			up = glm::vec3(0, 0, 1);
+		}
+		m_lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+		float nearDistance = camera.nearPlane;
+		float farDistance = glm::min(shadowDistance, camera.farPlane);
+		float prevSplit = nearDistance;
+		for (int i = 0; i < m_numCascades; i++)
+		{
+			float p = (i + 1) / (float)m_numCascades;
+			float logSplit = nearDistance * powf(farDistance / nearDistance, p);
+			float uniformSplit = nearDistance + (farDistance - nearDistance) * p;
+			m_splits[i] = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+			m_lightMatrices[i] = fitProjection(camera, prevSplit, m_splits[i], true);
+			prevSplit = m_splits[i];
+		}
+		m_cullMatrix = fitProjection(camera, nearDistance, farDistance, false);
+
+		//Snapping keeps matrices identical while the camera is still, so cached cascades stay valid
+		m_staticDirtyMask = 0;
+		for (int i = 0; i < m_numCascades; i++)
+		{
+			if (!m_staticValid || m_lightMatrices[i] != m_staticMatrices[i]) {
+				m_staticDirtyMask |= 1 << i;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Orthographic light projection around the bounding sphere of the camera frustum between two view depths.
+	/// The sphere only depends on the camera's projection, so its size doesn't change as the camera rotates.
+	/// </summary>
+	glm::mat4 CascadedShadowMap::fitProjection(const Camera& camera, float nearDistance, float farDistance, bool snapToTexels) const
+	{
+		//Frustum slice corners in view space
+		glm::vec3 corners[8];
+		float distances[2] = { nearDistance, farDistance };
+		for (int i = 0; i < 2; i++)
+		{
+			float halfHeight = camera.orthographic ? camera.orthoHeight * 0.5f : distances[i] * tanf(glm::radians(camera.fov) * 0.5f);
+			float halfWidth = halfHeight * camera.aspectRatio;
+			corners[i * 4 + 0] = glm::vec3(-halfWidth, -halfHeight, -distances[i]);
+			corners[i * 4 + 1] = glm::vec3(halfWidth, -halfHeight, -distances[i]);
+			corners[i * 4 + 2] = glm::vec3(-halfWidth, halfHeight, -distances[i]);
+			corners[i * 4 + 3] = glm::vec3(halfWidth, halfHeight, -distances[i]);
+		}
+		glm::vec3 center = glm::vec3(0.0f);
+		for (int i = 0; i < 8; i++)
+		{
+			center += corners[i] / 8.0f;
+		}
+		float radius = 0.0f;
+		for (int i = 0; i < 8; i++)
+		{
+			radius = glm::max(radius, glm::length(corners[i] - center));
+		}
+		//Round up so float noise doesn't change the texel size from frame to frame
+		radius = ceilf(radius * 16.0f) / 16.0f;
+
+		glm::mat4 invView = glm::inverse(camera.viewMatrix());
+		glm::vec3 lightCenter = glm::vec3(m_lightView * invView * glm::vec4(center, 1.0f));
+		//Depth is snapped in coarse steps, the near plane is pushed back a step so the sphere stays covered
+		float depthStep = 0.0f;
+		if (snapToTexels) {
+			float texelSize = radius * 2.0f / m_resolution;
+			lightCenter.x = floorf(lightCenter.x / texelSize) * texelSize;
+			lightCenter.y = floorf(lightCenter.y / texelSize) * texelSize;
+			depthStep = radius * 0.25f;
+			lightCenter.z = floorf(lightCenter.z / depthStep) * depthStep;
+		}
+		//Light space looks down -z, so casters between the light and the sphere have smaller distances
+		glm::mat4 projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius,
+			lightCenter.y - radius, lightCenter.y + radius,
+			-lightCenter.z - radius - casterDistance - depthStep, -lightCenter.z + radius);
+		return projection * m_lightView;
+	}
+
+	void CascadedShadowMap::beginRender()
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		glViewport(0, 0, m_resolution, m_resolution);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		m_renderMask = (1 << m_numCascades) - 1;
+	}
+
+	bool CascadedShadowMap::beginStaticRender()
+	{
+		//Clearing single layers needs GL 4.4, without it static casters go straight into the shadow map every frame
+		if (!GLAD_GL_VERSION_4_4) {
+			beginRender();
+			return true;
+		}
+		if (m_staticArray == 0) {
+			m_staticArray = createDepthArray(m_resolution, MAX_CASCADES);
+			m_staticFbo = createLayeredFramebuffer(m_staticArray);
+		}
+		m_renderMask = m_staticDirtyMask;
+		if (m_renderMask == 0) {
+			return false;
+		}
+		//Only the dirty layers are cleared, the rest keep their cached depth
+		float clearDepth = 1.0f;
+		for (int i = 0; i < m_numCascades; i++)
+		{
+			if (m_renderMask & (1 << i)) {
+				glClearTexSubImage(m_staticArray, 0, 0, 0, i, m_resolution, m_resolution, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &clearDepth);
+				m_staticMatrices[i] = m_lightMatrices[i];
+			}
+		}
+		m_staticValid = true;
+		m_staticDirtyMask = 0;
+		glBindFramebuffer(GL_FRAMEBUFFER, m_staticFbo);
+		glViewport(0, 0, m_resolution, m_resolution);
+		return true;
+	}
+
+	void CascadedShadowMap::beginDynamicRender()
+	{
+		//Without a static cache beginStaticRender already cleared the shadow map
+		if (GLAD_GL_VERSION_4_4) {
+			glCopyImageSubData(m_staticArray, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+				m_depthArray, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+				m_resolution, m_resolution, m_numCascades);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		glViewport(0, 0, m_resolution, m_resolution);
+		m_renderMask = (1 << m_numCascades) - 1;
+	}
+
+	void CascadedShadowMap::invalidateStatic()
+	{
+		m_staticValid = false;
+		m_staticDirtyMask = (1 << m_numCascades) - 1;
+	}
+
+	void CascadedShadowMap::setRenderUniforms(const Shader& shader) const
+	{
+		shader.setInt("_NumCascades", m_numCascades);
+		shader.setInt("_CascadeMask", m_renderMask);
+		for (int i = 0; i < m_numCascades; i++)
+		{
+			shader.setMat4("_CascadeMatrices[" + std::to_string(i) + "]", m_lightMatrices[i]);
+		}
+	}
+
+	void CascadedShadowMap::setSampleUniforms(const Shader& shader, int textureUnit) const
+	{
+		glActiveTexture(GL_TEXTURE0 + textureUnit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_depthArray);
+		shader.setInt("_ShadowMap", textureUnit);
+		setRenderUniforms(shader);
+		for (int i = 0; i < m_numCascades; i++)
+		{
+			shader.setFloat("_CascadeSplits[" + std::to_string(i) + "]", m_splits[i]);
+		}
+	}
+}
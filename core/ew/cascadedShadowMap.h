@@ -0,0 +1,69 @@
+#pragma once
+#include "camera.h"
+#include "shader.h"
+#include <glm/glm.hpp>
+
+namespace ew {
+	//Directional light shadows that split the camera frustum into depth ranges, each with its own
+	//orthographic projection, rendered into the layers of one depth texture array.
+	//Projections are fitted to a bounding sphere of each range and snapped to whole texels so
+	//shadow edges don't shimmer when the camera moves or rotates. Depth is snapped too, so small
+	//camera motion leaves the matrices, and the static cache, unchanged.
+	//Static casters can be cached in a second array that is only re-rendered for cascades whose
+	//projection changed, then copied under the dynamic casters each frame.
+	class CascadedShadowMap {
+	public:
+		//Must match the array sizes in the cascade shaders
+		static const int MAX_CASCADES = 4;
+
+		CascadedShadowMap(int resolution = 2048, int numCascades = MAX_CASCADES);
+		void update(const Camera& camera, const glm::vec3& lightDirection);
+		//Binds the framebuffer and viewport and clears every cascade
+		void beginRender();
+		//Binds the static cache for the cascades that need re-rendering and clears them.
+		//Returns false if every cached cascade is still valid and static casters can be skipped.
+		//Before GL 4.4 there is no cache, this acts as beginRender and always returns true.
+		bool beginStaticRender();
+		//Copies the static cache into the shadow map and binds it for dynamic casters
+		void beginDynamicRender();
+		//Forces static casters to be re-rendered, e.g. after static geometry moved
+		void invalidateStatic();
+		//Cascade matrices for the layered depth shaders, only cascades being rendered are set in _CascadeMask
+		void setRenderUniforms(const Shader& shader)const;
+		//Binds the depth array to textureUnit and sets the uniforms lit shaders select cascades with
+		void setSampleUniforms(const Shader& shader, int textureUnit)const;
+		void setNumCascades(int numCascades);
+		inline int getNumCascades()const { return m_numCascades; }
+		inline int getResolution()const { return m_resolution; }
+		inline unsigned int getTexture()const { return m_depthArray; }
+		inline const glm::mat4& getLightMatrix(int cascade)const { return m_lightMatrices[cascade]; }
+		//View depth where a cascade ends
+		inline float getSplit(int cascade)const { return m_splits[cascade]; }
+		//Light projection covering every cascade, for culling casters
+		inline const glm::mat4& getCullMatrix()const { return m_cullMatrix; }
+		//Bit per cascade whose static cache is out of date
+		inline unsigned int getStaticDirtyMask()const { return m_staticDirtyMask; }
+
+		float splitLambda = 0.75f; //0 = uniform splits, 1 = logarithmic
+		float shadowDistance = 40.0f; //Shadows end here or at the camera far plane, whichever is closer
+		float casterDistance = 20.0f; //How far toward the light outside a cascade casters are still rendered
+	private:
+		glm::mat4 fitProjection(const Camera& camera, float nearDistance, float farDistance, bool snapToTexels)const;
+
+		int m_resolution;
+		int m_numCascades;
+		unsigned int m_fbo = 0;
+		unsigned int m_depthArray = 0;
+		glm::mat4 m_lightView = glm::mat4(1.0f); //Rotation only, so snapping in light space stays stable
+		glm::mat4 m_lightMatrices[MAX_CASCADES];
+		float m_splits[MAX_CASCADES];
+		glm::mat4 m_cullMatrix = glm::mat4(1.0f);
+		unsigned int m_renderMask = 0; //Cascades the current pass writes to
+
+		unsigned int m_staticFbo = 0;
+		unsigned int m_staticArray = 0;
+		glm::mat4 m_staticMatrices[MAX_CASCADES]; //Matrices the cached static depth was rendered with
+		unsigned int m_staticDirtyMask = 0;
+		bool m_staticValid = false;
+	};
+}
@@ -0,0 +1,179 @@
+#include "compressedTexture.h"
+#include "mipGenerator.h"
+#include "glExtensions.h"
+#include "external/glad.h"
+#include <stdio.h>
+#include <string.h>
+
+//Not part of core GL, so glad doesn't define them
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+
+namespace ew {
+	static const char MAGIC[4] = { 'E', 'W', 'T', 'X' };
+	static const unsigned int VERSION = 1;
+
+	size_t CompressedImage::getSize() const
+	{
+		size_t size = 0;
+		for (const CompressedLevel& level : levels)
+		{
+			size += level.data.size();
+		}
+		return size;
+	}
+
+	CompressedImage cookTexture(const unsigned char* rgba, int width, int height, BlockFormat format, bool srgb)
+	{
+		CompressedImage image;
+		image.format = format;
+		image.width = width;
+		image.height = height;
+		//BC5 holds normals or other two channel data, never color
+		srgb = srgb && format != BlockFormat::BC5;
+		MipChain mips = generateMipChain(rgba, width, height, MipFilter::BOX, srgb);
+		for (const MipLevel& level : mips.levels)
+		{
+			image.levels.push_back({ level.width, level.height, compressImage(level.data.data(), level.width, level.height, format) });
+		}
+		return image;
+	}
+
+	bool writeCompressedTexture(const char* filePath, const CompressedImage& image)
+	{
+		FILE* file = fopen(filePath, "wb");
+		if (file == NULL) {
+			printf("Failed to open %s for writing\n", filePath);
+			return false;
+		}
+		unsigned int header[5] = { VERSION, (unsigned int)image.format, (unsigned int)image.width, (unsigned int)image.height, (unsigned int)image.levels.size() };
+		fwrite(MAGIC, 1, sizeof(MAGIC), file);
+		fwrite(header, sizeof(header), 1, file);
+		for (const CompressedLevel& level : image.levels)
+		{
+			unsigned int levelHeader[3] = { (unsigned int)level.width, (unsigned int)level.height, (unsigned int)level.data.size() };
+			fwrite(levelHeader, sizeof(levelHeader), 1, file);
+			fwrite(level.data.data(), 1, level.data.size(), file);
+		}
+		bool ok = ferror(file) == 0;
+		fclose(file);
+		return ok;
+	}
+
+	bool readCompressedTexture(const char* filePath, CompressedImage& image)
+	{
+		FILE* file = fopen(filePath, "rb");
+		if (file == NULL) {
+			return false;
+		}
+		char magic[4];
+		unsigned int header[5];
+		if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+			|| fread(header, sizeof(header), 1, file) != 1 || header[0] != VERSION || header[1] > (unsigned int)BlockFormat::BC7) {
+			printf("%s is not a compressed texture\n", filePath);
+			fclose(file);
+			return false;
+		}
+		image.format = (BlockFormat)header[1];
+		image.width = header[2];
+		image.height = header[3];
+		image.levels.resize(header[4]);
+		for (CompressedLevel& level : image.levels)
+		{
+			unsigned int levelHeader[3];
+			if (fread(levelHeader, sizeof(levelHeader), 1, file) != 1
+				|| levelHeader[2] != getCompressedSize(image.format, levelHeader[0], levelHeader[1])) {
+				printf("%s is truncated or corrupt\n", filePath);
+				fclose(file);
+				return false;
+			}
+			level.width = levelHeader[0];
+			level.height = levelHeader[1];
+			level.data.resize(levelHeader[2]);
+			if (fread(level.data.data(), 1, level.data.size(), file) != level.data.size()) {
+				printf("%s is truncated or corrupt\n", filePath);
+				fclose(file);
+				return false;
+			}
+		}
+		fclose(file);
+		return true;
+	}
+
+	//BC5 holds two data channels and has no sRGB variant
+	static GLenum getInternalFormat(BlockFormat format, bool srgb) {
+		switch (format) {
+		case BlockFormat::BC1:
+			return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case BlockFormat::BC3:
+			return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case BlockFormat::BC5:
+			return GL_COMPRESSED_RG_RGTC2;
+		default:
+			return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+		}
+	}
+
+	bool isBlockFormatSupported(BlockFormat format, bool srgb)
+	{
+		if (format == BlockFormat::BC5 || format == BlockFormat::BC7) {
+			return true;
+		}
+		static int s3tc = -1;
+		static int s3tcSrgb = -1;
+		if (s3tc < 0) {
+			s3tc = hasExtension("GL_EXT_texture_compression_s3tc") ? 1 : 0;
+			s3tcSrgb = s3tc == 1 && (hasExtension("GL_EXT_texture_sRGB") || hasExtension("GL_EXT_texture_compression_s3tc_srgb")) ? 1 : 0;
+		}
+		return srgb ? s3tcSrgb == 1 : s3tc == 1;
+	}
+
+	unsigned int createCompressedTexture(const CompressedImage& image, int wrapMode, int magFilter, int minFilter, bool srgb)
+	{
+		srgb = srgb && image.format != BlockFormat::BC5;
+		bool supported = isBlockFormatSupported(image.format, srgb);
+		if (!supported) {
+			printf("%s isn't supported by this driver, decompressing\n", getBlockFormatName(image.format));
+		}
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int i = 0; i < (int)image.levels.size(); i++)
+		{
+			const CompressedLevel& level = image.levels[i];
+			if (supported) {
+				glCompressedTexImage2D(GL_TEXTURE_2D, i, getInternalFormat(image.format, srgb), level.width, level.height, 0, (GLsizei)level.data.size(), level.data.data());
+			}
+			else {
+				std::vector<unsigned char> rgba = decompressImage(level.data.data(), level.width, level.height, image.format);
+				glTexImage2D(GL_TEXTURE_2D, i, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+			}
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (int)image.levels.size() - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture;
+	}
+
+	unsigned int loadCompressedTexture(const char* filePath)
+	{
+		return loadCompressedTexture(filePath, GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR);
+	}
+
+	unsigned int loadCompressedTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool srgb)
+	{
+		CompressedImage image;
+		if (!readCompressedTexture(filePath, image)) {
+			printf("Failed to load compressed texture %s\n", filePath);
+			return 0;
+		}
+		return createCompressedTexture(image, wrapMode, magFilter, minFilter, srgb);
+	}
+}
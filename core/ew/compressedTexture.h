@@ -0,0 +1,37 @@
+#pragma once
+#include "blockCompression.h"
+#include <vector>
+
+namespace ew {
+	struct CompressedLevel {
+		int width;
+		int height;
+		std::vector<unsigned char> data;
+	};
+
+	//A block compressed texture with its full mip chain, level 0 first
+	struct CompressedImage {
+		BlockFormat format = BlockFormat::BC7;
+		int width = 0;
+		int height = 0;
+		std::vector<CompressedLevel> levels;
+		size_t getSize()const;
+	};
+
+	//Builds a box filtered mip chain from RGBA8 texels and encodes every level. srgb filters color in linear space,
+	//turn it off for normal and data maps. BC5 always filters the raw values.
+	CompressedImage cookTexture(const unsigned char* rgba, int width, int height, BlockFormat format, bool srgb = true);
+
+	//.ewtx container: "EWTX", version, format, width, height, level count, then per level width, height, byte size and blocks
+	bool writeCompressedTexture(const char* filePath, const CompressedImage& image);
+	bool readCompressedTexture(const char* filePath, CompressedImage& image);
+
+	//BC5 and BC7 are core GL, BC1 and BC3 need EXT_texture_compression_s3tc, and EXT_texture_sRGB for srgb
+	bool isBlockFormatSupported(BlockFormat format, bool srgb = false);
+	//Uploads every level with glCompressedTexImage2D. Unsupported formats are decompressed to RGBA8 on the CPU.
+	//srgb picks the sRGB variant of BC1, BC3 and BC7 so sampling returns linear color, BC5 ignores it.
+	unsigned int createCompressedTexture(const CompressedImage& image, int wrapMode, int magFilter, int minFilter, bool srgb = false);
+	//Returns 0 if the file couldn't be read
+	unsigned int loadCompressedTexture(const char* filePath);
+	unsigned int loadCompressedTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool srgb = false);
+}
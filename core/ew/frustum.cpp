@@ -0,0 +1,177 @@
+#include "frustum.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define EW_CULL_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EW_CULL_SSE
+#endif
+
+namespace ew {
+	/// <summary>
+	/// Extracts normalized frustum planes from the rows of a view projection matrix (Gribb/Hartmann).
+	/// Works for perspective and orthographic matrices, e.g. camera.projectionMatrix() * camera.viewMatrix()
+	/// or a light space matrix.
+	/// </summary>
+	/// <param name="viewProjection">World to clip space matrix</param>
+	/// <returns></returns>
+	Frustum extractFrustum(const glm::mat4& viewProjection) {
+		//glm is column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+		{
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		}
+		Frustum frustum;
+		frustum.planes[0] = rows[3] + rows[0]; //Left
+		frustum.planes[1] = rows[3] - rows[0]; //Right
+		frustum.planes[2] = rows[3] + rows[1]; //Bottom
+		frustum.planes[3] = rows[3] - rows[1]; //Top
+		frustum.planes[4] = rows[3] + rows[2]; //Near
+		frustum.planes[5] = rows[3] - rows[2]; //Far
+		for (int i = 0; i < 6; i++)
+		{
+			frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+		}
+		return frustum;
+	}
+
+	/// <summary>
+	/// Returns false if the sphere is fully behind any plane
+	/// </summary>
+	bool isVisible(const Frustum& frustum, const BoundingSphere& sphere) {
+		for (int i = 0; i < 6; i++)
+		{
+			const glm::vec4& p = frustum.planes[i];
+			if (glm::dot(glm::vec3(p), sphere.center) + p.w < -sphere.radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Returns false if the box is fully behind any plane
+	/// </summary>
+	bool isVisible(const Frustum& frustum, const AABB& box) {
+		glm::vec3 center = box.center();
+		glm::vec3 extents = box.extents();
+		for (int i = 0; i < 6; i++)
+		{
+			glm::vec3 n = glm::vec3(frustum.planes[i]);
+			//Projected radius of the box onto the plane normal
+			float r = glm::dot(glm::abs(n), extents);
+			if (glm::dot(n, center) + frustum.planes[i].w < -r) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Scalar test of spheres [first, count), used for the tail that doesn't fill a SIMD register
+	/// </summary>
+	static size_t cullSpheresScalar(const float* planes, const float* x, const float* y, const float* z, const float* r, size_t first, size_t count, unsigned char* visible) {
+		size_t numVisible = 0;
+		for (size_t i = first; i < count; i++)
+		{
+			bool inside = true;
+			for (int p = 0; p < 6; p++)
+			{
+				const float* plane = planes + p * 4;
+				float d = plane[0] * x[i] + plane[1] * y[i] + plane[2] * z[i] + plane[3];
+				inside = inside && d >= -r[i];
+			}
+			visible[i] = inside ? 1 : 0;
+			numVisible += inside ? 1 : 0;
+		}
+		return numVisible;
+	}
+
+	/// <summary>
+	/// Tests a batch of spheres against all six planes, 8 (AVX) or 4 (SSE) spheres per instruction.
+	/// </summary>
+	/// <param name="frustum">Planes to test against</param>
+	/// <param name="spheres">World space spheres</param>
+	/// <param name="visible">Resized to spheres.size(), 1 if visible, 0 if culled</param>
+	/// <returns>Number of visible spheres</returns>
+	size_t cullSpheres(const Frustum& frustum, const SphereBatch& spheres, std::vector<unsigned char>& visible) {
+		size_t count = spheres.size();
+		visible.resize(count);
+		if (count == 0) {
+			return 0;
+		}
+		float planes[24];
+		for (int p = 0; p < 6; p++)
+		{
+			planes[p * 4 + 0] = frustum.planes[p].x;
+			planes[p * 4 + 1] = frustum.planes[p].y;
+			planes[p * 4 + 2] = frustum.planes[p].z;
+			planes[p * 4 + 3] = frustum.planes[p].w;
+		}
+		const float* x = spheres.x.data();
+		const float* y = spheres.y.data();
+		const float* z = spheres.z.data();
+		const float* r = spheres.radius.data();
+		size_t numVisible = 0;
+		size_t i = 0;
+#if defined(EW_CULL_AVX)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sx = _mm256_loadu_ps(x + i);
+			__m256 sy = _mm256_loadu_ps(y + i);
+			__m256 sz = _mm256_loadu_ps(z + i);
+			__m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(r + i));
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				__m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[p * 4 + 0]), sx), _mm256_set1_ps(planes[p * 4 + 3]));
+				d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(planes[p * 4 + 1]), sy));
+				d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(planes[p * 4 + 2]), sz));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+			}
+			int mask = _mm256_movemask_ps(inside);
+			for (int lane = 0; lane < 8; lane++)
+			{
+				visible[i + lane] = (mask >> lane) & 1;
+				numVisible += (mask >> lane) & 1;
+			}
+		}
+#elif defined(EW_CULL_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 sx = _mm_loadu_ps(x + i);
+			__m128 sy = _mm_loadu_ps(y + i);
+			__m128 sz = _mm_loadu_ps(z + i);
+			__m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(r + i));
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				__m128 d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p * 4 + 0]), sx), _mm_set1_ps(planes[p * 4 + 3]));
+				d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(planes[p * 4 + 1]), sy));
+				d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(planes[p * 4 + 2]), sz));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+			}
+			int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				visible[i + lane] = (mask >> lane) & 1;
+				numVisible += (mask >> lane) & 1;
+			}
+		}
+#endif
+		numVisible += cullSpheresScalar(planes, x, y, z, r, i, count, visible.data());
+		return numVisible;
+	}
+
+	const char* getCullSimdName() {
+#if defined(EW_CULL_AVX)
+		return "AVX (8 wide)";
+#elif defined(EW_CULL_SSE)
+		return "SSE (4 wide)";
+#else
+		return "Scalar";
+#endif
+	}
+}
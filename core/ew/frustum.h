@@ -0,0 +1,45 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "bounds.h"
+
+namespace ew {
+	//Left, right, bottom, top, near, far planes. xyz = inward facing unit normal, w = distance
+	struct Frustum {
+		glm::vec4 planes[6];
+	};
+
+	//Structure of arrays spheres, so the batch test can load 4 or 8 of them per instruction
+	struct SphereBatch {
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+		std::vector<float> radius;
+
+		inline void clear() {
+			x.clear();
+			y.clear();
+			z.clear();
+			radius.clear();
+		}
+		inline void push(const BoundingSphere& sphere) {
+			x.push_back(sphere.center.x);
+			y.push_back(sphere.center.y);
+			z.push_back(sphere.center.z);
+			radius.push_back(sphere.radius);
+		}
+		inline size_t size()const { return x.size(); }
+	};
+
+	//Per pass culling counters
+	struct CullStats {
+		unsigned int drawn = 0;
+		unsigned int culled = 0;
+	};
+
+	Frustum extractFrustum(const glm::mat4& viewProjection);
+	bool isVisible(const Frustum& frustum, const BoundingSphere& sphere);
+	bool isVisible(const Frustum& frustum, const AABB& box);
+	size_t cullSpheres(const Frustum& frustum, const SphereBatch& spheres, std::vector<unsigned char>& visible);
+	const char* getCullSimdName();
+}
@@ -0,0 +1,78 @@
+#include "gBuffer.h"
+#include "external/glad.h"
+#include <stdio.h>
+
+namespace ew {
+	static unsigned int createTarget(GLenum format, int width, int height) {
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return texture;
+	}
+
+	/// <summary>
+	/// Creates the attachments and a framebuffer that writes all of them at once
+	/// </summary>
+	/// <param name="width">Should match the framebuffer the lighting pass writes to</param>
+	/// <param name="height">Should match the framebuffer the lighting pass writes to</param>
+	GBuffer::GBuffer(int width, int height)
+		: m_width(width), m_height(height)
+	{
+		m_attachments[0] = createTarget(GL_SRGB8_ALPHA8, width, height);
+		m_attachments[1] = createTarget(GL_RG16_SNORM, width, height);
+		m_attachments[2] = createTarget(GL_RGBA8, width, height);
+		//Same format as the scene depth so it can be blitted
+		m_depth = createTarget(GL_DEPTH24_STENCIL8, width, height);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &m_fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		GLenum drawBuffers[NUM_ATTACHMENTS];
+		for (int i = 0; i < NUM_ATTACHMENTS; i++)
+		{
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, m_attachments[i], 0);
+			drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+		}
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depth, 0);
+		glDrawBuffers(NUM_ATTACHMENTS, drawBuffers);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			printf("G-buffer framebuffer incomplete\n");
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void GBuffer::beginGeometryPass()
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		glViewport(0, 0, m_width, m_height);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	void GBuffer::bindTextures(const Shader& shader, int firstUnit) const
+	{
+		const char* names[NUM_ATTACHMENTS] = { "_GAlbedo", "_GNormal", "_GMaterial" };
+		for (int i = 0; i < NUM_ATTACHMENTS; i++)
+		{
+			glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+			glBindTexture(GL_TEXTURE_2D, m_attachments[i]);
+			shader.setInt(names[i], firstUnit + i);
+		}
+		glActiveTexture(GL_TEXTURE0 + firstUnit + NUM_ATTACHMENTS);
+		glBindTexture(GL_TEXTURE_2D, m_depth);
+		shader.setInt("_GDepth", firstUnit + NUM_ATTACHMENTS);
+	}
+
+	void GBuffer::blitDepth(unsigned int dstFramebuffer) const
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, dstFramebuffer);
+		glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, dstFramebuffer);
+	}
+}
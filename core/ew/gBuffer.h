@@ -0,0 +1,33 @@
+#pragma once
+#include "shader.h"
+
+namespace ew {
+	//Geometry buffer for deferred shading. Attachments are kept small, 12 bytes per pixel plus depth:
+	//	0: SRGB8_ALPHA8 albedo, alpha = ambient coefficient. Written with GL_FRAMEBUFFER_SRGB enabled, so dark
+	//	   linear values keep their precision.
+	//	1: RG16_SNORM octahedral encoded world normal
+	//	2: RGBA8 material, r = Kd, g = Ks, b = log2(shininess) / 10, a = 1 where geometry was drawn
+	//World position is rebuilt from depth with the inverse view projection.
+	class GBuffer {
+	public:
+		static const int NUM_ATTACHMENTS = 3;
+
+		GBuffer(int width, int height);
+		//Binds the framebuffer and viewport and clears every attachment
+		void beginGeometryPass();
+		//Binds the attachments and depth to consecutive units starting at firstUnit and sets the _G* samplers
+		void bindTextures(const Shader& shader, int firstUnit)const;
+		//Copies depth into another framebuffer of the same size, e.g. so forward passes can depth test against it
+		void blitDepth(unsigned int dstFramebuffer)const;
+		inline unsigned int getAttachment(int index)const { return m_attachments[index]; }
+		inline unsigned int getDepth()const { return m_depth; }
+		inline int getWidth()const { return m_width; }
+		inline int getHeight()const { return m_height; }
+	private:
+		int m_width;
+		int m_height;
+		unsigned int m_fbo = 0;
+		unsigned int m_attachments[NUM_ATTACHMENTS];
+		unsigned int m_depth = 0;
+	};
+}
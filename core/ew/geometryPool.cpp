@@ -0,0 +1,203 @@
+#include "geometryPool.h"
+#include "uploadManager.h"
+#include "external/glad.h"
+#include <stdio.h>
+
+namespace ew {
+	/// <summary>
+	/// Creates immutable storage for a buffer bound to target, falling back to glBufferData before GL 4.4
+	/// </summary>
+	static void createStorage(GLenum target, size_t size) {
+		if (GLAD_GL_VERSION_4_4) {
+			//Written by copies from the upload ring or the previous pool buffer. Dynamic storage is still needed
+			//for the glBufferSubData fallback when the ring couldn't be mapped.
+			glBufferStorage(target, size, NULL, GL_DYNAMIC_STORAGE_BIT);
+		}
+		else {
+			glBufferData(target, size, NULL, GL_STATIC_DRAW);
+		}
+	}
+
+	/// <summary>
+	/// Creates the shared VAO and buffers. Attribute layout matches ew::Mesh.
+	/// </summary>
+	/// <param name="vertexCapacity">Initial number of vertices</param>
+	/// <param name="indexCapacity">Initial number of indices</param>
+	void GeometryPool::init(unsigned int vertexCapacity, unsigned int indexCapacity)
+	{
+		m_vertexCapacity = vertexCapacity;
+		m_indexCapacity = indexCapacity;
+
+		glGenVertexArrays(1, &m_vao);
+		glBindVertexArray(m_vao);
+
+		glGenBuffers(1, &m_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		createStorage(GL_ARRAY_BUFFER, sizeof(Vertex) * (size_t)m_vertexCapacity);
+
+		glGenBuffers(1, &m_ebo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		createStorage(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * (size_t)m_indexCapacity);
+
+		//Position attribute
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
+		glEnableVertexAttribArray(0);
+
+		//Normal attribute
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+		glEnableVertexAttribArray(1);
+
+		//UV attribute
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
+		glEnableVertexAttribArray(2);
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		m_freeVertices.clear();
+		m_freeIndices.clear();
+		m_freeVertices.push_back({ 0, m_vertexCapacity });
+		m_freeIndices.push_back({ 0, m_indexCapacity });
+	}
+
+	/// <summary>
+	/// Suballocates and uploads a mesh. Indices stay relative to the mesh, use baseVertex when drawing.
+	/// </summary>
+	/// <param name="meshData">Vertices and indices to copy into the pool</param>
+	/// <returns>Where the mesh was placed</returns>
+	GeometryAllocation GeometryPool::allocate(const MeshData& meshData)
+	{
+		if (m_vao == 0) {
+			init();
+		}
+		GeometryAllocation allocation;
+		allocation.numVertices = meshData.vertices.size();
+		allocation.numIndices = meshData.indices.size();
+		while (!allocateRange(m_freeVertices, allocation.numVertices, &allocation.baseVertex)) {
+			grow(m_vertexCapacity * 2, m_indexCapacity);
+		}
+		while (!allocateRange(m_freeIndices, allocation.numIndices, &allocation.firstIndex)) {
+			grow(m_vertexCapacity, m_indexCapacity * 2);
+		}
+		UploadManager& uploadManager = getUploadManager();
+		if (allocation.numVertices > 0) {
+			uploadManager.uploadBuffer(m_vbo, sizeof(Vertex) * (size_t)allocation.baseVertex, meshData.vertices.data(), sizeof(Vertex) * meshData.vertices.size());
+		}
+		if (allocation.numIndices > 0) {
+			uploadManager.uploadBuffer(m_ebo, sizeof(unsigned int) * (size_t)allocation.firstIndex, meshData.indices.data(), sizeof(unsigned int) * meshData.indices.size());
+		}
+		return allocation;
+	}
+
+	void GeometryPool::free(const GeometryAllocation& allocation)
+	{
+		freeRange(m_freeVertices, allocation.baseVertex, allocation.numVertices);
+		freeRange(m_freeIndices, allocation.firstIndex, allocation.numIndices);
+	}
+
+	void GeometryPool::bind() const
+	{
+		glBindVertexArray(m_vao);
+	}
+
+	/// <summary>
+	/// First-fit allocation from a sorted free list
+	/// </summary>
+	bool GeometryPool::allocateRange(std::vector<Range>& freeList, unsigned int size, unsigned int* offset)
+	{
+		if (size == 0) {
+			*offset = 0;
+			return true;
+		}
+		for (size_t i = 0; i < freeList.size(); i++)
+		{
+			if (freeList[i].size < size) {
+				continue;
+			}
+			*offset = freeList[i].offset;
+			freeList[i].offset += size;
+			freeList[i].size -= size;
+			if (freeList[i].size == 0) {
+				freeList.erase(freeList.begin() + i);
+			}
+			return true;
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// Returns a range to a sorted free list, merging it with its neighbours
+	/// </summary>
+	void GeometryPool::freeRange(std::vector<Range>& freeList, unsigned int offset, unsigned int size)
+	{
+		if (size == 0) {
+			return;
+		}
+		size_t i = 0;
+		while (i < freeList.size() && freeList[i].offset < offset) {
+			i++;
+		}
+		freeList.insert(freeList.begin() + i, { offset, size });
+		//Merge with next
+		if (i + 1 < freeList.size() && freeList[i].offset + freeList[i].size == freeList[i + 1].offset) {
+			freeList[i].size += freeList[i + 1].size;
+			freeList.erase(freeList.begin() + i + 1);
+		}
+		//Merge with previous
+		if (i > 0 && freeList[i - 1].offset + freeList[i - 1].size == freeList[i].offset) {
+			freeList[i - 1].size += freeList[i].size;
+			freeList.erase(freeList.begin() + i);
+		}
+	}
+
+	/// <summary>
+	/// Moves the pool into larger buffers. Existing allocations keep their offsets.
+	/// </summary>
+	void GeometryPool::grow(unsigned int minVertexCapacity, unsigned int minIndexCapacity)
+	{
+		unsigned int newVertexCapacity = glm::max(m_vertexCapacity, minVertexCapacity);
+		unsigned int newIndexCapacity = glm::max(m_indexCapacity, minIndexCapacity);
+		printf("Growing geometry pool to %u vertices, %u indices\n", newVertexCapacity, newIndexCapacity);
+
+		glBindVertexArray(m_vao);
+		if (newVertexCapacity > m_vertexCapacity) {
+			unsigned int vbo;
+			glGenBuffers(1, &vbo);
+			glBindBuffer(GL_ARRAY_BUFFER, vbo);
+			createStorage(GL_ARRAY_BUFFER, sizeof(Vertex) * (size_t)newVertexCapacity);
+			glBindBuffer(GL_COPY_READ_BUFFER, m_vbo);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, 0, 0, sizeof(Vertex) * (size_t)m_vertexCapacity);
+			glDeleteBuffers(1, &m_vbo);
+			m_vbo = vbo;
+			//Re-point attributes at the new buffer
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
+			freeRange(m_freeVertices, m_vertexCapacity, newVertexCapacity - m_vertexCapacity);
+			m_vertexCapacity = newVertexCapacity;
+		}
+		if (newIndexCapacity > m_indexCapacity) {
+			unsigned int ebo;
+			glGenBuffers(1, &ebo);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+			createStorage(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * (size_t)newIndexCapacity);
+			glBindBuffer(GL_COPY_READ_BUFFER, m_ebo);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ELEMENT_ARRAY_BUFFER, 0, 0, sizeof(unsigned int) * (size_t)m_indexCapacity);
+			glDeleteBuffers(1, &m_ebo);
+			m_ebo = ebo;
+			freeRange(m_freeIndices, m_indexCapacity, newIndexCapacity - m_indexCapacity);
+			m_indexCapacity = newIndexCapacity;
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+
+	GeometryPool& getGeometryPool()
+	{
+		static GeometryPool geometryPool;
+		return geometryPool;
+	}
+}
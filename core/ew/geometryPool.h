@@ -0,0 +1,60 @@
+#pragma once
+#include "mesh.h"
+#include <vector>
+
+namespace ew {
+	//Location of one mesh inside the pool's shared buffers
+	struct GeometryAllocation {
+		unsigned int baseVertex = 0;
+		unsigned int firstIndex = 0;
+		unsigned int numVertices = 0;
+		unsigned int numIndices = 0;
+	};
+
+	//Matches the layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+	struct DrawElementsIndirectCommand {
+		unsigned int count;
+		unsigned int instanceCount;
+		unsigned int firstIndex;
+		int baseVertex;
+		unsigned int baseInstance;
+	};
+
+	//One large vertex buffer and index buffer sharing a single VAO that many meshes are suballocated from.
+	//Storage grows by doubling when full.
+	class GeometryPool {
+	public:
+		static const unsigned int DEFAULT_VERTEX_CAPACITY = 1 << 18;
+		static const unsigned int DEFAULT_INDEX_CAPACITY = 1 << 20;
+
+		GeometryPool() {};
+		void init(unsigned int vertexCapacity = DEFAULT_VERTEX_CAPACITY, unsigned int indexCapacity = DEFAULT_INDEX_CAPACITY);
+		GeometryAllocation allocate(const MeshData& meshData);
+		void free(const GeometryAllocation& allocation);
+		void bind()const;
+		inline unsigned int getVertexArray()const { return m_vao; }
+		inline unsigned int getVertexBuffer()const { return m_vbo; }
+		inline unsigned int getIndexBuffer()const { return m_ebo; }
+		inline unsigned int getVertexCapacity()const { return m_vertexCapacity; }
+		inline unsigned int getIndexCapacity()const { return m_indexCapacity; }
+	private:
+		struct Range {
+			unsigned int offset;
+			unsigned int size;
+		};
+		static bool allocateRange(std::vector<Range>& freeList, unsigned int size, unsigned int* offset);
+		static void freeRange(std::vector<Range>& freeList, unsigned int offset, unsigned int size);
+		void grow(unsigned int minVertexCapacity, unsigned int minIndexCapacity);
+
+		unsigned int m_vao = 0;
+		unsigned int m_vbo = 0;
+		unsigned int m_ebo = 0;
+		unsigned int m_vertexCapacity = 0;
+		unsigned int m_indexCapacity = 0;
+		std::vector<Range> m_freeVertices; //Sorted by offset, adjacent ranges merged
+		std::vector<Range> m_freeIndices;
+	};
+
+	//Shared pool used by pooled meshes and models. Initialized on first use.
+	GeometryPool& getGeometryPool();
+}
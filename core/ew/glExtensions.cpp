@@ -0,0 +1,57 @@
+#include "glExtensions.h"
+#include "external/glad.h"
+#include <string.h>
+
+namespace ew {
+	typedef GLuint64(GLAD_API_PTR* PFNGETTEXTUREHANDLEARB)(GLuint texture);
+	typedef void (GLAD_API_PTR* PFNMAKETEXTUREHANDLERESIDENTARB)(GLuint64 handle);
+	typedef void (GLAD_API_PTR* PFNMAKETEXTUREHANDLENONRESIDENTARB)(GLuint64 handle);
+
+	static PFNGETTEXTUREHANDLEARB s_getTextureHandle = nullptr;
+	static PFNMAKETEXTUREHANDLERESIDENTARB s_makeTextureHandleResident = nullptr;
+	static PFNMAKETEXTUREHANDLENONRESIDENTARB s_makeTextureHandleNonResident = nullptr;
+
+	bool hasExtension(const char* name)
+	{
+		int numExtensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+		for (int i = 0; i < numExtensions; i++)
+		{
+			if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool loadBindlessTexture(GLProcLoader loader)
+	{
+		if (!hasExtension("GL_ARB_bindless_texture")) {
+			return false;
+		}
+		s_getTextureHandle = (PFNGETTEXTUREHANDLEARB)loader("glGetTextureHandleARB");
+		s_makeTextureHandleResident = (PFNMAKETEXTUREHANDLERESIDENTARB)loader("glMakeTextureHandleResidentARB");
+		s_makeTextureHandleNonResident = (PFNMAKETEXTUREHANDLENONRESIDENTARB)loader("glMakeTextureHandleNonResidentARB");
+		return isBindlessTextureLoaded();
+	}
+
+	bool isBindlessTextureLoaded()
+	{
+		return s_getTextureHandle != nullptr && s_makeTextureHandleResident != nullptr && s_makeTextureHandleNonResident != nullptr;
+	}
+
+	uint64_t getTextureHandle(unsigned int texture)
+	{
+		return s_getTextureHandle(texture);
+	}
+
+	void makeTextureHandleResident(uint64_t handle)
+	{
+		s_makeTextureHandleResident(handle);
+	}
+
+	void makeTextureHandleNonResident(uint64_t handle)
+	{
+		s_makeTextureHandleNonResident(handle);
+	}
+}
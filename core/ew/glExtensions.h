@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+
+namespace ew {
+	typedef void (*GLProc)(void);
+	//Same signature as glfwGetProcAddress
+	typedef GLProc(*GLProcLoader)(const char* name);
+
+	//True if the current context lists the extension
+	bool hasExtension(const char* name);
+
+	//glad is generated for core GL only, so ARB_bindless_texture entry points are loaded here.
+	//Returns false if the extension isn't supported, the functions below must not be called then.
+	bool loadBindlessTexture(GLProcLoader loader);
+	bool isBindlessTextureLoaded();
+	uint64_t getTextureHandle(unsigned int texture);
+	void makeTextureHandleResident(uint64_t handle);
+	void makeTextureHandleNonResident(uint64_t handle);
+}
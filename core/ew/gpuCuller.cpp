@@ -0,0 +1,192 @@
+#include "gpuCuller.h"
+#include "uploadManager.h"
+#include "profiler.h"
+#include "external/glad.h"
+
+namespace ew {
+	/// <summary>
+	/// Loads the culling and Hi-Z compute shaders and creates per-view output buffers
+	/// </summary>
+	/// <param name="cullShader">File path to the instance culling compute shader</param>
+	/// <param name="hiZShader">File path to the depth pyramid compute shader</param>
+	/// <param name="numViews">Number of independent cull results, e.g. camera + shadow</param>
+	GpuCuller::GpuCuller(const std::string& cullShader, const std::string& hiZShader, int numViews)
+		: m_cullShader(cullShader), m_hiZShader(hiZShader)
+	{
+		m_views.resize(numViews);
+		glGenBuffers(1, &m_instanceBuffer);
+		glGenBuffers(1, &m_commandTemplate);
+		for (size_t i = 0; i < m_views.size(); i++)
+		{
+			glGenBuffers(1, &m_views[i].commandBuffer);
+			glGenBuffers(1, &m_views[i].visibleBuffer);
+			glGenBuffers(1, &m_views[i].visibleMaterialBuffer);
+			m_views[i].numVisible.reset(new AsyncReadback(sizeof(unsigned int)));
+		}
+	}
+
+	/// <summary>
+	/// Sets the meshes every visible instance draws, usually Model::getDrawCommands()
+	/// </summary>
+	void GpuCuller::setDrawCommands(const std::vector<DrawElementsIndirectCommand>& commands)
+	{
+		m_commands = commands;
+		std::vector<DrawElementsIndirectCommand> zeroed = commands;
+		for (size_t i = 0; i < zeroed.size(); i++)
+		{
+			zeroed[i].instanceCount = 0;
+			zeroed[i].baseInstance = 0;
+		}
+		size_t size = sizeof(DrawElementsIndirectCommand) * zeroed.size();
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandTemplate);
+		glBufferData(GL_COPY_WRITE_BUFFER, size, zeroed.data(), GL_STATIC_DRAW);
+		for (size_t i = 0; i < m_views.size(); i++)
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, m_views[i].commandBuffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_DYNAMIC_COPY);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	/// <summary>
+	/// Uploads this frame's instances. Buffers grow to fit but never shrink.
+	/// </summary>
+	void GpuCuller::setInstances(const std::vector<CullInstance>& instances)
+	{
+		m_numInstances = instances.size();
+		if (m_numInstances > m_instanceCapacity) {
+			m_instanceCapacity = glm::max(m_numInstances, m_instanceCapacity * 2);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, m_instanceBuffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, sizeof(CullInstance) * (size_t)m_instanceCapacity, NULL, GL_DYNAMIC_DRAW);
+			for (size_t i = 0; i < m_views.size(); i++)
+			{
+				glBindBuffer(GL_COPY_WRITE_BUFFER, m_views[i].visibleBuffer);
+				glBufferData(GL_COPY_WRITE_BUFFER, sizeof(glm::mat4) * (size_t)m_instanceCapacity, NULL, GL_DYNAMIC_COPY);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, m_views[i].visibleMaterialBuffer);
+				glBufferData(GL_COPY_WRITE_BUFFER, sizeof(unsigned int) * (size_t)m_instanceCapacity, NULL, GL_DYNAMIC_COPY);
+			}
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+		if (m_numInstances > 0) {
+			getUploadManager().uploadBuffer(m_instanceBuffer, 0, instances.data(), sizeof(CullInstance) * instances.size());
+		}
+	}
+
+	/// <summary>
+	/// Runs the culling compute pass for one view
+	/// </summary>
+	/// <param name="view">Index of the output to write</param>
+	/// <param name="viewProjection">Matrix frustum planes are extracted from</param>
+	/// <param name="useHiZ">Also test against the pyramid from the last buildHiZ() call</param>
+	void GpuCuller::cull(int view, const glm::mat4& viewProjection, bool useHiZ)
+	{
+		EW_PROFILE_GPU_SCOPE("GPU cull");
+		if (m_commands.size() == 0) {
+			return;
+		}
+		size_t commandSize = sizeof(DrawElementsIndirectCommand) * m_commands.size();
+		glBindBuffer(GL_COPY_READ_BUFFER, m_commandTemplate);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_views[view].commandBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, commandSize);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		if (m_numInstances == 0) {
+			m_views[view].numVisible->copy(m_views[view].commandBuffer, offsetof(DrawElementsIndirectCommand, instanceCount));
+			return;
+		}
+
+		useHiZ = useHiZ && m_hiZValid;
+		m_cullShader.use();
+		m_cullShader.setInt("_NumInstances", m_numInstances);
+		m_cullShader.setInt("_NumCommands", m_commands.size());
+		m_cullShader.setMat4("_ViewProjection", viewProjection);
+		m_cullShader.setBool("_UseHiZ", useHiZ);
+		if (useHiZ) {
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, m_hiZ);
+			m_cullShader.setInt("_HiZ", 0);
+			m_cullShader.setInt("_HiZLevels", m_hiZLevels);
+			m_cullShader.setMat4("_HiZViewProjection", m_hiZViewProjection);
+		}
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_views[view].visibleBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_views[view].commandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_MATERIAL_BINDING, m_views[view].visibleMaterialBuffer);
+		//64 threads per group
+		m_cullShader.dispatch((m_numInstances + 63) / 64);
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+		m_views[view].numVisible->copy(m_views[view].commandBuffer, offsetof(DrawElementsIndirectCommand, instanceCount));
+	}
+
+	/// <summary>
+	/// Draws the instances that survived the last cull of this view. Expects an instanced shader to be bound.
+	/// </summary>
+	void GpuCuller::draw(int view) const
+	{
+		if (m_commands.size() == 0) {
+			return;
+		}
+		getGeometryPool().bind();
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_BINDING, m_views[view].visibleBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_MATERIAL_BINDING, m_views[view].visibleMaterialBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_views[view].commandBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, m_commands.size(), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	/// <summary>
+	/// Builds a max-depth mip pyramid from a depth texture for next frame's occlusion test
+	/// </summary>
+	/// <param name="depthTexture">Depth attachment of the scene pass</param>
+	/// <param name="width">Depth texture width</param>
+	/// <param name="height">Depth texture height</param>
+	/// <param name="viewProjection">Matrix the depth was rendered with</param>
+	void GpuCuller::buildHiZ(unsigned int depthTexture, int width, int height, const glm::mat4& viewProjection)
+	{
+		EW_PROFILE_GPU_SCOPE("Hi-Z pyramid");
+		if (m_hiZ == 0 || width != m_hiZWidth || height != m_hiZHeight) {
+			if (m_hiZ != 0) {
+				glDeleteTextures(1, &m_hiZ);
+			}
+			m_hiZWidth = width;
+			m_hiZHeight = height;
+			m_hiZLevels = 1;
+			while ((width >> m_hiZLevels) > 0 || (height >> m_hiZLevels) > 0) {
+				m_hiZLevels++;
+			}
+			glGenTextures(1, &m_hiZ);
+			glBindTexture(GL_TEXTURE_2D, m_hiZ);
+			glTexStorage2D(GL_TEXTURE_2D, m_hiZLevels, GL_R32F, width, height);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+
+		m_hiZShader.use();
+		//Level 0 is a copy of the depth buffer
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, depthTexture);
+		m_hiZShader.setInt("_Depth", 0);
+		m_hiZShader.setBool("_CopyDepth", true);
+		glBindImageTexture(0, m_hiZ, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glBindImageTexture(1, m_hiZ, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		m_hiZShader.dispatch((width + 7) / 8, (height + 7) / 8);
+
+		//Each following level keeps the farthest depth of the texels it covers
+		m_hiZShader.setBool("_CopyDepth", false);
+		for (int level = 1; level < m_hiZLevels; level++)
+		{
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+			int levelWidth = glm::max(width >> level, 1);
+			int levelHeight = glm::max(height >> level, 1);
+			glBindImageTexture(0, m_hiZ, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+			glBindImageTexture(1, m_hiZ, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+			m_hiZShader.dispatch((levelWidth + 7) / 8, (levelHeight + 7) / 8);
+		}
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		m_hiZViewProjection = viewProjection;
+		m_hiZValid = true;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "shader.h"
+#include "geometryPool.h"
+#include "asyncReadback.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+
+namespace ew {
+	//Input to the culling pass. Layout matches the std430 Instance struct in cullInstances.comp
+	struct CullInstance {
+		glm::mat4 model;
+		glm::vec4 sphere; //xyz = local space center, w = local space radius
+		unsigned int material; //Copied to the visible material buffer, e.g. a MaterialTextures index
+		unsigned int padding[3];
+	};
+
+	//Culls instances on the GPU against a view frustum and optionally a hierarchical-Z pyramid built from
+	//the previous frame's depth. Visible model matrices are compacted per view and drawn with a single
+	//glMultiDrawElementsIndirect call whose instance counts were written by the culling pass.
+	class GpuCuller {
+	public:
+		//SSBO binding instanced vertex shaders read visible model matrices from
+		static const unsigned int VISIBLE_BINDING = 1;
+		//SSBO binding with the material index of each visible instance, in the same order.
+		//GL only guarantees bindings 0-7, this shares 6 with the light binning counter, which is only bound
+		//while binning. cull() and draw() rebind it.
+		static const unsigned int VISIBLE_MATERIAL_BINDING = 6;
+
+		GpuCuller(const std::string& cullShader, const std::string& hiZShader, int numViews = 2);
+		void setDrawCommands(const std::vector<DrawElementsIndirectCommand>& commands);
+		void setInstances(const std::vector<CullInstance>& instances);
+		void cull(int view, const glm::mat4& viewProjection, bool useHiZ);
+		void draw(int view)const;
+		void buildHiZ(unsigned int depthTexture, int width, int height, const glm::mat4& viewProjection);
+		//Call on frames buildHiZ() is skipped, so the next cull doesn't test against an old pyramid
+		inline void invalidateHiZ() { m_hiZValid = false; }
+		//Visible count from a cull a few frames ago, read back without stalling. For debug display.
+		inline unsigned int getNumVisible(int view)const { return m_views[view].numVisible->get<unsigned int>(); }
+		inline unsigned int getNumInstances()const { return m_numInstances; }
+		inline unsigned int getHiZTexture()const { return m_hiZ; }
+	private:
+		struct View {
+			unsigned int commandBuffer = 0; //Indirect commands, instanceCount filled by the cull pass
+			unsigned int visibleBuffer = 0; //Compacted mat4 per visible instance
+			unsigned int visibleMaterialBuffer = 0; //Compacted material index per visible instance
+			std::unique_ptr<AsyncReadback> numVisible; //instanceCount of the first command
+		};
+		ew::Shader m_cullShader;
+		ew::Shader m_hiZShader;
+		std::vector<View> m_views;
+		std::vector<DrawElementsIndirectCommand> m_commands;
+		unsigned int m_commandTemplate = 0; //m_commands with instanceCount 0, copied over each view before culling
+		unsigned int m_instanceBuffer = 0;
+		unsigned int m_instanceCapacity = 0;
+		unsigned int m_numInstances = 0;
+		unsigned int m_hiZ = 0;
+		int m_hiZWidth = 0;
+		int m_hiZHeight = 0;
+		int m_hiZLevels = 0;
+		bool m_hiZValid = false;
+		glm::mat4 m_hiZViewProjection = glm::mat4(1.0f); //Matrix the pyramid's depth was rendered with
+	};
+}
@@ -0,0 +1,53 @@
+#include "gpuTimer.h"
+#include "external/glad.h"
+
+namespace ew {
+	/// <summary>
+	/// Skips the interval instead of reusing a query the GPU hasn't finished with
+	/// </summary>
+	void GpuTimer::begin()
+	{
+		if (m_queries[0] == 0) {
+			glGenQueries(NUM_QUERIES, m_queries);
+		}
+		poll();
+		m_running = !m_pending[m_next];
+		if (m_running) {
+			glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+		}
+	}
+
+	void GpuTimer::end()
+	{
+		if (!m_running) {
+			return;
+		}
+		glEndQuery(GL_TIME_ELAPSED);
+		m_pending[m_next] = true;
+		m_next = (m_next + 1) % NUM_QUERIES;
+		m_running = false;
+	}
+
+	/// <summary>
+	/// Reads every finished query oldest first, so ms ends up with the newest
+	/// </summary>
+	void GpuTimer::poll()
+	{
+		for (int i = 0; i < NUM_QUERIES; i++)
+		{
+			int query = (m_next + i) % NUM_QUERIES;
+			if (!m_pending[query]) {
+				continue;
+			}
+			GLint available = 0;
+			glGetQueryObjectiv(m_queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				continue;
+			}
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(m_queries[query], GL_QUERY_RESULT, &ns);
+			ms = ns / 1000000.0f;
+			m_pending[query] = false;
+		}
+	}
+}
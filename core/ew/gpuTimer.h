@@ -0,0 +1,23 @@
+#pragma once
+
+namespace ew {
+	//GL_TIME_ELAPSED timer that never waits on the GPU. Each begin/end uses the next of NUM_QUERIES queries,
+	//and ms holds the newest result that was already available, usually from a couple of frames ago.
+	//Queries are created on first use and not deleted, so timers can be globals that outlive the GL context.
+	class GpuTimer {
+	public:
+		static const int NUM_QUERIES = 4;
+
+		void begin();
+		void end();
+
+		float ms = 0.0f;
+	private:
+		void poll();
+
+		unsigned int m_queries[NUM_QUERIES] = {};
+		bool m_pending[NUM_QUERIES] = {};
+		int m_next = 0;
+		bool m_running = false; //False if every query was still in flight at begin(), that interval isn't timed
+	};
+}
@@ -0,0 +1,393 @@
+#include "headlessContext.h"
+#include "external/glad.h"
+#include <stdio.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+//Only the parts of EGL and OSMesa used here, so their headers aren't needed to build
+#define EGL_NONE 0x3038
+#define EGL_EXTENSIONS 0x3055
+#define EGL_SURFACE_TYPE 0x3033
+#define EGL_PBUFFER_BIT 0x0001
+#define EGL_RENDERABLE_TYPE 0x3040
+#define EGL_OPENGL_BIT 0x0008
+#define EGL_RED_SIZE 0x3024
+#define EGL_GREEN_SIZE 0x3023
+#define EGL_BLUE_SIZE 0x3022
+#define EGL_OPENGL_API 0x30A2
+#define EGL_CONTEXT_MAJOR_VERSION 0x3098
+#define EGL_CONTEXT_MINOR_VERSION 0x30FB
+#define EGL_CONTEXT_OPENGL_PROFILE_MASK 0x30FD
+#define EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT 0x0001
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+
+#define OSMESA_FORMAT 0x22
+#define OSMESA_RGBA 0x1908
+#define OSMESA_DEPTH_BITS 0x30
+#define OSMESA_STENCIL_BITS 0x31
+#define OSMESA_PROFILE 0x33
+#define OSMESA_CORE_PROFILE 0x34
+#define OSMESA_CONTEXT_MAJOR_VERSION 0x36
+#define OSMESA_CONTEXT_MINOR_VERSION 0x37
+
+namespace ew {
+	typedef void* EGLDisplay;
+	typedef void* EGLConfig;
+	typedef void* EGLContext;
+	typedef void* EGLSurface;
+	typedef int EGLint;
+	typedef unsigned int EGLBoolean;
+	typedef unsigned int EGLenum;
+	typedef GLADapiproc(*PFNEGLGETPROCADDRESS)(const char* name);
+	typedef EGLDisplay(*PFNEGLGETDISPLAY)(void* nativeDisplay);
+	typedef EGLDisplay(*PFNEGLGETPLATFORMDISPLAYEXT)(EGLenum platform, void* nativeDisplay, const EGLint* attribs);
+	typedef EGLBoolean(*PFNEGLINITIALIZE)(EGLDisplay display, EGLint* major, EGLint* minor);
+	typedef const char* (*PFNEGLQUERYSTRING)(EGLDisplay display, EGLint name);
+	typedef EGLBoolean(*PFNEGLBINDAPI)(EGLenum api);
+	typedef EGLBoolean(*PFNEGLCHOOSECONFIG)(EGLDisplay display, const EGLint* attribs, EGLConfig* configs, EGLint size, EGLint* numConfigs);
+	typedef EGLContext(*PFNEGLCREATECONTEXT)(EGLDisplay display, EGLConfig config, EGLContext shareContext, const EGLint* attribs);
+	typedef EGLBoolean(*PFNEGLMAKECURRENT)(EGLDisplay display, EGLSurface draw, EGLSurface read, EGLContext context);
+	typedef EGLBoolean(*PFNEGLDESTROYCONTEXT)(EGLDisplay display, EGLContext context);
+	typedef EGLBoolean(*PFNEGLTERMINATE)(EGLDisplay display);
+
+	typedef void* OSMesaContext;
+	typedef OSMesaContext(*PFNOSMESACREATECONTEXTATTRIBS)(const int* attribs, OSMesaContext shareList);
+	typedef unsigned char(*PFNOSMESAMAKECURRENT)(OSMesaContext context, void* buffer, unsigned int type, int width, int height);
+	typedef GLADapiproc(*PFNOSMESAGETPROCADDRESS)(const char* name);
+	typedef void(*PFNOSMESADESTROYCONTEXT)(OSMesaContext context);
+
+	//glad's loader takes a plain function, so the backend's loader is kept here while loading
+	static PFNEGLGETPROCADDRESS s_eglGetProcAddress = nullptr;
+	static PFNOSMESAGETPROCADDRESS s_osmesaGetProcAddress = nullptr;
+
+	static GLADapiproc loadEGLProc(const char* name) {
+		return s_eglGetProcAddress(name);
+	}
+
+	static GLADapiproc loadOSMesaProc(const char* name) {
+		return s_osmesaGetProcAddress(name);
+	}
+
+	static void* openLibrary(const char* const* names, int numNames) {
+		for (int i = 0; i < numNames; i++)
+		{
+#if defined(_WIN32)
+			void* library = (void*)LoadLibraryA(names[i]);
+#else
+			void* library = dlopen(names[i], RTLD_NOW | RTLD_LOCAL);
+#endif
+			if (library != nullptr) {
+				return library;
+			}
+		}
+		return nullptr;
+	}
+
+	static void* getSymbol(void* library, const char* name) {
+#if defined(_WIN32)
+		return (void*)GetProcAddress((HMODULE)library, name);
+#else
+		return dlsym(library, name);
+#endif
+	}
+
+	static void closeLibrary(void* library) {
+#if defined(_WIN32)
+		FreeLibrary((HMODULE)library);
+#else
+		dlclose(library);
+#endif
+	}
+
+	const char* getHeadlessBackendName(HeadlessBackend backend)
+	{
+		switch (backend) {
+		case HeadlessBackend::EGL:
+			return "EGL";
+		case HeadlessBackend::OSMESA:
+			return "OSMesa";
+		default:
+			return "None";
+		}
+	}
+
+	HeadlessContext::~HeadlessContext()
+	{
+		destroy();
+	}
+
+	/// <summary>
+	/// Creates the context and its framebuffer. The context stays current on the calling thread.
+	/// </summary>
+	/// <param name="width">Framebuffer width</param>
+	/// <param name="height">Framebuffer height</param>
+	/// <param name="backend">NONE tries EGL first and falls back to OSMesa</param>
+	/// <returns>False if no backend could create a 4.5 core context</returns>
+	bool HeadlessContext::create(int width, int height, HeadlessBackend backend)
+	{
+		destroy();
+		m_width = width;
+		m_height = height;
+		bool created = false;
+		if (backend != HeadlessBackend::OSMESA) {
+			created = createEGL();
+		}
+		if (!created && backend != HeadlessBackend::EGL) {
+			created = createOSMesa();
+		}
+		if (!created) {
+			printf("Failed to create a headless OpenGL 4.5 context\n");
+			return false;
+		}
+		if (!createFramebuffer()) {
+			destroy();
+			return false;
+		}
+		printf("Headless %s context: %s, %s\n", getHeadlessBackendName(m_backend), glGetString(GL_RENDERER), glGetString(GL_VERSION));
+		return true;
+	}
+
+	/// <summary>
+	/// Surfaceless EGL: the Mesa surfaceless platform if it's there, otherwise the default display, which also
+	/// works headless on NVIDIA. No surface is made, everything renders into the framebuffer object.
+	/// </summary>
+	bool HeadlessContext::createEGL()
+	{
+		const char* names[] = { "libEGL.so.1", "libEGL.so", "libEGL.dll" };
+		void* library = openLibrary(names, 3);
+		if (library == nullptr) {
+			return false;
+		}
+		PFNEGLGETPROCADDRESS eglGetProcAddress = (PFNEGLGETPROCADDRESS)getSymbol(library, "eglGetProcAddress");
+		PFNEGLGETDISPLAY eglGetDisplay = (PFNEGLGETDISPLAY)getSymbol(library, "eglGetDisplay");
+		PFNEGLINITIALIZE eglInitialize = (PFNEGLINITIALIZE)getSymbol(library, "eglInitialize");
+		PFNEGLQUERYSTRING eglQueryString = (PFNEGLQUERYSTRING)getSymbol(library, "eglQueryString");
+		PFNEGLBINDAPI eglBindAPI = (PFNEGLBINDAPI)getSymbol(library, "eglBindAPI");
+		PFNEGLCHOOSECONFIG eglChooseConfig = (PFNEGLCHOOSECONFIG)getSymbol(library, "eglChooseConfig");
+		PFNEGLCREATECONTEXT eglCreateContext = (PFNEGLCREATECONTEXT)getSymbol(library, "eglCreateContext");
+		PFNEGLMAKECURRENT eglMakeCurrent = (PFNEGLMAKECURRENT)getSymbol(library, "eglMakeCurrent");
+		PFNEGLTERMINATE eglTerminate = (PFNEGLTERMINATE)getSymbol(library, "eglTerminate");
+		if (eglGetProcAddress == nullptr || eglGetDisplay == nullptr || eglInitialize == nullptr || eglQueryString == nullptr ||
+			eglBindAPI == nullptr || eglChooseConfig == nullptr || eglCreateContext == nullptr || eglMakeCurrent == nullptr || eglTerminate == nullptr) {
+			closeLibrary(library);
+			return false;
+		}
+
+		EGLDisplay display = nullptr;
+		const char* clientExtensions = eglQueryString(nullptr, EGL_EXTENSIONS);
+		if (clientExtensions != nullptr && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != nullptr) {
+			PFNEGLGETPLATFORMDISPLAYEXT eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXT)eglGetProcAddress("eglGetPlatformDisplayEXT");
+			if (eglGetPlatformDisplayEXT != nullptr) {
+				display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+			}
+		}
+		if (display == nullptr) {
+			display = eglGetDisplay(nullptr);
+		}
+		EGLint major, minor;
+		if (display == nullptr || !eglInitialize(display, &major, &minor)) {
+			closeLibrary(library);
+			return false;
+		}
+		const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+		if (extensions == nullptr || strstr(extensions, "EGL_KHR_surfaceless_context") == nullptr || !eglBindAPI(EGL_OPENGL_API)) {
+			eglTerminate(display);
+			closeLibrary(library);
+			return false;
+		}
+
+		const EGLint configAttribs[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+			EGL_NONE
+		};
+		EGLConfig config = nullptr;
+		EGLint numConfigs = 0;
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 5,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		EGLContext context = nullptr;
+		if (eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) && numConfigs > 0) {
+			context = eglCreateContext(display, config, nullptr, contextAttribs);
+		}
+		if (context == nullptr || !eglMakeCurrent(display, nullptr, nullptr, context)) {
+			eglTerminate(display);
+			closeLibrary(library);
+			return false;
+		}
+
+		s_eglGetProcAddress = eglGetProcAddress;
+		if (!gladLoadGL(loadEGLProc)) {
+			eglMakeCurrent(display, nullptr, nullptr, nullptr);
+			eglTerminate(display);
+			closeLibrary(library);
+			return false;
+		}
+		m_library = library;
+		m_display = display;
+		m_context = context;
+		m_backend = HeadlessBackend::EGL;
+		return true;
+	}
+
+	bool HeadlessContext::createOSMesa()
+	{
+		const char* names[] = { "libOSMesa.so.8", "libOSMesa.so.6", "libOSMesa.so", "osmesa.dll" };
+		void* library = openLibrary(names, 4);
+		if (library == nullptr) {
+			return false;
+		}
+		PFNOSMESACREATECONTEXTATTRIBS OSMesaCreateContextAttribs = (PFNOSMESACREATECONTEXTATTRIBS)getSymbol(library, "OSMesaCreateContextAttribs");
+		PFNOSMESAMAKECURRENT OSMesaMakeCurrent = (PFNOSMESAMAKECURRENT)getSymbol(library, "OSMesaMakeCurrent");
+		PFNOSMESAGETPROCADDRESS OSMesaGetProcAddress = (PFNOSMESAGETPROCADDRESS)getSymbol(library, "OSMesaGetProcAddress");
+		PFNOSMESADESTROYCONTEXT OSMesaDestroyContext = (PFNOSMESADESTROYCONTEXT)getSymbol(library, "OSMesaDestroyContext");
+		if (OSMesaCreateContextAttribs == nullptr || OSMesaMakeCurrent == nullptr || OSMesaGetProcAddress == nullptr || OSMesaDestroyContext == nullptr) {
+			closeLibrary(library);
+			return false;
+		}
+
+		const int attribs[] = {
+			OSMESA_FORMAT, OSMESA_RGBA,
+			OSMESA_DEPTH_BITS, 24,
+			OSMESA_STENCIL_BITS, 8,
+			OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+			OSMESA_CONTEXT_MAJOR_VERSION, 4,
+			OSMESA_CONTEXT_MINOR_VERSION, 5,
+			0
+		};
+		OSMesaContext context = OSMesaCreateContextAttribs(attribs, nullptr);
+		if (context == nullptr) {
+			closeLibrary(library);
+			return false;
+		}
+		m_osmesaBuffer.resize((size_t)m_width * m_height * 4);
+		if (!OSMesaMakeCurrent(context, m_osmesaBuffer.data(), GL_UNSIGNED_BYTE, m_width, m_height)) {
+			OSMesaDestroyContext(context);
+			closeLibrary(library);
+			return false;
+		}
+
+		s_osmesaGetProcAddress = OSMesaGetProcAddress;
+		if (!gladLoadGL(loadOSMesaProc)) {
+			OSMesaDestroyContext(context);
+			closeLibrary(library);
+			return false;
+		}
+		m_library = library;
+		m_context = context;
+		m_backend = HeadlessBackend::OSMESA;
+		return true;
+	}
+
+	bool HeadlessContext::createFramebuffer()
+	{
+		glGenRenderbuffers(1, &m_color);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_color);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+		glGenRenderbuffers(1, &m_depth);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glGenFramebuffers(1, &m_fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+		bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		if (!complete) {
+			printf("Headless framebuffer incomplete!\n");
+		}
+		glViewport(0, 0, m_width, m_height);
+		return complete;
+	}
+
+	void HeadlessContext::destroy()
+	{
+		if (m_backend == HeadlessBackend::NONE) {
+			return;
+		}
+		if (m_fbo != 0) {
+			glDeleteFramebuffers(1, &m_fbo);
+			glDeleteRenderbuffers(1, &m_color);
+			glDeleteRenderbuffers(1, &m_depth);
+			m_fbo = m_color = m_depth = 0;
+		}
+		if (m_backend == HeadlessBackend::EGL) {
+			PFNEGLMAKECURRENT eglMakeCurrent = (PFNEGLMAKECURRENT)getSymbol(m_library, "eglMakeCurrent");
+			PFNEGLDESTROYCONTEXT eglDestroyContext = (PFNEGLDESTROYCONTEXT)getSymbol(m_library, "eglDestroyContext");
+			PFNEGLTERMINATE eglTerminate = (PFNEGLTERMINATE)getSymbol(m_library, "eglTerminate");
+			eglMakeCurrent(m_display, nullptr, nullptr, nullptr);
+			eglDestroyContext(m_display, m_context);
+			eglTerminate(m_display);
+		}
+		else {
+			PFNOSMESADESTROYCONTEXT OSMesaDestroyContext = (PFNOSMESADESTROYCONTEXT)getSymbol(m_library, "OSMesaDestroyContext");
+			OSMesaDestroyContext(m_context);
+			m_osmesaBuffer.clear();
+		}
+		closeLibrary(m_library);
+		m_library = m_display = m_context = nullptr;
+		m_backend = HeadlessBackend::NONE;
+	}
+
+	void HeadlessContext::bindFramebuffer() const
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		glViewport(0, 0, m_width, m_height);
+	}
+
+	std::vector<unsigned char> HeadlessContext::readPixels() const
+	{
+		std::vector<unsigned char> pixels((size_t)m_width * m_height * 4);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		//GL's first row is the bottom one
+		size_t rowSize = (size_t)m_width * 4;
+		std::vector<unsigned char> row(rowSize);
+		for (int y = 0; y < m_height / 2; y++)
+		{
+			unsigned char* top = pixels.data() + y * rowSize;
+			unsigned char* bottom = pixels.data() + (m_height - 1 - y) * rowSize;
+			memcpy(row.data(), top, rowSize);
+			memcpy(top, bottom, rowSize);
+			memcpy(bottom, row.data(), rowSize);
+		}
+		return pixels;
+	}
+
+	bool HeadlessContext::writeImage(const char* filePath) const
+	{
+		std::vector<unsigned char> pixels = readPixels();
+		return writePPM(filePath, pixels.data(), m_width, m_height);
+	}
+
+	bool writePPM(const char* filePath, const unsigned char* rgba, int width, int height)
+	{
+		FILE* file = fopen(filePath, "wb");
+		if (file == NULL) {
+			printf("Failed to open %s for writing\n", filePath);
+			return false;
+		}
+		fprintf(file, "P6\n%d %d\n255\n", width, height);
+		std::vector<unsigned char> rgb((size_t)width * height * 3);
+		for (size_t i = 0; i < (size_t)width * height; i++)
+		{
+			rgb[i * 3 + 0] = rgba[i * 4 + 0];
+			rgb[i * 3 + 1] = rgba[i * 4 + 1];
+			rgb[i * 3 + 2] = rgba[i * 4 + 2];
+		}
+		bool written = fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+		fclose(file);
+		return written;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+
+namespace ew {
+	enum class HeadlessBackend {
+		NONE,
+		EGL, //Surfaceless EGL, works on GPUs and on Mesa's llvmpipe
+		OSMESA //Mesa's software offscreen renderer
+	};
+
+	const char* getHeadlessBackendName(HeadlessBackend backend);
+
+	//OpenGL 4.5 core context without a window, for rendering on build servers. libEGL and libOSMesa are opened
+	//at runtime, so nothing extra is linked and machines without them just fail create(). Frames are drawn into
+	//an RGBA8 framebuffer with a depth/stencil buffer owned by the context.
+	class HeadlessContext {
+	public:
+		HeadlessContext() {}
+		~HeadlessContext();
+		//Tries EGL then OSMesa, or only the given backend, makes the context current and loads GL with glad.
+		//Returns false if no backend could create a 4.5 context.
+		bool create(int width, int height, HeadlessBackend backend = HeadlessBackend::NONE);
+		void destroy();
+		//Binds the framebuffer and sets the viewport to its size
+		void bindFramebuffer()const;
+		//Waits for rendering and returns RGBA8 texels, top row first
+		std::vector<unsigned char> readPixels()const;
+		//Binary PPM (P6) of the framebuffer, which any image viewer or diff tool reads
+		bool writeImage(const char* filePath)const;
+		inline bool isValid()const { return m_backend != HeadlessBackend::NONE; }
+		inline HeadlessBackend getBackend()const { return m_backend; }
+		inline unsigned int getFramebuffer()const { return m_fbo; }
+		inline int getWidth()const { return m_width; }
+		inline int getHeight()const { return m_height; }
+	private:
+		bool createEGL();
+		bool createOSMesa();
+		bool createFramebuffer();
+
+		HeadlessBackend m_backend = HeadlessBackend::NONE;
+		void* m_library = nullptr;
+		void* m_display = nullptr; //EGLDisplay
+		void* m_context = nullptr; //EGLContext or OSMesaContext
+		std::vector<unsigned char> m_osmesaBuffer; //OSMesa needs a default framebuffer to make the context current
+		unsigned int m_fbo = 0;
+		unsigned int m_color = 0;
+		unsigned int m_depth = 0;
+		int m_width = 0;
+		int m_height = 0;
+	};
+
+	//RGBA8 rows, top row first, written as RGB
+	bool writePPM(const char* filePath, const unsigned char* rgba, int width, int height);
+}
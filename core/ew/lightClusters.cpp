@@ -0,0 +1,76 @@
+#include "lightClusters.h"
+#include "profiler.h"
+#include "external/glad.h"
+#include <math.h>
+
+namespace ew {
+	/// <summary>
+	/// Loads the binning compute shader and allocates buffers for the cluster grid.
+	/// The index list has room for every cluster to hold MAX_LIGHTS_PER_CLUSTER lights. A cluster reached by more
+	/// keeps the first ones found and adds the rest to the dropped count.
+	/// </summary>
+	/// <param name="binShader">File path to the light binning compute shader</param>
+	/// <param name="tilesX">Screen tiles across</param>
+	/// <param name="tilesY">Screen tiles down</param>
+	/// <param name="slices">Depth slices</param>
+	LightClusters::LightClusters(const std::string& binShader, int tilesX, int tilesY, int slices)
+		: m_binShader(binShader), m_tilesX(tilesX), m_tilesY(tilesY), m_slices(slices), m_stats(sizeof(unsigned int) * 2)
+	{
+		size_t numClusters = getNumClusters();
+		glGenBuffers(1, &m_gridBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_gridBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizeof(unsigned int) * 2 * numClusters, NULL, GL_DYNAMIC_COPY);
+		glGenBuffers(1, &m_indexBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizeof(unsigned int) * MAX_LIGHTS_PER_CLUSTER * numClusters, NULL, GL_DYNAMIC_COPY);
+		glGenBuffers(1, &m_counterBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_counterBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizeof(unsigned int) * 2, NULL, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	/// <summary>
+	/// One workgroup per cluster. Each computes its view space bounds from the camera's inverse projection,
+	/// gathers the lights that reach it in shared memory and appends them to the index list.
+	/// </summary>
+	void LightClusters::build(const Camera& camera, const LightBuffer& lights, int screenWidth, int screenHeight)
+	{
+		EW_PROFILE_GPU_SCOPE("Light binning");
+		m_tileSize = glm::vec2(ceilf(screenWidth / (float)m_tilesX), ceilf(screenHeight / (float)m_tilesY));
+		float sliceNear = glm::max(firstSliceDepth, camera.nearPlane);
+		float logRange = logf(camera.farPlane / sliceNear);
+		m_sliceScale = m_slices / logRange;
+		m_sliceBias = -m_slices * logf(sliceNear) / logRange;
+
+		unsigned int zero = 0;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_counterBuffer);
+		glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LightBuffer::POINT_LIGHT_BINDING, lights.getPointBuffer());
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GRID_BINDING, m_gridBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEX_BINDING, m_indexBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BINDING, m_counterBuffer);
+		m_binShader.use();
+		m_binShader.setMat4("_View", camera.viewMatrix());
+		m_binShader.setMat4("_InverseProjection", glm::inverse(camera.projectionMatrix()));
+		m_binShader.setVec2("_ScreenSize", (float)screenWidth, (float)screenHeight);
+		m_binShader.setVec2("_TileSize", m_tileSize);
+		m_binShader.setFloat("_NearPlane", camera.nearPlane);
+		m_binShader.setFloat("_SliceNear", sliceNear);
+		m_binShader.setFloat("_FarPlane", camera.farPlane);
+		m_binShader.setInt("_NumPointLights", lights.getNumPointLights());
+		m_binShader.dispatch(m_tilesX, m_tilesY, m_slices);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+		m_stats.copy(m_counterBuffer, 0);
+	}
+
+	void LightClusters::setUniforms(const Shader& shader) const
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GRID_BINDING, m_gridBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEX_BINDING, m_indexBuffer);
+		shader.setVec3("_ClusterDims", (float)m_tilesX, (float)m_tilesY, (float)m_slices);
+		shader.setVec2("_ClusterTileSize", m_tileSize);
+		shader.setVec2("_ClusterSliceParams", m_sliceScale, m_sliceBias);
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "shader.h"
+#include "camera.h"
+#include "lights.h"
+#include "asyncReadback.h"
+#include <glm/glm.hpp>
+
+namespace ew {
+	//Clustered forward lighting. The view frustum is split into screen tiles and exponential depth slices,
+	//and a compute pass bins point lights into every cluster their range touches. Lists are packed into one
+	//index buffer, so lit shaders only loop over the lights that can reach a fragment's cluster.
+	class LightClusters {
+	public:
+		//SSBO bindings, must match the cluster buffers in the binning and lit shaders
+		static const unsigned int GRID_BINDING = 4; //uvec2 per cluster: offset into the index list, light count
+		static const unsigned int INDEX_BINDING = 5;
+		static const unsigned int COUNTER_BINDING = 6; //Only bound while binning, shared with GpuCuller::VISIBLE_MATERIAL_BINDING
+		//Must match the shared list size in the binning shader. Lights past this in one cluster are dropped and counted.
+		static const int MAX_LIGHTS_PER_CLUSTER = 1024;
+
+		LightClusters(const std::string& binShader, int tilesX = 16, int tilesY = 9, int slices = 24);
+		//Bins the point lights in lights for this camera. The lights must already be uploaded.
+		void build(const Camera& camera, const LightBuffer& lights, int screenWidth, int screenHeight);
+		//Binds the cluster buffers and sets the uniforms lit shaders find their cluster with
+		void setUniforms(const Shader& shader)const;
+		//Stats from a build a few frames ago, read back without stalling. For debug display.
+		inline unsigned int getNumIndices()const { return m_stats.get<unsigned int>(0); }
+		//Lights left out of clusters that were already full
+		inline unsigned int getNumDropped()const { return m_stats.get<unsigned int>(sizeof(unsigned int)); }
+		inline int getNumClusters()const { return m_tilesX * m_tilesY * m_slices; }
+		inline glm::ivec3 getDimensions()const { return glm::ivec3(m_tilesX, m_tilesY, m_slices); }
+
+		float firstSliceDepth = 0.5f; //Slices are exponential from here to the far plane, the first one reaches to the near plane
+	private:
+		ew::Shader m_binShader;
+		int m_tilesX;
+		int m_tilesY;
+		int m_slices;
+		unsigned int m_gridBuffer = 0;
+		unsigned int m_indexBuffer = 0;
+		unsigned int m_counterBuffer = 0; //List length, dropped lights
+		AsyncReadback m_stats;
+		glm::vec2 m_tileSize = glm::vec2(1.0f); //Pixels
+		float m_sliceScale = 1.0f; //slice = log(viewDepth) * scale + bias
+		float m_sliceBias = 0.0f;
+	};
+}
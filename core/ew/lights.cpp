@@ -0,0 +1,64 @@
+#include "lights.h"
+#include "uploadManager.h"
+#include "external/glad.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace ew {
+	glm::mat4 spotLightMatrix(const SpotLight& light, float nearPlane)
+	{
+		glm::vec3 direction = glm::normalize(light.direction);
+		glm::vec3 up = glm::vec3(0, 1, 0);
+		if (glm::abs(glm::dot(direction, up)) >= 0.99f) {
+			up = glm::vec3(0, 0, 1);
+		}
+		float fov = 2.0f * acosf(glm::clamp(light.cosOuter, 0.0f, 1.0f));
+		return glm::perspective(fov, 1.0f, nearPlane, light.range) * glm::lookAt(light.position, light.position + direction, up);
+	}
+
+	/// <summary>
+	/// Creates both buffers with room for one light each, so they can always be bound
+	/// </summary>
+	LightBuffer::LightBuffer()
+	{
+		m_pointCapacity = 1;
+		m_spotCapacity = 1;
+		glGenBuffers(1, &m_pointBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_pointBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizeof(PointLight), NULL, GL_DYNAMIC_DRAW);
+		glGenBuffers(1, &m_spotBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_spotBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizeof(SpotLight), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void LightBuffer::upload(const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights)
+	{
+		m_numPointLights = pointLights.size();
+		m_numSpotLights = spotLights.size();
+		if (m_numPointLights > m_pointCapacity) {
+			m_pointCapacity = glm::max(m_numPointLights, m_pointCapacity * 2);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, m_pointBuffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, sizeof(PointLight) * (size_t)m_pointCapacity, NULL, GL_DYNAMIC_DRAW);
+		}
+		if (m_numSpotLights > m_spotCapacity) {
+			m_spotCapacity = glm::max(m_numSpotLights, m_spotCapacity * 2);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, m_spotBuffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, sizeof(SpotLight) * (size_t)m_spotCapacity, NULL, GL_DYNAMIC_DRAW);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		if (m_numPointLights > 0) {
+			getUploadManager().uploadBuffer(m_pointBuffer, 0, pointLights.data(), sizeof(PointLight) * pointLights.size());
+		}
+		if (m_numSpotLights > 0) {
+			getUploadManager().uploadBuffer(m_spotBuffer, 0, spotLights.data(), sizeof(SpotLight) * spotLights.size());
+		}
+	}
+
+	void LightBuffer::setUniforms(const Shader& shader) const
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POINT_LIGHT_BINDING, m_pointBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPOT_LIGHT_BINDING, m_spotBuffer);
+		shader.setInt("_NumPointLights", m_numPointLights);
+		shader.setInt("_NumSpotLights", m_numSpotLights);
+	}
+}
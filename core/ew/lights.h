@@ -0,0 +1,52 @@
+#pragma once
+#include "shader.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace ew {
+	//Layouts match the std430 light structs in the lit shaders
+	struct PointLight {
+		glm::vec3 position = glm::vec3(0.0f);
+		float range = 5.0f; //Light falls off to nothing here
+		glm::vec3 color = glm::vec3(1.0f);
+		int shadowIndex = -1; //Cube in the point shadow array, -1 for no shadow
+	};
+
+	struct SpotLight {
+		glm::vec3 position = glm::vec3(0.0f);
+		float range = 10.0f;
+		glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+		float cosOuter = 0.8f; //Cosine of the cone's half angle
+		glm::vec3 color = glm::vec3(1.0f);
+		float cosInner = 0.9f; //Cosine of the angle the edge falloff starts at
+		glm::mat4 shadowMatrix = glm::mat4(1.0f);
+		glm::vec4 atlasRect = glm::vec4(0.0f); //Shadow tile in atlas uvs, xy = offset, zw = size. Zero size for no shadow.
+	};
+
+	//Perspective projection covering the spot light's cone out to its range
+	glm::mat4 spotLightMatrix(const SpotLight& light, float nearPlane = 0.05f);
+
+	//Point and spot lights in shader storage buffers, so the lit shaders aren't limited by uniform array sizes
+	class LightBuffer {
+	public:
+		static const unsigned int POINT_LIGHT_BINDING = 2;
+		static const unsigned int SPOT_LIGHT_BINDING = 3;
+
+		LightBuffer();
+		//Buffers grow to fit but never shrink
+		void upload(const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights);
+		//Binds both buffers and sets the light counts
+		void setUniforms(const Shader& shader)const;
+		inline unsigned int getNumPointLights()const { return m_numPointLights; }
+		inline unsigned int getNumSpotLights()const { return m_numSpotLights; }
+		inline unsigned int getPointBuffer()const { return m_pointBuffer; }
+		inline unsigned int getSpotBuffer()const { return m_spotBuffer; }
+	private:
+		unsigned int m_pointBuffer = 0;
+		unsigned int m_spotBuffer = 0;
+		unsigned int m_pointCapacity = 0;
+		unsigned int m_spotCapacity = 0;
+		unsigned int m_numPointLights = 0;
+		unsigned int m_numSpotLights = 0;
+	};
+}
@@ -0,0 +1,134 @@
+#include "materialTextures.h"
+#include "glExtensions.h"
+#include "uploadManager.h"
+#include "external/glad.h"
+#include "external/stb_image.h"
+#include <stdio.h>
+#include <string>
+
+namespace ew {
+	MaterialTextures::~MaterialTextures()
+	{
+		for (TextureArray& textureArray : m_arrays)
+		{
+			//A resident handle keeps its texture alive, so it has to be released before the delete
+			if (textureArray.handle != 0) {
+				makeTextureHandleNonResident(textureArray.handle);
+			}
+			glDeleteTextures(1, &textureArray.texture);
+		}
+		glDeleteBuffers(1, &m_buffer);
+	}
+
+	int MaterialTextures::addTexture(const char* filePath)
+	{
+		stbi_set_flip_vertically_on_load(true);
+		int width, height, numComponents;
+		unsigned char* data = stbi_load(filePath, &width, &height, &numComponents, 4);
+		if (data == NULL) {
+			printf("Failed to load image %s\n", filePath);
+			return -1;
+		}
+		int material = addTexture(data, width, height);
+		stbi_image_free(data);
+		return material;
+	}
+
+	/// <summary>
+	/// Mips are generated right away, the arrays are only created in build() once every layer is known
+	/// </summary>
+	/// <param name="rgba">width * height RGBA8 texels, sRGB color</param>
+	int MaterialTextures::addTexture(const unsigned char* rgba, int width, int height)
+	{
+		size_t arrayIndex = 0;
+		while (arrayIndex < m_arrays.size() && (m_arrays[arrayIndex].width != width || m_arrays[arrayIndex].height != height)) {
+			arrayIndex++;
+		}
+		if (arrayIndex == m_arrays.size()) {
+			m_arrays.push_back(TextureArray());
+			m_arrays[arrayIndex].width = width;
+			m_arrays[arrayIndex].height = height;
+		}
+		TextureArray& textureArray = m_arrays[arrayIndex];
+		textureArray.layers.push_back(generateMipChain(rgba, width, height, MipFilter::BOX, true));
+		m_materials.push_back({ 0, (unsigned int)arrayIndex, (unsigned int)textureArray.layers.size() - 1 });
+		return (int)m_materials.size() - 1;
+	}
+
+	void MaterialTextures::build()
+	{
+		if (m_arrays.size() > MAX_ARRAYS) {
+			printf("%d material texture sizes, only %d can be sampled without bindless textures\n", (int)m_arrays.size(), MAX_ARRAYS);
+		}
+		//Instances in one multi-draw read different handles, which ARB_bindless_texture alone leaves undefined
+		m_hasHandles = isBindlessTextureLoaded() && hasExtension("GL_NV_gpu_shader5");
+		m_memory = 0;
+		for (TextureArray& textureArray : m_arrays)
+		{
+			int numLevels = getNumMipLevels(textureArray.width, textureArray.height);
+			textureArray.numLayers = (int)textureArray.layers.size();
+			glGenTextures(1, &textureArray.texture);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray.texture);
+			glTexStorage3D(GL_TEXTURE_2D_ARRAY, numLevels, GL_SRGB8_ALPHA8, textureArray.width, textureArray.height, textureArray.numLayers);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			for (int layer = 0; layer < textureArray.numLayers; layer++)
+			{
+				for (int level = 0; level < numLevels; level++)
+				{
+					const MipLevel& mip = textureArray.layers[layer].levels[level];
+					glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, mip.width, mip.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, mip.data.data());
+					m_memory += mip.data.size();
+				}
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			textureArray.layers.clear();
+			textureArray.layers.shrink_to_fit();
+
+			//Sampler state is frozen once a handle exists, so this comes after the parameters
+			if (m_hasHandles) {
+				textureArray.handle = getTextureHandle(textureArray.texture);
+				makeTextureHandleResident(textureArray.handle);
+			}
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		for (MaterialTexture& material : m_materials)
+		{
+			material.handle = m_arrays[material.array].handle;
+		}
+		if (m_buffer == 0) {
+			glGenBuffers(1, &m_buffer);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizeof(MaterialTexture) * m_materials.size(), NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		if (!m_materials.empty()) {
+			getUploadManager().uploadBuffer(m_buffer, 0, m_materials.data(), sizeof(MaterialTexture) * m_materials.size());
+		}
+		m_bindless = m_hasHandles;
+	}
+
+	void MaterialTextures::setBindless(bool bindless)
+	{
+		m_bindless = bindless && m_hasHandles;
+	}
+
+	void MaterialTextures::setUniforms(const Shader& shader, int firstUnit) const
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BINDING, m_buffer);
+		shader.setBool("_UseBindless", m_bindless);
+		//Every sampler gets its own unit even when unused, two sampler types on one unit fail the draw
+		for (int i = 0; i < MAX_ARRAYS; i++)
+		{
+			shader.setInt("_MaterialArrays[" + std::to_string(i) + "]", firstUnit + i);
+			if (!m_bindless && i < (int)m_arrays.size()) {
+				glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+				glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrays[i].texture);
+			}
+		}
+	}
+}
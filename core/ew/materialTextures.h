@@ -0,0 +1,64 @@
+#pragma once
+#include "shader.h"
+#include "mipGenerator.h"
+#include <vector>
+#include <stdint.h>
+
+namespace ew {
+	//Layout matches the std430 MaterialTexture struct in materials.glsl
+	struct MaterialTexture {
+		uint64_t handle; //Bindless handle of the array, 0 without ARB_bindless_texture
+		unsigned int array; //Index into the arrays, the bound path samples _MaterialArrays[array]
+		unsigned int layer;
+	};
+
+	//Packs material textures into one GL_TEXTURE_2D_ARRAY per size, so objects with different textures draw
+	//without binding anything between draws. Shaders look up a material index in an SSBO to find the array
+	//and layer. With ARB_bindless_texture the SSBO also holds each array's handle and nothing is bound at all,
+	//otherwise the arrays are bound once per pass. Handles are read per instance, so they are only used
+	//when NV_gpu_shader5 allows sampling with a handle that isn't dynamically uniform.
+	class MaterialTextures {
+	public:
+		static const unsigned int MATERIAL_BINDING = 7;
+		//Arrays the bound path can sample, must match MAX_MATERIAL_ARRAYS in materials.glsl
+		static const int MAX_ARRAYS = 4;
+
+		MaterialTextures() {}
+		//Makes handles non-resident and deletes the arrays, the context must still be current
+		~MaterialTextures();
+		MaterialTextures(const MaterialTextures&) = delete;
+		MaterialTextures& operator=(const MaterialTextures&) = delete;
+		//Returns the material index, or -1 if the image couldn't be loaded. Call before build().
+		int addTexture(const char* filePath);
+		int addTexture(const unsigned char* rgba, int width, int height);
+		//Creates sRGB arrays with CPU generated mips, so sampling returns linear color. Makes bindless handles resident when the extension was
+		//loaded with loadBindlessTexture() and NV_gpu_shader5 is supported, and uploads the material buffer
+		void build();
+		//Falls back to bound arrays if bindless handles weren't created
+		void setBindless(bool bindless);
+		//Binds the material buffer, and the arrays to units firstUnit to firstUnit + MAX_ARRAYS - 1 when not bindless
+		void setUniforms(const Shader& shader, int firstUnit)const;
+		inline bool isBindless()const { return m_bindless; }
+		inline bool hasHandles()const { return m_hasHandles; }
+		inline int getNumMaterials()const { return (int)m_materials.size(); }
+		inline int getNumArrays()const { return (int)m_arrays.size(); }
+		//Texture binds setUniforms makes each pass
+		inline int getBindsPerPass()const { return m_bindless ? 0 : (int)m_arrays.size(); }
+		inline size_t getMemory()const { return m_memory; }
+	private:
+		struct TextureArray {
+			int width;
+			int height;
+			std::vector<MipChain> layers; //Released after build()
+			int numLayers = 0;
+			unsigned int texture = 0;
+			uint64_t handle = 0;
+		};
+		std::vector<TextureArray> m_arrays;
+		std::vector<MaterialTexture> m_materials;
+		unsigned int m_buffer = 0;
+		size_t m_memory = 0;
+		bool m_hasHandles = false;
+		bool m_bindless = false;
+	};
+}
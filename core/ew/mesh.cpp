@@ -7,14 +7,93 @@
 
 #include "mesh.h"
 #include "external/glad.h"
+#include "uploadManager.h"
+#include "geometryPool.h"
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
 
 namespace ew {
+	/// <summary>
+	/// Points attributes 0-2 at the buffer currently bound to GL_ARRAY_BUFFER. Expects the VAO to be bound.
+	/// </summary>
+	static void setVertexAttributes() {
+		//Position attribute
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
+		glEnableVertexAttribArray(0);
+
+		//Normal attribute
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+		glEnableVertexAttribArray(1);
+
+		//UV attribute
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
+		glEnableVertexAttribArray(2);
+	}
+
+	static void waitForFence(void* fence) {
+		GLsync sync = (GLsync)fence;
+		//1ms timeout, loop until the GPU is done with the region
+		while (glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+		glDeleteSync(sync);
+	}
+
 	Mesh::Mesh(const MeshData& meshData)
 	{
 		load(meshData);
 	}
+	/// <summary>
+	/// Creates a mesh with the given usage. Dynamic meshes over-allocate by 50% unless capacities are given.
+	/// </summary>
+	/// <param name="meshData">Initial vertices and indices</param>
+	/// <param name="usage">STATIC or DYNAMIC</param>
+	/// <param name="vertexCapacity">Max vertices a dynamic mesh can hold without reallocating</param>
+	/// <param name="indexCapacity">Max indices a dynamic mesh can hold without reallocating</param>
+	Mesh::Mesh(const MeshData& meshData, MeshUsage usage, unsigned int vertexCapacity, unsigned int indexCapacity)
+	{
+		m_usage = usage;
+		if (m_usage == MeshUsage::DYNAMIC) {
+			unsigned int numVertices = meshData.vertices.size();
+			unsigned int numIndices = meshData.indices.size();
+			allocateDynamicStorage(glm::max(vertexCapacity, numVertices + numVertices / 2), glm::max(indexCapacity, numIndices + numIndices / 2));
+		}
+		load(meshData);
+	}
 	void Mesh::load(const MeshData& meshData)
 	{
+		computeBounds(meshData.vertices.data(), meshData.vertices.size());
+		if (m_usage == MeshUsage::POOLED) {
+			GeometryPool& geometryPool = getGeometryPool();
+			if (m_initialized) {
+				GeometryAllocation previous;
+				previous.baseVertex = m_baseVertex;
+				previous.firstIndex = m_firstIndex;
+				previous.numVertices = m_numVertices;
+				previous.numIndices = m_numIndices;
+				geometryPool.free(previous);
+			}
+			GeometryAllocation allocation = geometryPool.allocate(meshData);
+			m_vao = geometryPool.getVertexArray();
+			m_baseVertex = allocation.baseVertex;
+			m_firstIndex = allocation.firstIndex;
+			m_numVertices = allocation.numVertices;
+			m_numIndices = allocation.numIndices;
+			m_initialized = true;
+			return;
+		}
+		if (m_usage == MeshUsage::DYNAMIC) {
+			unsigned int numVertices = meshData.vertices.size();
+			unsigned int numIndices = meshData.indices.size();
+			if (numVertices > m_vertexCapacity || numIndices > m_indexCapacity) {
+				allocateDynamicStorage(glm::max(m_vertexCapacity, numVertices + numVertices / 2), glm::max(m_indexCapacity, numIndices + numIndices / 2));
+			}
+			if (numIndices > 0) {
+				getUploadManager().uploadBuffer(m_ebo, 0, meshData.indices.data(), sizeof(unsigned int) * numIndices);
+			}
+			m_numIndices = numIndices;
+			updateVertices(meshData.vertices);
+			return;
+		}
 		if (!m_initialized) {
 			glGenVertexArrays(1, &m_vao);
 			glBindVertexArray(m_vao);
@@ -24,17 +103,7 @@ namespace ew {
 
 			glGenBuffers(1, &m_ebo);
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-			//Position attribute
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
-			glEnableVertexAttribArray(0);
-
-			//Normal attribute
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
-			glEnableVertexAttribArray(1);
-
-			//UV attribute
-			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
-			glEnableVertexAttribArray(2);
+			setVertexAttributes();
 
 			m_initialized = true;
 		}
@@ -43,11 +112,16 @@ namespace ew {
 		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
 
+		//Allocate storage only, data is staged through the upload ring
 		if (meshData.vertices.size() > 0) {
-			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), GL_STATIC_DRAW);
+			size_t size = sizeof(Vertex) * meshData.vertices.size();
+			glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STATIC_DRAW);
+			getUploadManager().uploadBuffer(m_vbo, 0, meshData.vertices.data(), size);
 		}
 		if (meshData.indices.size() > 0) {
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+			size_t size = sizeof(unsigned int) * meshData.indices.size();
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, NULL, GL_STATIC_DRAW);
+			getUploadManager().uploadBuffer(m_ebo, 0, meshData.indices.data(), size);
 		}
 		m_numVertices = meshData.vertices.size();
 		m_numIndices = meshData.indices.size();
@@ -56,9 +130,241 @@ namespace ew {
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	}
+	/// <summary>
+	/// (Re)creates immutable vertex and index storage. The vertex buffer holds DYNAMIC_BUFFER_COUNT copies
+	/// of vertexCapacity vertices so the CPU can write one region while the GPU still reads the others.
+	/// </summary>
+	void Mesh::allocateDynamicStorage(unsigned int vertexCapacity, unsigned int indexCapacity)
+	{
+		if (!m_initialized) {
+			glGenVertexArrays(1, &m_vao);
+			m_initialized = true;
+		}
+		else {
+			for (int i = 0; i < DYNAMIC_BUFFER_COUNT; i++)
+			{
+				if (m_fences[i] != nullptr) {
+					waitForFence(m_fences[i]);
+					m_fences[i] = nullptr;
+				}
+			}
+			//Deleting a mapped buffer also unmaps it
+			glDeleteBuffers(1, &m_vbo);
+			glDeleteBuffers(1, &m_ebo);
+		}
+		m_vertexCapacity = glm::max(vertexCapacity, 1u);
+		m_indexCapacity = glm::max(indexCapacity, 1u);
+
+		glBindVertexArray(m_vao);
+		glGenBuffers(1, &m_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glGenBuffers(1, &m_ebo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+
+		size_t vertexSize = sizeof(Vertex) * m_vertexCapacity * DYNAMIC_BUFFER_COUNT;
+		size_t indexSize = sizeof(unsigned int) * m_indexCapacity;
+		if (GLAD_GL_VERSION_4_4) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_ARRAY_BUFFER, vertexSize, NULL, flags | GL_DYNAMIC_STORAGE_BIT);
+			m_mapped = (Vertex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexSize, flags);
+			//Indices are written by copies from the upload ring, or glBufferSubData if the ring couldn't be mapped
+			glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indexSize, NULL, GL_DYNAMIC_STORAGE_BIT);
+		}
+		else {
+			glBufferData(GL_ARRAY_BUFFER, vertexSize, NULL, GL_DYNAMIC_DRAW);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, NULL, GL_STATIC_DRAW);
+			m_mapped = nullptr;
+		}
+		setVertexAttributes();
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		//New storage has no data in any region
+		m_region = 0;
+		m_drawnSinceWrite = false;
+		m_vertices.resize(glm::min((unsigned int)m_vertices.size(), m_vertexCapacity));
+		m_numVertices = m_vertices.size();
+		m_numIndices = glm::min(m_numIndices, m_indexCapacity);
+		for (int i = 0; i < DYNAMIC_BUFFER_COUNT; i++)
+		{
+			m_dirtyBegin[i] = 0;
+			m_dirtyEnd[i] = m_numVertices;
+		}
+	}
+
+	/// <summary>
+	/// Moves writes to the next region once the current one has been drawn, waiting for the GPU to
+	/// finish with it and copying over any ranges it missed while other regions were being written.
+	/// </summary>
+	void Mesh::beginDynamicWrite()
+	{
+		if (!m_drawnSinceWrite && m_dirtyBegin[m_region] >= m_dirtyEnd[m_region]) {
+			return;
+		}
+		if (m_drawnSinceWrite) {
+			m_region = (m_region + 1) % DYNAMIC_BUFFER_COUNT;
+			m_drawnSinceWrite = false;
+			if (m_fences[m_region] != nullptr) {
+				waitForFence(m_fences[m_region]);
+				m_fences[m_region] = nullptr;
+			}
+		}
+		unsigned int begin = m_dirtyBegin[m_region];
+		unsigned int end = glm::min(m_dirtyEnd[m_region], (unsigned int)m_vertices.size());
+		if (begin < end) {
+			size_t offset = (size_t)m_region * m_vertexCapacity + begin;
+			if (m_mapped != nullptr) {
+				memcpy(m_mapped + offset, m_vertices.data() + begin, sizeof(Vertex) * (end - begin));
+			}
+			else {
+				glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+				glBufferSubData(GL_ARRAY_BUFFER, sizeof(Vertex) * offset, sizeof(Vertex) * (end - begin), m_vertices.data() + begin);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+			}
+		}
+		m_dirtyBegin[m_region] = m_dirtyEnd[m_region] = 0;
+	}
+
+	/// <summary>
+	/// Overwrites a range of vertices without reallocating storage. 
+	/// Dynamic meshes write straight into a free region, static meshes copy through the upload ring.
+	/// </summary>
+	/// <param name="vertices">New vertex data</param>
+	/// <param name="first">Index of the first vertex to overwrite</param>
+	/// <param name="count">Number of vertices to overwrite</param>
+	void Mesh::updateVertices(const Vertex* vertices, unsigned int first, unsigned int count)
+	{
+		if (count == 0) {
+			return;
+		}
+		//Checked before the bounds change, so a rejected update leaves them alone
+		if (m_usage == MeshUsage::DYNAMIC && first + count > m_vertexCapacity) {
+			printf("Vertex update exceeds dynamic mesh capacity (%u > %u)\n", first + count, m_vertexCapacity);
+			return;
+		}
+		if (m_usage != MeshUsage::DYNAMIC && first + count > m_numVertices) {
+			printf("Vertex update out of range (%u > %u)\n", first + count, m_numVertices);
+			return;
+		}
+		//Partial updates can only grow the bounds, a full update recomputes them
+		if (first == 0 && count >= m_numVertices) {
+			computeBounds(vertices, count);
+		}
+		else {
+			for (unsigned int i = 0; i < count; i++)
+			{
+				m_bounds.expand(vertices[i].pos);
+			}
+			m_boundingSphere.center = m_bounds.center();
+			m_boundingSphere.radius = glm::length(m_bounds.extents());
+		}
+		if (m_usage == MeshUsage::STATIC) {
+			getUploadManager().uploadBuffer(m_vbo, sizeof(Vertex) * first, vertices, sizeof(Vertex) * count);
+			return;
+		}
+		if (m_usage == MeshUsage::POOLED) {
+			getUploadManager().uploadBuffer(getGeometryPool().getVertexBuffer(), sizeof(Vertex) * ((size_t)m_baseVertex + first), vertices, sizeof(Vertex) * count);
+			return;
+		}
+		beginDynamicWrite();
+		if (first + count > m_vertices.size()) {
+			m_vertices.resize(first + count);
+		}
+		memcpy(m_vertices.data() + first, vertices, sizeof(Vertex) * count);
+
+		size_t offset = (size_t)m_region * m_vertexCapacity + first;
+		if (m_mapped != nullptr) {
+			memcpy(m_mapped + offset, vertices, sizeof(Vertex) * count);
+		}
+		else {
+			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+			glBufferSubData(GL_ARRAY_BUFFER, sizeof(Vertex) * offset, sizeof(Vertex) * count, vertices);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		//The other regions are now stale in this range
+		for (int i = 0; i < DYNAMIC_BUFFER_COUNT; i++)
+		{
+			if (i == m_region) {
+				continue;
+			}
+			if (m_dirtyBegin[i] >= m_dirtyEnd[i]) {
+				m_dirtyBegin[i] = first;
+				m_dirtyEnd[i] = first + count;
+			}
+			else {
+				m_dirtyBegin[i] = glm::min(m_dirtyBegin[i], first);
+				m_dirtyEnd[i] = glm::max(m_dirtyEnd[i], first + count);
+			}
+		}
+		m_numVertices = glm::max(m_numVertices, first + count);
+	}
+	/// <summary>
+	/// Replaces all vertices. The vertex count may shrink, or grow up to the dynamic capacity.
+	/// </summary>
+	void Mesh::updateVertices(const std::vector<Vertex>& vertices)
+	{
+		if (m_usage == MeshUsage::DYNAMIC && vertices.size() < m_vertices.size()) {
+			m_vertices.resize(vertices.size());
+			m_numVertices = vertices.size();
+		}
+		updateVertices(vertices.data(), 0, vertices.size());
+	}
+	/// <summary>
+	/// AABB of all vertex positions, and a sphere around the AABB center reaching the farthest vertex
+	/// </summary>
+	void Mesh::computeBounds(const Vertex* vertices, unsigned int count)
+	{
+		m_bounds = AABB();
+		m_boundingSphere = BoundingSphere();
+		if (count == 0) {
+			return;
+		}
+		m_bounds.min = m_bounds.max = vertices[0].pos;
+		for (unsigned int i = 1; i < count; i++)
+		{
+			m_bounds.expand(vertices[i].pos);
+		}
+		glm::vec3 center = m_bounds.center();
+		float radiusSquared = 0.0f;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			glm::vec3 d = vertices[i].pos - center;
+			radiusSquared = glm::max(radiusSquared, glm::dot(d, d));
+		}
+		m_boundingSphere.center = center;
+		m_boundingSphere.radius = sqrtf(radiusSquared);
+	}
 	void Mesh::draw(ew::DrawMode drawMode) const
 	{
 		glBindVertexArray(m_vao);
+		if (m_usage == MeshUsage::POOLED) {
+			if (drawMode == DrawMode::TRIANGLES) {
+				const void* indexOffset = (const void*)(sizeof(unsigned int) * (size_t)m_firstIndex);
+				glDrawElementsBaseVertex(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, indexOffset, m_baseVertex);
+			}
+			else {
+				glDrawArrays(GL_POINTS, m_baseVertex, m_numVertices);
+			}
+			return;
+		}
+		if (m_usage == MeshUsage::DYNAMIC) {
+			//Each region is a full copy of the vertices, so offset into the one written last
+			int baseVertex = m_region * m_vertexCapacity;
+			if (drawMode == DrawMode::TRIANGLES) {
+				glDrawElementsBaseVertex(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL, baseVertex);
+			}
+			else {
+				glDrawArrays(GL_POINTS, baseVertex, m_numVertices);
+			}
+			if (m_fences[m_region] != nullptr) {
+				glDeleteSync((GLsync)m_fences[m_region]);
+			}
+			m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_drawnSinceWrite = true;
+			return;
+		}
 		if (drawMode == DrawMode::TRIANGLES) {
 			glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL);
 		}
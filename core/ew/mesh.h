@@ -5,6 +5,7 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <vector>
+#include "bounds.h"
 
 namespace ew {
 	struct Vertex {
@@ -23,20 +24,60 @@ namespace ew {
 		POINTS = 1
 	};
 
+	enum class MeshUsage {
+		STATIC = 0, //Uploaded once, reallocated on every load()
+		DYNAMIC = 1, //Immutable over-allocated storage, vertices updated in place every frame
+		POOLED = 2 //Suballocated from the shared GeometryPool, no VAO of its own
+	};
+
 	class Mesh {
 	public:
+		//Number of copies of the vertex data a dynamic mesh cycles through
+		static const int DYNAMIC_BUFFER_COUNT = 3;
+
 		Mesh() {};
 		Mesh(const MeshData& meshData);
+		Mesh(const MeshData& meshData, MeshUsage usage, unsigned int vertexCapacity = 0, unsigned int indexCapacity = 0);
 		void load(const MeshData& meshData);
+		void updateVertices(const Vertex* vertices, unsigned int first, unsigned int count);
+		void updateVertices(const std::vector<Vertex>& vertices);
 		void draw(DrawMode drawMode = DrawMode::TRIANGLES)const;
 		inline int getNumVertices()const { return m_numVertices; }
 		inline int getNumIndices()const { return m_numIndices; }
+		inline MeshUsage getUsage()const { return m_usage; }
+		//Local space bounds, computed at load and grown by vertex updates
+		inline const AABB& getBounds()const { return m_bounds; }
+		inline const BoundingSphere& getBoundingSphere()const { return m_boundingSphere; }
+		//Only valid for POOLED meshes
+		inline unsigned int getBaseVertex()const { return m_baseVertex; }
+		inline unsigned int getFirstIndex()const { return m_firstIndex; }
 	private:
+		void allocateDynamicStorage(unsigned int vertexCapacity, unsigned int indexCapacity);
+		void beginDynamicWrite();
+		void computeBounds(const Vertex* vertices, unsigned int count);
 		bool m_initialized = false;
 		unsigned int m_vao = 0;
 		unsigned int m_vbo = 0;
 		unsigned int m_ebo = 0;
 		unsigned int m_numVertices = 0;
 		unsigned int m_numIndices = 0;
+		AABB m_bounds;
+		BoundingSphere m_boundingSphere;
+
+		//Dynamic mode only
+		MeshUsage m_usage = MeshUsage::STATIC;
+		unsigned int m_vertexCapacity = 0; //Vertices per buffer region
+		unsigned int m_indexCapacity = 0;
+		Vertex* m_mapped = nullptr; //Persistent mapping of all regions, null if glBufferSubData is used
+		int m_region = 0; //Region the next draw reads from
+		std::vector<Vertex> m_vertices; //CPU copy used to bring stale regions up to date
+		unsigned int m_dirtyBegin[DYNAMIC_BUFFER_COUNT] = {}; //Vertex range each region is missing
+		unsigned int m_dirtyEnd[DYNAMIC_BUFFER_COUNT] = {};
+		mutable void* m_fences[DYNAMIC_BUFFER_COUNT] = {}; //GLsync signaled once the GPU is done reading a region
+		mutable bool m_drawnSinceWrite = false;
+
+		//Pooled mode only
+		unsigned int m_baseVertex = 0;
+		unsigned int m_firstIndex = 0;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,297 @@
+#include "mipGenerator.h"
+#include "profiler.h"
+#include <math.h>
+#include <thread>
+#include <functional>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EW_MIP_SSE
+#endif
+
+namespace ew {
+	size_t MipChain::getSize() const
+	{
+		size_t size = 0;
+		for (const MipLevel& level : levels)
+		{
+			size += level.data.size();
+		}
+		return size;
+	}
+
+	int getNumMipLevels(int width, int height)
+	{
+		int levels = 1;
+		while (width > 1 || height > 1) {
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+			levels++;
+		}
+		return levels;
+	}
+
+	/// <summary>
+	/// Splits [0, count) into one contiguous range per thread. The calling thread takes the last range.
+	/// Small counts run inline, threads cost more than they save there.
+	/// </summary>
+	static void parallelFor(int count, int numThreads, const std::function<void(int, int)>& body) {
+		const int MIN_PER_THREAD = 16;
+		if (numThreads > count / MIN_PER_THREAD) {
+			numThreads = count / MIN_PER_THREAD;
+		}
+		if (numThreads <= 1) {
+			body(0, count);
+			return;
+		}
+		std::vector<std::thread> threads;
+		int perThread = (count + numThreads - 1) / numThreads;
+		for (int begin = 0; begin < count; begin += perThread)
+		{
+			int end = begin + perThread < count ? begin + perThread : count;
+			if (end == count) {
+				body(begin, end);
+			}
+			else {
+				threads.emplace_back(body, begin, end);
+			}
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	//----Color space----
+
+	struct SrgbTables {
+		static const int LINEAR_STEPS = 8192;
+		float toLinear[256];
+		unsigned char toSrgb[LINEAR_STEPS + 1];
+		SrgbTables() {
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i <= LINEAR_STEPS; i++)
+			{
+				float c = i / (float)LINEAR_STEPS;
+				float s = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+				toSrgb[i] = (unsigned char)(s * 255.0f + 0.5f);
+			}
+		}
+	};
+
+	static const SrgbTables& getSrgbTables() {
+		static SrgbTables tables;
+		return tables;
+	}
+
+	static float clamp01(float v) {
+		return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+	}
+
+	static void decodeRow(const unsigned char* src, float* dst, int width, bool srgb) {
+		const SrgbTables& tables = getSrgbTables();
+		for (int x = 0; x < width; x++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				dst[x * 4 + c] = srgb ? tables.toLinear[src[x * 4 + c]] : src[x * 4 + c] / 255.0f;
+			}
+			dst[x * 4 + 3] = src[x * 4 + 3] / 255.0f;
+		}
+	}
+
+	static void encodeRow(const float* src, unsigned char* dst, int width, bool srgb) {
+		const SrgbTables& tables = getSrgbTables();
+		for (int x = 0; x < width; x++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				float v = clamp01(src[x * 4 + c]);
+				dst[x * 4 + c] = srgb ? tables.toSrgb[(int)(v * SrgbTables::LINEAR_STEPS + 0.5f)] : (unsigned char)(v * 255.0f + 0.5f);
+			}
+			dst[x * 4 + 3] = (unsigned char)(clamp01(src[x * 4 + 3]) * 255.0f + 0.5f);
+		}
+	}
+
+	//----Filters----
+	//Texels are 4 floats, so one SSE register holds a whole RGBA texel
+
+	//out = sum of weights[i] * texels[i]
+	static void weightedSum(const float* const* texels, const float* weights, int count, float* out) {
+#if defined(EW_MIP_SSE)
+		__m128 sum = _mm_setzero_ps();
+		for (int i = 0; i < count; i++)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(texels[i]), _mm_set1_ps(weights[i])));
+		}
+		_mm_storeu_ps(out, sum);
+#else
+		for (int c = 0; c < 4; c++)
+		{
+			float sum = 0.0f;
+			for (int i = 0; i < count; i++)
+			{
+				sum += texels[i][c] * weights[i];
+			}
+			out[c] = sum;
+		}
+#endif
+	}
+
+	static void boxRows(const float* src, int width, int height, float* dst, int dstWidth, int begin, int end) {
+		const float weights[4] = { 0.25f, 0.25f, 0.25f, 0.25f };
+		for (int y = begin; y < end; y++)
+		{
+			const float* row0 = src + (size_t)(y * 2) * width * 4;
+			const float* row1 = src + (size_t)(y * 2 + 1 < height ? y * 2 + 1 : height - 1) * width * 4;
+			for (int x = 0; x < dstWidth; x++)
+			{
+				int x0 = x * 2, x1 = x * 2 + 1 < width ? x * 2 + 1 : width - 1;
+				const float* texels[4] = { row0 + x0 * 4, row0 + x1 * 4, row1 + x0 * 4, row1 + x1 * 4 };
+				weightedSum(texels, weights, 4, dst + ((size_t)y * dstWidth + x) * 4);
+			}
+		}
+	}
+
+	static const int KAISER_TAPS = 6;
+
+	//Modified Bessel function of the first kind, order 0
+	static double besselI0(double x) {
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 20; k++)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	/// <summary>
+	/// Weights for source texels 2x-2 ... 2x+3 of destination texel x. Their centers are 1.25, 0.75 and 0.25
+	/// destination texels either side, windowed to a radius of 1.5. The outer taps are negative, which sharpens.
+	/// </summary>
+	static void kaiserWeights(float* weights) {
+		const double ALPHA = 4.0, RADIUS = 1.5;
+		const double PI = 3.14159265358979323846;
+		double total = 0.0;
+		for (int i = 0; i < KAISER_TAPS; i++)
+		{
+			double t = (i - 2 - 0.5) / 2.0;
+			double sinc = sin(PI * t) / (PI * t);
+			double r = t / RADIUS;
+			double window = besselI0(ALPHA * sqrt(1.0 - r * r)) / besselI0(ALPHA);
+			weights[i] = (float)(sinc * window);
+			total += weights[i];
+		}
+		for (int i = 0; i < KAISER_TAPS; i++)
+		{
+			weights[i] = (float)(weights[i] / total);
+		}
+	}
+
+	static int clampIndex(int i, int size) {
+		return i < 0 ? 0 : (i >= size ? size - 1 : i);
+	}
+
+	//Horizontal pass: rows of src (width wide) into rows of dst (dstWidth wide)
+	static void kaiserHorizontal(const float* src, int width, float* dst, int dstWidth, const float* weights, int begin, int end) {
+		for (int y = begin; y < end; y++)
+		{
+			const float* row = src + (size_t)y * width * 4;
+			for (int x = 0; x < dstWidth; x++)
+			{
+				const float* texels[KAISER_TAPS];
+				for (int i = 0; i < KAISER_TAPS; i++)
+				{
+					texels[i] = row + clampIndex(x * 2 - 2 + i, width) * 4;
+				}
+				weightedSum(texels, weights, KAISER_TAPS, dst + ((size_t)y * dstWidth + x) * 4);
+			}
+		}
+	}
+
+	//Vertical pass: src is height rows of width texels, dst rows [begin, end)
+	static void kaiserVertical(const float* src, int width, int height, float* dst, const float* weights, int begin, int end) {
+		for (int y = begin; y < end; y++)
+		{
+			const float* rows[KAISER_TAPS];
+			for (int i = 0; i < KAISER_TAPS; i++)
+			{
+				rows[i] = src + (size_t)clampIndex(y * 2 - 2 + i, height) * width * 4;
+			}
+			for (int x = 0; x < width; x++)
+			{
+				const float* texels[KAISER_TAPS];
+				for (int i = 0; i < KAISER_TAPS; i++)
+				{
+					texels[i] = rows[i] + x * 4;
+				}
+				weightedSum(texels, weights, KAISER_TAPS, dst + ((size_t)y * width + x) * 4);
+			}
+		}
+	}
+
+	MipChain generateMipChain(const unsigned char* rgba, int width, int height, MipFilter filter, bool srgb, int numThreads)
+	{
+		EW_PROFILE_SCOPE("Generate mip chain");
+		if (numThreads <= 0) {
+			numThreads = (int)std::thread::hardware_concurrency();
+		}
+		MipChain chain;
+		chain.levels.resize(getNumMipLevels(width, height));
+		chain.levels[0] = { width, height, std::vector<unsigned char>(rgba, rgba + (size_t)width * height * 4) };
+
+		float weights[KAISER_TAPS];
+		kaiserWeights(weights);
+
+		//Filtering always reads the float copy of the previous level, never the rounded 8 bit one
+		std::vector<float> src((size_t)width * height * 4);
+		std::vector<float> dst, temp;
+		parallelFor(height, numThreads, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				decodeRow(rgba + (size_t)y * width * 4, &src[(size_t)y * width * 4], width, srgb);
+			}
+		});
+
+		for (int i = 1; i < (int)chain.levels.size(); i++)
+		{
+			int dstWidth = width > 1 ? width / 2 : 1;
+			int dstHeight = height > 1 ? height / 2 : 1;
+			dst.resize((size_t)dstWidth * dstHeight * 4);
+			if (filter == MipFilter::KAISER) {
+				temp.resize((size_t)dstWidth * height * 4);
+				parallelFor(height, numThreads, [&](int begin, int end) {
+					kaiserHorizontal(src.data(), width, temp.data(), dstWidth, weights, begin, end);
+				});
+				parallelFor(dstHeight, numThreads, [&](int begin, int end) {
+					kaiserVertical(temp.data(), dstWidth, height, dst.data(), weights, begin, end);
+				});
+			}
+			else {
+				parallelFor(dstHeight, numThreads, [&](int begin, int end) {
+					boxRows(src.data(), width, height, dst.data(), dstWidth, begin, end);
+				});
+			}
+
+			MipLevel& level = chain.levels[i];
+			level.width = dstWidth;
+			level.height = dstHeight;
+			level.data.resize((size_t)dstWidth * dstHeight * 4);
+			parallelFor(dstHeight, numThreads, [&](int begin, int end) {
+				for (int y = begin; y < end; y++)
+				{
+					encodeRow(&dst[(size_t)y * dstWidth * 4], &level.data[(size_t)y * dstWidth * 4], dstWidth, srgb);
+				}
+			});
+			src.swap(dst);
+			width = dstWidth;
+			height = dstHeight;
+		}
+		return chain;
+	}
+}
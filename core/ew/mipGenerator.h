@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+
+namespace ew {
+	enum class MipFilter {
+		BOX, //2x2 average
+		KAISER //Kaiser windowed sinc, 6 taps per axis. Keeps more detail in the smaller levels.
+	};
+
+	struct MipLevel {
+		int width;
+		int height;
+		std::vector<unsigned char> data; //RGBA8
+	};
+
+	//Level 0 first, down to 1x1
+	struct MipChain {
+		std::vector<MipLevel> levels;
+		size_t getSize()const;
+	};
+
+	//Builds a full mip chain from RGBA8 texels. Levels are filtered in floating point from the previous level.
+	//With srgb set, color is converted to linear before filtering and back after, so dark and bright texels
+	//average the way they look instead of darkening. Alpha is always linear.
+	//Rows of each level are split between numThreads threads, 0 uses every hardware thread.
+	MipChain generateMipChain(const unsigned char* rgba, int width, int height, MipFilter filter, bool srgb, int numThreads = 0);
+
+	//Number of levels in a full chain for a width x height image
+	int getNumMipLevels(int width, int height);
+}
@@ -3,6 +3,10 @@
 */
 
 #include "model.h"
+#include "geometryPool.h"
+#include "uploadManager.h"
+#include "profiler.h"
+#include "external/glad.h"
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 
@@ -10,25 +14,72 @@
 #include <glm/glm.hpp>
 
 namespace ew {
-	ew::Mesh processAiMesh(aiMesh* aiMesh);
+	ew::MeshData processAiMesh(aiMesh* aiMesh);
 
 	Model::Model(const std::string& filePath)
 	{
+		EW_PROFILE_SCOPE("Load model");
 		Assimp::Importer importer;
 		const aiScene* aiScene = importer.ReadFile(filePath, aiProcess_Triangulate);
 		for (size_t i = 0; i < aiScene->mNumMeshes; i++)
 		{
 			aiMesh* aiMesh = aiScene->mMeshes[i];
-			m_meshes.push_back(processAiMesh(aiMesh));
+			m_meshes.push_back(ew::Mesh(processAiMesh(aiMesh), ew::MeshUsage::POOLED));
+		}
+
+		for (size_t i = 0; i < m_meshes.size(); i++)
+		{
+			if (i == 0) {
+				m_bounds = m_meshes[i].getBounds();
+			}
+			else {
+				m_bounds.expand(m_meshes[i].getBounds());
+			}
+		}
+		m_boundingSphere.center = m_bounds.center();
+		for (size_t i = 0; i < m_meshes.size(); i++)
+		{
+			const BoundingSphere& sphere = m_meshes[i].getBoundingSphere();
+			m_boundingSphere.radius = glm::max(m_boundingSphere.radius, glm::distance(m_boundingSphere.center, sphere.center) + sphere.radius);
+		}
+
+		//All meshes share the pool's buffers, so one indirect command per mesh is enough to draw them
+		m_commands.resize(m_meshes.size());
+		for (size_t i = 0; i < m_meshes.size(); i++)
+		{
+			m_commands[i].count = m_meshes[i].getNumIndices();
+			m_commands[i].instanceCount = 1;
+			m_commands[i].firstIndex = m_meshes[i].getFirstIndex();
+			m_commands[i].baseVertex = m_meshes[i].getBaseVertex();
+			m_commands[i].baseInstance = 0;
+		}
+		if (m_commands.size() > 0) {
+			size_t size = sizeof(DrawElementsIndirectCommand) * m_commands.size();
+			glGenBuffers(1, &m_commandBuffer);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, size, NULL, GL_STATIC_DRAW);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+			getUploadManager().uploadBuffer(m_commandBuffer, 0, m_commands.data(), size);
 		}
 	}
 
 	void Model::draw()
 	{
-		for (size_t i = 0; i < m_meshes.size(); i++)
-		{
-			m_meshes[i].draw();
+		if (m_meshes.size() == 0) {
+			return;
+		}
+		//Multi-draw indirect needs GL 4.3
+		if (!GLAD_GL_VERSION_4_3) {
+			for (size_t i = 0; i < m_meshes.size(); i++)
+			{
+				m_meshes[i].draw();
+			}
+			return;
 		}
+		getGeometryPool().bind();
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, m_meshes.size(), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 	}
 
 	glm::vec3 convertAIVec3(const aiVector3D& v) {
@@ -36,7 +87,7 @@ namespace ew {
 	}
 
 	//Utility functions local to this file
-	ew::Mesh processAiMesh(aiMesh* aiMesh) {
+	ew::MeshData processAiMesh(aiMesh* aiMesh) {
 		ew::MeshData meshData;
 		for (size_t i = 0; i < aiMesh->mNumVertices; i++)
 		{
@@ -58,7 +109,7 @@ namespace ew {
 				meshData.indices.push_back(aiMesh->mFaces[i].mIndices[j]);
 			}
 		}
-		return ew::Mesh(meshData);
+		return meshData;
 	}
 
 }
@@ -5,14 +5,27 @@
 #pragma once
 #include "mesh.h"
 #include "shader.h"
+#include "geometryPool.h"
 #include <vector>
 
 namespace ew {
 	class Model {
 	public:
 		Model(const std::string& filePath);
+		//Submits every mesh with a single glMultiDrawElementsIndirect call
 		void draw();
+		inline size_t getNumMeshes()const { return m_meshes.size(); }
+		inline const ew::Mesh& getMesh(size_t i)const { return m_meshes[i]; }
+		//One command per mesh with instanceCount 1, for passes that build their own indirect buffers
+		inline const std::vector<DrawElementsIndirectCommand>& getDrawCommands()const { return m_commands; }
+		//Local space bounds enclosing every mesh
+		inline const AABB& getBounds()const { return m_bounds; }
+		inline const BoundingSphere& getBoundingSphere()const { return m_boundingSphere; }
 	private:
 		std::vector<ew::Mesh> m_meshes;
+		std::vector<DrawElementsIndirectCommand> m_commands;
+		unsigned int m_commandBuffer = 0; //GL_DRAW_INDIRECT_BUFFER with one command per mesh
+		AABB m_bounds;
+		BoundingSphere m_boundingSphere;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,75 @@
+#include "pointShadowMaps.h"
+#include "external/glad.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <stdio.h>
+
+namespace ew {
+	/// <summary>
+	/// Creates the depth cube map array and a layered framebuffer that renders into all of its faces
+	/// </summary>
+	/// <param name="resolution">Width and height of each cube face</param>
+	/// <param name="maxLights">Number of cubes, i.e. point lights that can cast shadows at once</param>
+	PointShadowMaps::PointShadowMaps(int resolution, int maxLights)
+		: m_resolution(resolution), m_maxLights(maxLights)
+	{
+		glGenTextures(1, &m_cubeArray);
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_cubeArray);
+		glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 1, GL_DEPTH_COMPONENT32F, m_resolution, m_resolution, m_maxLights * 6);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+		glGenFramebuffers(1, &m_fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_cubeArray, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			printf("Point shadow framebuffer incomplete\n");
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void PointShadowMaps::beginRender()
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		glViewport(0, 0, m_resolution, m_resolution);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+
+	/// <summary>
+	/// Sets a view projection per cube face, in the +X, -X, +Y, -Y, +Z, -Z layer order cube maps use
+	/// </summary>
+	void PointShadowMaps::setRenderUniforms(const Shader& shader, const PointLight& light) const
+	{
+		static const glm::vec3 directions[6] = {
+			glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+			glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+		};
+		static const glm::vec3 ups[6] = {
+			glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1),
+			glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0)
+		};
+		glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, light.range);
+		for (int i = 0; i < 6; i++)
+		{
+			glm::mat4 view = glm::lookAt(light.position, light.position + directions[i], ups[i]);
+			shader.setMat4("_FaceMatrices[" + std::to_string(i) + "]", projection * view);
+		}
+		shader.setInt("_CubeLayer", light.shadowIndex);
+		shader.setVec3("_LightPos", light.position);
+		shader.setFloat("_LightRange", light.range);
+	}
+
+	void PointShadowMaps::setSampleUniforms(const Shader& shader, int textureUnit) const
+	{
+		glActiveTexture(GL_TEXTURE0 + textureUnit);
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_cubeArray);
+		shader.setInt("_PointShadowMaps", textureUnit);
+	}
+}
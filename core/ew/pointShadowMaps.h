@@ -0,0 +1,30 @@
+#pragma once
+#include "shader.h"
+#include "lights.h"
+#include <glm/glm.hpp>
+
+namespace ew {
+	//Omnidirectional point light shadows, one cube per light in a depth cube map array.
+	//A geometry shader with one invocation per face renders all six faces of a light in a single pass.
+	//Depth is distance to the light divided by its range, so lookups compare against the same value.
+	class PointShadowMaps {
+	public:
+		PointShadowMaps(int resolution = 512, int maxLights = 4);
+		//Binds the framebuffer and viewport and clears every cube
+		void beginRender();
+		//Face matrices, cube layer and light position/range for the cube depth shaders
+		void setRenderUniforms(const Shader& shader, const PointLight& light)const;
+		//Binds the cube array to textureUnit for lit shaders
+		void setSampleUniforms(const Shader& shader, int textureUnit)const;
+		inline int getResolution()const { return m_resolution; }
+		inline int getMaxLights()const { return m_maxLights; }
+		inline unsigned int getTexture()const { return m_cubeArray; }
+
+		float nearPlane = 0.05f;
+	private:
+		int m_resolution;
+		int m_maxLights;
+		unsigned int m_fbo = 0;
+		unsigned int m_cubeArray = 0;
+	};
+}
@@ -0,0 +1,456 @@
+#include "profiler.h"
+#include "external/glad.h"
+#include <imgui.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+#include <float.h>
+
+namespace ew {
+	static unsigned long long nowNs() {
+		static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+		return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	//Per thread scope stack. The ring is released when the thread exits so short lived workers don't leak one each.
+	struct ProfileThread {
+		static const unsigned int MAX_DEPTH = 32;
+		ProfileRing* ring = nullptr;
+		unsigned int lane = 0;
+		unsigned int depth = 0;
+		unsigned long long starts[MAX_DEPTH];
+		const char* names[MAX_DEPTH];
+		~ProfileThread() {
+			if (ring != nullptr) {
+				ring->inUse = false;
+			}
+		}
+	};
+	static thread_local ProfileThread t_profileThread;
+
+	bool ProfileRing::push(const ProfileEvent& event)
+	{
+		unsigned int head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) >= CAPACITY) {
+			return false;
+		}
+		m_events[head % CAPACITY] = event;
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	void ProfileRing::drain(std::vector<ProfileEvent>& events)
+	{
+		unsigned int tail = m_tail.load(std::memory_order_relaxed);
+		unsigned int head = m_head.load(std::memory_order_acquire);
+		for (; tail != head; tail++)
+		{
+			events.push_back(m_events[tail % CAPACITY]);
+		}
+		m_tail.store(tail, std::memory_order_release);
+	}
+
+	Profiler::Profiler()
+	{
+		nowNs();
+	}
+
+	//GL queries are not deleted, the context is usually gone by the time statics are destroyed
+	Profiler::~Profiler()
+	{
+		for (ProfileRing* ring : m_rings)
+		{
+			delete ring;
+		}
+	}
+
+	/// <summary>
+	/// Gives the calling thread a ring, reusing one left by a thread that has exited.
+	/// The lane is the ring's index, so a reused ring shows on the same row as its last owner.
+	/// </summary>
+	ProfileRing* Profiler::acquireRing()
+	{
+		std::lock_guard<std::mutex> lock(m_ringsMutex);
+		for (size_t i = 0; i < m_rings.size(); i++)
+		{
+			bool expected = false;
+			if (m_rings[i]->inUse.compare_exchange_strong(expected, true)) {
+				t_profileThread.lane = (unsigned int)i;
+				return m_rings[i];
+			}
+		}
+		ProfileRing* ring = new ProfileRing();
+		ring->inUse = true;
+		t_profileThread.lane = (unsigned int)m_rings.size();
+		m_rings.push_back(ring);
+		return ring;
+	}
+
+	void Profiler::beginCpuScope(const char* name)
+	{
+		ProfileThread& thread = t_profileThread;
+		if (thread.ring == nullptr) {
+			thread.ring = acquireRing();
+		}
+		if (thread.depth < ProfileThread::MAX_DEPTH) {
+			thread.names[thread.depth] = name;
+			thread.starts[thread.depth] = nowNs();
+		}
+		thread.depth++;
+	}
+
+	void Profiler::endCpuScope()
+	{
+		ProfileThread& thread = t_profileThread;
+		if (thread.depth == 0) {
+			return;
+		}
+		thread.depth--;
+		if (thread.depth >= ProfileThread::MAX_DEPTH) {
+			return;
+		}
+		ProfileEvent event = { thread.names[thread.depth], thread.starts[thread.depth], nowNs(), thread.depth, thread.lane };
+		if (!thread.ring->push(event)) {
+			m_droppedEvents++;
+		}
+	}
+
+	/// <summary>
+	/// Starts recording a frame. The GPU slot being reused belongs to the frame GPU_LATENCY ago, if its queries
+	/// still aren't ready they are dropped rather than waited on.
+	/// </summary>
+	void Profiler::beginFrame()
+	{
+		m_inFrame = enabled && !paused;
+		if (!m_inFrame) {
+			return;
+		}
+		if (!m_queriesCreated) {
+			for (GpuFrame& gpuFrame : m_gpuFrames)
+			{
+				glGenQueries(MAX_GPU_SCOPES * 2, gpuFrame.queries);
+			}
+			m_queriesCreated = true;
+		}
+		m_frameIndex++;
+		m_frameStart = nowNs();
+		m_glThread = std::this_thread::get_id();
+		m_gpuDepth = 0;
+
+		GpuFrame& gpuFrame = m_gpuFrames[m_frameIndex % GPU_LATENCY];
+		if (gpuFrame.pending) {
+			m_droppedGpuFrames++;
+			gpuFrame.pending = false;
+		}
+		gpuFrame.numScopes = 0;
+		gpuFrame.lastQuery = -1;
+		gpuFrame.frameIndex = m_frameIndex;
+		//Timestamps are taken when the GPU gets to them, this only lines the two clocks up approximately
+		GLint64 gpuTime = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+		gpuFrame.clockOffset = (long long)nowNs() - (long long)gpuTime;
+	}
+
+	void Profiler::endFrame()
+	{
+		std::vector<ProfileEvent> events;
+		{
+			std::lock_guard<std::mutex> lock(m_ringsMutex);
+			for (ProfileRing* ring : m_rings)
+			{
+				ring->drain(events);
+			}
+		}
+		if (m_inFrame) {
+			m_inFrame = false;
+			ProfileFrame& frame = m_frames[m_frameIndex % HISTORY];
+			frame.index = m_frameIndex;
+			frame.startNs = m_frameStart;
+			frame.endNs = nowNs();
+			frame.cpuEvents.swap(events);
+			std::sort(frame.cpuEvents.begin(), frame.cpuEvents.end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+				return a.lane != b.lane ? a.lane < b.lane : a.startNs < b.startNs;
+			});
+			frame.gpuEvents.clear();
+			GpuFrame& gpuFrame = m_gpuFrames[m_frameIndex % GPU_LATENCY];
+			gpuFrame.pending = gpuFrame.lastQuery >= 0;
+			frame.gpuReady = !gpuFrame.pending;
+		}
+		//Timestamps complete in order, so a frame is ready once the last one issued is
+		for (GpuFrame& gpuFrame : m_gpuFrames)
+		{
+			if (!gpuFrame.pending) {
+				continue;
+			}
+			GLint available = 0;
+			glGetQueryObjectiv(gpuFrame.queries[gpuFrame.lastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				readGpuFrame(gpuFrame);
+			}
+		}
+	}
+
+	int Profiler::beginGpuScope(const char* name)
+	{
+		if (!m_inFrame || std::this_thread::get_id() != m_glThread) {
+			return -1;
+		}
+		GpuFrame& gpuFrame = m_gpuFrames[m_frameIndex % GPU_LATENCY];
+		if (gpuFrame.numScopes >= MAX_GPU_SCOPES) {
+			return -1;
+		}
+		int scope = gpuFrame.numScopes++;
+		gpuFrame.names[scope] = name;
+		gpuFrame.depths[scope] = m_gpuDepth++;
+		glQueryCounter(gpuFrame.queries[scope * 2], GL_TIMESTAMP);
+		gpuFrame.lastQuery = scope * 2;
+		return scope;
+	}
+
+	void Profiler::endGpuScope(int scope)
+	{
+		if (scope < 0 || !m_inFrame) {
+			return;
+		}
+		m_gpuDepth--;
+		GpuFrame& gpuFrame = m_gpuFrames[m_frameIndex % GPU_LATENCY];
+		glQueryCounter(gpuFrame.queries[scope * 2 + 1], GL_TIMESTAMP);
+		gpuFrame.lastQuery = scope * 2 + 1;
+	}
+
+	void Profiler::readGpuFrame(GpuFrame& gpuFrame)
+	{
+		gpuFrame.pending = false;
+		ProfileFrame* frame = findFrame(gpuFrame.frameIndex);
+		if (frame == nullptr) {
+			return;
+		}
+		frame->gpuEvents.resize(gpuFrame.numScopes);
+		for (int i = 0; i < gpuFrame.numScopes; i++)
+		{
+			GLuint64 start = 0, end = 0;
+			glGetQueryObjectui64v(gpuFrame.queries[i * 2], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(gpuFrame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+			ProfileEvent& event = frame->gpuEvents[i];
+			event.name = gpuFrame.names[i];
+			event.startNs = (unsigned long long)((long long)start + gpuFrame.clockOffset);
+			event.endNs = (unsigned long long)((long long)end + gpuFrame.clockOffset);
+			event.depth = gpuFrame.depths[i];
+			event.lane = GPU_LANE;
+		}
+		frame->gpuReady = true;
+	}
+
+	ProfileFrame* Profiler::findFrame(unsigned long long index)
+	{
+		ProfileFrame& frame = m_frames[index % HISTORY];
+		return index > 0 && frame.index == index ? &frame : nullptr;
+	}
+
+	const ProfileFrame* Profiler::getLatestFrame() const
+	{
+		for (unsigned long long i = m_frameIndex; i > 0 && i + HISTORY > m_frameIndex; i--)
+		{
+			const ProfileFrame& frame = m_frames[i % HISTORY];
+			if (frame.index == i && frame.gpuReady) {
+				return &frame;
+			}
+		}
+		return nullptr;
+	}
+
+	static void writeTraceEvent(FILE* file, bool& first, const char* name, unsigned int lane, unsigned long long startNs, unsigned long long endNs) {
+		fprintf(file, "%s\n    {\"name\": \"", first ? "" : ",");
+		for (const char* c = name; *c != '\0'; c++)
+		{
+			if (*c == '"' || *c == '\\') {
+				fputc('\\', file);
+			}
+			fputc(*c, file);
+		}
+		fprintf(file, "\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+			lane, startNs / 1000.0, (endNs > startNs ? endNs - startNs : 0) / 1000.0);
+		first = false;
+	}
+
+	/// <summary>
+	/// Complete ("X") events in microseconds. Frames get their own track above the threads and the GPU.
+	/// </summary>
+	bool Profiler::exportChromeTrace(const char* filePath) const
+	{
+		FILE* file = fopen(filePath, "w");
+		if (file == NULL) {
+			printf("Failed to open %s for writing\n", filePath);
+			return false;
+		}
+		const unsigned int FRAME_LANE = GPU_LANE + 1;
+		fprintf(file, "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [");
+		bool first = true;
+		unsigned int maxLane = 0;
+		unsigned long long firstIndex = m_frameIndex >= HISTORY ? m_frameIndex - HISTORY + 1 : 1;
+		for (unsigned long long i = firstIndex; i <= m_frameIndex; i++)
+		{
+			const ProfileFrame& frame = m_frames[i % HISTORY];
+			if (frame.index != i) {
+				continue;
+			}
+			char frameName[32];
+			snprintf(frameName, sizeof(frameName), "Frame %llu", frame.index);
+			writeTraceEvent(file, first, frameName, FRAME_LANE, frame.startNs, frame.endNs);
+			for (const ProfileEvent& event : frame.cpuEvents)
+			{
+				writeTraceEvent(file, first, event.name, event.lane, event.startNs, event.endNs);
+				maxLane = std::max(maxLane, event.lane);
+			}
+			for (const ProfileEvent& event : frame.gpuEvents)
+			{
+				writeTraceEvent(file, first, event.name, event.lane, event.startNs, event.endNs);
+			}
+		}
+		fprintf(file, "%s\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"Frames\"}}", first ? "" : ",", FRAME_LANE);
+		fprintf(file, ",\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"GPU\"}}", GPU_LANE);
+		for (unsigned int lane = 0; lane <= maxLane; lane++)
+		{
+			fprintf(file, ",\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"Thread %u\"}}", lane, lane);
+		}
+		fprintf(file, "\n  ]\n}\n");
+		fclose(file);
+		return true;
+	}
+
+	//Draws the lane starting at events[begin] below y and moves y past it. Returns the first event of the next lane.
+	static size_t drawLane(const std::vector<ProfileEvent>& events, size_t begin, unsigned long long rangeStart, double nsToPixels,
+		float width, float left, float rowHeight, float& y) {
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		unsigned int lane = events[begin].lane;
+		char label[32];
+		if (lane == Profiler::GPU_LANE) {
+			snprintf(label, sizeof(label), "GPU");
+		}
+		else {
+			snprintf(label, sizeof(label), "Thread %u", lane);
+		}
+		drawList->AddText(ImVec2(left, y), ImGui::GetColorU32(ImGuiCol_Text), label);
+		y += rowHeight;
+
+		unsigned int maxDepth = 0;
+		size_t i = begin;
+		for (; i < events.size() && events[i].lane == lane; i++)
+		{
+			const ProfileEvent& event = events[i];
+			maxDepth = std::max(maxDepth, event.depth);
+			float x0 = left + (float)((double)((long long)event.startNs - (long long)rangeStart) * nsToPixels);
+			float x1 = left + (float)((double)((long long)event.endNs - (long long)rangeStart) * nsToPixels);
+			x0 = std::max(x0, left);
+			x1 = std::max(std::min(x1, left + width), x0 + 1.0f);
+			ImVec2 min = ImVec2(x0, y + event.depth * rowHeight);
+			ImVec2 max = ImVec2(x1, min.y + rowHeight - 1.0f);
+
+			unsigned int hash = 2166136261u;
+			for (const char* c = event.name; *c != '\0'; c++)
+			{
+				hash = (hash ^ (unsigned char)*c) * 16777619u;
+			}
+			drawList->AddRectFilled(min, max, (ImU32)ImColor::HSV((hash % 360) / 360.0f, 0.5f, 0.7f));
+			if (max.x - min.x > 8.0f) {
+				drawList->PushClipRect(min, max, true);
+				drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32_WHITE, event.name);
+				drawList->PopClipRect();
+			}
+			if (ImGui::IsMouseHoveringRect(min, max)) {
+				ImGui::SetTooltip("%s\n%.3f ms", event.name, (event.endNs - event.startNs) / 1000000.0);
+			}
+		}
+		y += (maxDepth + 1) * rowHeight;
+		return i;
+	}
+
+	/// <summary>
+	/// The flame view spans from the start of the frame to whichever finishes last, the CPU or the GPU.
+	/// Scopes are colored by name so a pass keeps its color from frame to frame.
+	/// </summary>
+	void Profiler::drawTimeline()
+	{
+		float frameMs[HISTORY];
+		int numFrames = 0;
+		for (unsigned long long i = m_frameIndex >= HISTORY ? m_frameIndex - HISTORY + 1 : 1; i <= m_frameIndex; i++)
+		{
+			const ProfileFrame& frame = m_frames[i % HISTORY];
+			if (frame.index == i) {
+				frameMs[numFrames++] = (frame.endNs - frame.startNs) / 1000000.0f;
+			}
+		}
+		if (numFrames > 0) {
+			char overlay[32];
+			snprintf(overlay, sizeof(overlay), "%.2f ms", frameMs[numFrames - 1]);
+			ImGui::PlotLines("Frame CPU", frameMs, numFrames, 0, overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+		}
+
+		const ProfileFrame* frame = getLatestFrame();
+		if (frame == nullptr) {
+			ImGui::Text("Waiting for GPU results");
+			return;
+		}
+		unsigned long long rangeStart = frame->startNs;
+		unsigned long long rangeEnd = frame->endNs;
+		for (const ProfileEvent& event : frame->gpuEvents)
+		{
+			rangeStart = std::min(rangeStart, event.startNs);
+			rangeEnd = std::max(rangeEnd, event.endNs);
+		}
+		ImGui::Text("Frame %llu, %.3f ms. Dropped: %u events, %u GPU frames", frame->index,
+			(rangeEnd - rangeStart) / 1000000.0, getDroppedEvents(), getDroppedGpuFrames());
+
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+		float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+		double nsToPixels = width / (double)std::max(rangeEnd - rangeStart, 1ull);
+		float y = origin.y;
+
+		//CPU events are sorted by lane, the GPU lane goes last
+		size_t laneBegin = 0;
+		while (laneBegin < frame->cpuEvents.size())
+		{
+			laneBegin = drawLane(frame->cpuEvents, laneBegin, rangeStart, nsToPixels, width, origin.x, rowHeight, y);
+		}
+		if (!frame->gpuEvents.empty()) {
+			drawLane(frame->gpuEvents, 0, rangeStart, nsToPixels, width, origin.x, rowHeight, y);
+		}
+		ImGui::Dummy(ImVec2(width, y - origin.y));
+	}
+
+	Profiler& getProfiler()
+	{
+		static Profiler profiler;
+		return profiler;
+	}
+
+	CpuProfileScope::CpuProfileScope(const char* name)
+		: m_open(getProfiler().enabled)
+	{
+		if (m_open) {
+			getProfiler().beginCpuScope(name);
+		}
+	}
+
+	void CpuProfileScope::end()
+	{
+		if (m_open) {
+			getProfiler().endCpuScope();
+			m_open = false;
+		}
+	}
+
+	GpuProfileScope::GpuProfileScope(const char* name)
+		: m_cpuScope(name), m_scope(getProfiler().beginGpuScope(name))
+	{
+	}
+
+	void GpuProfileScope::end()
+	{
+		getProfiler().endGpuScope(m_scope);
+		m_scope = -1;
+		m_cpuScope.end();
+	}
+}
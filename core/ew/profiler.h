@@ -0,0 +1,140 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ew {
+	struct ProfileEvent {
+		const char* name; //Not copied, use string literals
+		unsigned long long startNs; //Since the profiler was created
+		unsigned long long endNs;
+		unsigned int depth; //Scopes open around this one on the same thread
+		unsigned int lane; //Thread, or the GPU
+	};
+
+	struct ProfileFrame {
+		unsigned long long index = 0;
+		unsigned long long startNs = 0;
+		unsigned long long endNs = 0;
+		std::vector<ProfileEvent> cpuEvents;
+		//Moved onto the CPU clock. Filled in a few frames after the frame ends, once the queries are ready.
+		std::vector<ProfileEvent> gpuEvents;
+		bool gpuReady = false;
+	};
+
+	//Fixed size single producer, single consumer queue. Only the owning thread pushes, only
+	//Profiler::endFrame pops, so neither side takes a lock.
+	class ProfileRing {
+	public:
+		static const unsigned int CAPACITY = 4096;
+		//False if the ring is full, the event is dropped
+		bool push(const ProfileEvent& event);
+		void drain(std::vector<ProfileEvent>& events);
+		std::atomic<bool> inUse{ false }; //Owned by a live thread, free rings are reused by new threads
+	private:
+		ProfileEvent m_events[CAPACITY];
+		std::atomic<unsigned int> m_head{ 0 };
+		std::atomic<unsigned int> m_tail{ 0 };
+	};
+
+	//Hierarchical CPU and GPU scopes, kept for the last HISTORY frames.
+	//CPU scopes may be opened on any thread. GPU scopes use GL_TIMESTAMP queries, so they must be opened on the
+	//GL thread between beginFrame and endFrame. Results are read GPU_LATENCY frames later to avoid stalling.
+	class Profiler {
+	public:
+		static const int HISTORY = 120;
+		static const int GPU_LATENCY = 4;
+		static const int MAX_GPU_SCOPES = 64; //Per frame, later scopes are dropped
+		static const unsigned int GPU_LANE = 0xFFFF;
+
+		Profiler();
+		~Profiler();
+		void beginFrame();
+		void endFrame();
+		void beginCpuScope(const char* name);
+		void endCpuScope();
+		//Returns the scope to pass to endGpuScope, or -1 if it wasn't recorded
+		int beginGpuScope(const char* name);
+		void endGpuScope(int scope);
+
+		//Most recent frame with GPU results, or null
+		const ProfileFrame* getLatestFrame()const;
+		//Every frame still in the history, as Chrome trace JSON (chrome://tracing or ui.perfetto.dev)
+		bool exportChromeTrace(const char* filePath)const;
+		//Frame time graph and a flame view of the latest frame, one row per scope depth for each thread and the GPU
+		void drawTimeline();
+
+		inline unsigned long long getFrameIndex()const { return m_frameIndex; }
+		inline unsigned int getDroppedEvents()const { return m_droppedEvents.load(); }
+		inline unsigned int getDroppedGpuFrames()const { return m_droppedGpuFrames; }
+
+		bool enabled = true;
+		bool paused = false;
+	private:
+		struct GpuFrame {
+			unsigned int queries[MAX_GPU_SCOPES * 2];
+			const char* names[MAX_GPU_SCOPES];
+			unsigned int depths[MAX_GPU_SCOPES];
+			int numScopes = 0;
+			int lastQuery = -1; //Index of the last timestamp issued, not the last scope's end when scopes nest
+			long long clockOffset = 0; //CPU minus GPU time at the start of the frame
+			unsigned long long frameIndex = 0;
+			bool pending = false;
+		};
+		ProfileRing* acquireRing();
+		void readGpuFrame(GpuFrame& gpuFrame);
+		ProfileFrame* findFrame(unsigned long long index);
+
+		std::mutex m_ringsMutex; //Taken when a thread records its first scope and by endFrame, never per scope
+		std::vector<ProfileRing*> m_rings;
+		std::atomic<unsigned int> m_droppedEvents{ 0 };
+		ProfileFrame m_frames[HISTORY];
+		GpuFrame m_gpuFrames[GPU_LATENCY];
+		unsigned long long m_frameIndex = 0;
+		unsigned long long m_frameStart = 0;
+		unsigned int m_gpuDepth = 0;
+		unsigned int m_droppedGpuFrames = 0;
+		bool m_inFrame = false;
+		bool m_queriesCreated = false;
+		std::thread::id m_glThread; //GPU scopes from other threads are ignored
+		friend struct ProfileThread;
+	};
+
+	//Shared profiler for core and the assignments
+	Profiler& getProfiler();
+
+	class CpuProfileScope {
+	public:
+		CpuProfileScope(const char* name);
+		~CpuProfileScope() { end(); }
+		//Closes the scope before the end of the block
+		void end();
+	private:
+		bool m_open;
+	};
+
+	//Also opens a CPU scope, so the time spent submitting the work shows up on the thread too
+	class GpuProfileScope {
+	public:
+		GpuProfileScope(const char* name);
+		~GpuProfileScope() { end(); }
+		void end();
+	private:
+		CpuProfileScope m_cpuScope;
+		int m_scope;
+	};
+}
+
+#define EW_PROFILE_CONCAT_INNER(a, b) a##b
+#define EW_PROFILE_CONCAT(a, b) EW_PROFILE_CONCAT_INNER(a, b)
+
+//Define EW_DISABLE_PROFILER to compile the markers out
+#if defined(EW_DISABLE_PROFILER)
+#define EW_PROFILE_SCOPE(name)
+#define EW_PROFILE_GPU_SCOPE(name)
+#else
+#define EW_PROFILE_SCOPE(name) ew::CpuProfileScope EW_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define EW_PROFILE_GPU_SCOPE(name) ew::GpuProfileScope EW_PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+#endif
+#define EW_PROFILE_FUNCTION() EW_PROFILE_SCOPE(__FUNCTION__)
@@ -10,12 +10,36 @@
 #include <glm/gtc/type_ptr.hpp>
 
 namespace ew {
+	static std::string loadShaderSource(const std::string& filePath, int depth);
+
 	/// <summary>
-	/// Loads shader source code from a file.
+	/// Replaces #include "file" lines with the file's contents. Paths are relative to the including file.
 	/// </summary>
-	/// <param name="filePath"></param>
-	/// <returns></returns>
-	std::string loadShaderSourceFromFile(const std::string& filePath) {
+	static std::string resolveIncludes(const std::string& source, const std::string& filePath, int depth) {
+		size_t slash = filePath.find_last_of("/\\");
+		std::string directory = slash == std::string::npos ? "" : filePath.substr(0, slash + 1);
+		std::stringstream input(source);
+		std::stringstream output;
+		std::string line;
+		while (std::getline(input, line)) {
+			size_t directive = line.find("#include");
+			size_t open = line.find('"');
+			size_t close = line.find('"', open + 1);
+			if (directive == std::string::npos || line.find_first_not_of(" \t") != directive || open == std::string::npos || close == std::string::npos) {
+				output << line << "\n";
+				continue;
+			}
+			output << loadShaderSource(directory + line.substr(open + 1, close - open - 1), depth + 1) << "\n";
+		}
+		return output.str();
+	}
+
+	static std::string loadShaderSource(const std::string& filePath, int depth) {
+		//Includes that include each other would never end
+		if (depth > 16) {
+			printf("Shader includes nested too deeply in %s\n", filePath.c_str());
+			return {};
+		}
 		std::ifstream fstream(filePath);
 		if (!fstream.is_open()) {
 			printf("Failed to load file %s", filePath.c_str());
@@ -23,7 +47,16 @@ namespace ew {
 		}
 		std::stringstream buffer;
 		buffer << fstream.rdbuf();
-		return buffer.str();
+		return resolveIncludes(buffer.str(), filePath, depth);
+	}
+
+	/// <summary>
+	/// Loads shader source code from a file. #include "file" lines are replaced with the included file.
+	/// </summary>
+	/// <param name="filePath"></param>
+	/// <returns></returns>
+	std::string loadShaderSourceFromFile(const std::string& filePath) {
+		return loadShaderSource(filePath, 0);
 	}
 
 	/// <summary>
@@ -57,12 +90,27 @@ namespace ew {
 	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
 	/// <returns></returns>
 	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
+		return createShaderProgram(vertexShaderSource, NULL, fragmentShaderSource);
+	}
+
+	/// <summary>
+	/// Creates a shader program with vertex, geometry and fragment shaders
+	/// </summary>
+	/// <param name="vertexShaderSource">GLSL source code for the vertex shader</param>
+	/// <param name="geometryShaderSource">GLSL source code for the geometry shader, or NULL to skip the stage</param>
+	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
+	/// <returns></returns>
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* geometryShaderSource, const char* fragmentShaderSource) {
 		unsigned int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
+		unsigned int geometryShader = geometryShaderSource != NULL ? createShader(GL_GEOMETRY_SHADER, geometryShaderSource) : 0;
 		unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
 
 		unsigned int shaderProgram = glCreateProgram();
 		//Attach each stage
 		glAttachShader(shaderProgram, vertexShader);
+		if (geometryShader != 0) {
+			glAttachShader(shaderProgram, geometryShader);
+		}
 		glAttachShader(shaderProgram, fragmentShader);
 		//Link all the stages together
 		glLinkProgram(shaderProgram);
@@ -75,10 +123,33 @@ namespace ew {
 		}
 		//The linked program now contains our compiled code, so we can delete these intermediate objects
 		glDeleteShader(vertexShader);
+		if (geometryShader != 0) {
+			glDeleteShader(geometryShader);
+		}
 		glDeleteShader(fragmentShader);
 		return shaderProgram;
 	}
 	/// <summary>
+	/// Creates a shader program with a single compute stage
+	/// </summary>
+	/// <param name="computeShaderSource">GLSL source code for the compute shader</param>
+	/// <returns></returns>
+	unsigned int createComputeProgram(const char* computeShaderSource) {
+		unsigned int computeShader = createShader(GL_COMPUTE_SHADER, computeShaderSource);
+		unsigned int shaderProgram = glCreateProgram();
+		glAttachShader(shaderProgram, computeShader);
+		glLinkProgram(shaderProgram);
+		int success;
+		glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+		if (!success) {
+			char infoLog[512];
+			glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+			printf("Failed to link compute program: %s", infoLog);
+		}
+		glDeleteShader(computeShader);
+		return shaderProgram;
+	}
+	/// <summary>
 	/// Creates a shader instance with vertex + fragment stages
 	/// </summary>
 	/// <param name="vertexShader">File path to vertex shader</param>
@@ -89,10 +160,36 @@ namespace ew {
 		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
 		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
 	}
+	/// <summary>
+	/// Creates a shader instance with vertex + geometry + fragment stages
+	/// </summary>
+	/// <param name="vertexShader">File path to vertex shader</param>
+	/// <param name="geometryShader">File path to geometry shader</param>
+	/// <param name="fragmentShader">File path to fragment shader</param>
+	Shader::Shader(const std::string& vertexShader, const std::string& geometryShader, const std::string& fragmentShader)
+	{
+		std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShader.c_str());
+		std::string geometryShaderSource = ew::loadShaderSourceFromFile(geometryShader.c_str());
+		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
+		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), geometryShaderSource.c_str(), fragmentShaderSource.c_str());
+	}
+	/// <summary>
+	/// Creates a compute shader instance
+	/// </summary>
+	/// <param name="computeShader">File path to compute shader</param>
+	Shader::Shader(const std::string& computeShader)
+	{
+		std::string computeShaderSource = ew::loadShaderSourceFromFile(computeShader.c_str());
+		m_id = ew::createComputeProgram(computeShaderSource.c_str());
+	}
 	void Shader::use()const
 	{
 		glUseProgram(m_id);
 	}
+	void Shader::dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ) const
+	{
+		glDispatchCompute(groupsX, groupsY, groupsZ);
+	}
 	void Shader::setInt(const std::string& name, int v) const
 	{
 		glUniform1i(glGetUniformLocation(m_id, name.c_str()), v);
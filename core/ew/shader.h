@@ -9,10 +9,16 @@
 namespace ew {
 	std::string loadShaderSourceFromFile(const std::string& filePath);
 	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* geometryShaderSource, const char* fragmentShaderSource);
+	unsigned int createComputeProgram(const char* computeShaderSource);
 	class Shader {
 	public:
 		Shader(const std::string& vertexShader, const std::string& fragmentShader);
+		Shader(const std::string& vertexShader, const std::string& geometryShader, const std::string& fragmentShader);
+		explicit Shader(const std::string& computeShader);
 		void use()const;
+		//Compute shaders only
+		void dispatch(unsigned int groupsX, unsigned int groupsY = 1, unsigned int groupsZ = 1)const;
 		void setInt(const std::string& name, int v) const;
 		void setBool(const std::string& name, bool v) const;
 		void setFloat(const std::string& name, float v) const;
@@ -23,6 +29,7 @@ namespace ew {
 		void setVec4(const std::string& name, float x, float y, float z, float w) const;
 		void setVec4(const std::string& name, const glm::vec4& v) const;
 		void setMat4(const std::string& name, const glm::mat4& m) const;
+		inline unsigned int getID()const { return m_id; }
 	private:
 		unsigned int m_id; //Shader program handle
 	};
@@ -0,0 +1,163 @@
+#include "shadowAtlas.h"
+#include "external/glad.h"
+#include <stdio.h>
+#include <math.h>
+
+namespace ew {
+	float screenCoverage(const Camera& camera, const glm::vec3& center, float radius)
+	{
+		if (camera.orthographic) {
+			return glm::min(radius * 2.0f / camera.orthoHeight, 1.0f);
+		}
+		float distance = glm::length(center - camera.position);
+		if (distance <= radius) {
+			return 1.0f;
+		}
+		//Tangent of the angle the sphere subtends, relative to the tangent of half the vertical fov
+		float tanAngle = radius / sqrtf(distance * distance - radius * radius);
+		return glm::min(tanAngle / tanf(glm::radians(camera.fov) * 0.5f), 1.0f);
+	}
+
+	/// <summary>
+	/// Creates the atlas depth texture with comparison sampling and its framebuffer
+	/// </summary>
+	/// <param name="size">Width and height of the atlas, a power of two</param>
+	/// <param name="minTileSize">Smallest tile handed out</param>
+	/// <param name="maxTileSize">Tile size for a light covering the whole screen</param>
+	ShadowAtlas::ShadowAtlas(int size, int minTileSize, int maxTileSize)
+		: m_size(size), m_minTileSize(minTileSize), m_maxTileSize(glm::min(maxTileSize, size))
+	{
+		glGenTextures(1, &m_depth);
+		glBindTexture(GL_TEXTURE_2D, m_depth);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, m_size, m_size);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		//Same texels with comparison off, so the atlas can be shown through a regular sampler2D
+		if (GLAD_GL_VERSION_4_3) {
+			glGenTextures(1, &m_previewView);
+			glTextureView(m_previewView, GL_TEXTURE_2D, m_depth, GL_DEPTH_COMPONENT32F, 0, 1, 0, 1);
+			glBindTexture(GL_TEXTURE_2D, m_previewView);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+
+		glGenFramebuffers(1, &m_fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depth, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			printf("Shadow atlas framebuffer incomplete\n");
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		m_freeTiles.resize(levelOf(m_minTileSize) + 1);
+		reset();
+	}
+
+	int ShadowAtlas::levelOf(int size) const
+	{
+		int level = 0;
+		while ((m_size >> (level + 1)) >= size) {
+			level++;
+		}
+		return level;
+	}
+
+	void ShadowAtlas::reset()
+	{
+		for (size_t i = 0; i < m_freeTiles.size(); i++)
+		{
+			m_freeTiles[i].clear();
+		}
+		AtlasTile whole;
+		whole.size = m_size;
+		m_freeTiles[0].push_back(whole);
+		m_numTiles = 0;
+		m_usedTexels = 0.0f;
+	}
+
+	/// <summary>
+	/// Takes a free tile of the requested level, or splits the nearest larger one into quarters
+	/// and keeps the other three free
+	/// </summary>
+	bool ShadowAtlas::allocate(int size, AtlasTile* tile)
+	{
+		int targetLevel = levelOf(glm::clamp(size, m_minTileSize, m_size));
+		int level = targetLevel;
+		while (level >= 0 && m_freeTiles[level].empty()) {
+			level--;
+		}
+		if (level < 0) {
+			return false;
+		}
+		AtlasTile current = m_freeTiles[level].back();
+		m_freeTiles[level].pop_back();
+		while (level < targetLevel) {
+			int half = current.size / 2;
+			level++;
+			//Pushed in reverse so tiles are handed out in reading order
+			m_freeTiles[level].push_back({ current.x + half, current.y + half, half });
+			m_freeTiles[level].push_back({ current.x, current.y + half, half });
+			m_freeTiles[level].push_back({ current.x + half, current.y, half });
+			current.size = half;
+		}
+		*tile = current;
+		m_numTiles++;
+		m_usedTexels += (float)current.size * current.size;
+		return true;
+	}
+
+	bool ShadowAtlas::allocateAtMost(int size, AtlasTile* tile)
+	{
+		for (int tileSize = size; tileSize >= m_minTileSize; tileSize /= 2)
+		{
+			if (allocate(tileSize, tile)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int ShadowAtlas::tileSizeForCoverage(float coverage) const
+	{
+		float target = coverage * m_maxTileSize;
+		int size = m_minTileSize;
+		while (size < target && size < m_maxTileSize) {
+			size *= 2;
+		}
+		return size;
+	}
+
+	void ShadowAtlas::beginRender()
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		glViewport(0, 0, m_size, m_size);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+
+	void ShadowAtlas::beginTile(const AtlasTile& tile) const
+	{
+		glViewport(tile.x, tile.y, tile.size, tile.size);
+	}
+
+	glm::vec4 ShadowAtlas::getTileRect(const AtlasTile& tile) const
+	{
+		return glm::vec4(tile.x, tile.y, tile.size, tile.size) / (float)m_size;
+	}
+
+	void ShadowAtlas::setSampleUniforms(const Shader& shader, int textureUnit) const
+	{
+		glActiveTexture(GL_TEXTURE0 + textureUnit);
+		glBindTexture(GL_TEXTURE_2D, m_depth);
+		shader.setInt("_ShadowAtlas", textureUnit);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "shader.h"
+#include "camera.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace ew {
+	struct AtlasTile {
+		int x = 0;
+		int y = 0;
+		int size = 0; //0 if nothing was allocated
+	};
+
+	//Fraction of the screen height a sphere covers, 1 if the camera is inside it
+	float screenCoverage(const Camera& camera, const glm::vec3& center, float radius);
+
+	//Packs many shadow maps of power of two sizes into one depth texture.
+	//Tiles are handed out by splitting larger free tiles into quarters, so allocating
+	//largest first never fragments. The atlas is reset and refilled every frame.
+	class ShadowAtlas {
+	public:
+		ShadowAtlas(int size = 4096, int minTileSize = 128, int maxTileSize = 1024);
+		//Frees every tile
+		void reset();
+		//Returns false if no free tile of this size is left. Size is rounded up to a power of two.
+		bool allocate(int size, AtlasTile* tile);
+		//Tries size, then halves it down to the minimum tile size until a tile fits
+		bool allocateAtMost(int size, AtlasTile* tile);
+		//Tile size for a light whose influence covers this fraction of the screen
+		int tileSizeForCoverage(float coverage)const;
+		//Binds the framebuffer and clears the whole atlas
+		void beginRender();
+		//Viewport restricted to one tile
+		void beginTile(const AtlasTile& tile)const;
+		//Tile offset and size in atlas uvs
+		glm::vec4 getTileRect(const AtlasTile& tile)const;
+		//Binds the atlas to textureUnit for lit shaders
+		void setSampleUniforms(const Shader& shader, int textureUnit)const;
+		inline int getSize()const { return m_size; }
+		inline unsigned int getTexture()const { return m_depth; }
+		//View of the atlas without depth comparison for debug display, 0 before GL 4.3
+		inline unsigned int getPreviewTexture()const { return m_previewView; }
+		inline int getNumTiles()const { return m_numTiles; }
+		//Fraction of the atlas handed out since reset()
+		inline float getUsage()const { return m_usedTexels / ((float)m_size * m_size); }
+	private:
+		int levelOf(int size)const;
+
+		int m_size;
+		int m_minTileSize;
+		int m_maxTileSize;
+		unsigned int m_fbo = 0;
+		unsigned int m_depth = 0;
+		unsigned int m_previewView = 0;
+		std::vector<std::vector<AtlasTile>> m_freeTiles; //Per level, level 0 is the whole atlas
+		int m_numTiles = 0;
+		float m_usedTexels = 0.0f;
+	};
+}
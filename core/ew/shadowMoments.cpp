@@ -0,0 +1,115 @@
+#include "shadowMoments.h"
+#include "profiler.h"
+#include "external/glad.h"
+
+namespace ew {
+	constexpr float ShadowMoments::MAX_EXPONENT_16F;
+
+	/// <summary>
+	/// Loads the moments compute shader. Textures are created on the first generate() call.
+	/// </summary>
+	/// <param name="momentsShader">File path to the moments conversion and blur compute shader</param>
+	/// <param name="format">Moments to store, can be changed later with setFormat()</param>
+	ShadowMoments::ShadowMoments(const std::string& momentsShader, MomentFormat format)
+		: m_shader(momentsShader), m_format(format)
+	{
+		glGenSamplers(1, &m_pointSampler);
+		glSamplerParameteri(m_pointSampler, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+		glSamplerParameteri(m_pointSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glSamplerParameteri(m_pointSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glSamplerParameteri(m_pointSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glSamplerParameteri(m_pointSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	static GLenum internalFormat(MomentFormat format) {
+		return format == MomentFormat::VSM ? GL_RG32F : GL_RGBA16F;
+	}
+
+	/// <summary>
+	/// (Re)creates the moments array with a full mip chain and the blur target
+	/// </summary>
+	void ShadowMoments::createTextures(int resolution, int layers)
+	{
+		if (m_moments != 0) {
+			glDeleteTextures(1, &m_moments);
+			glDeleteTextures(1, &m_blurTemp);
+		}
+		m_resolution = resolution;
+		m_layers = layers;
+		m_textureFormat = m_format;
+		int levels = 1;
+		while ((resolution >> levels) > 0) {
+			levels++;
+		}
+
+		glGenTextures(1, &m_moments);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_moments);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, internalFormat(m_format), resolution, resolution, layers);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		//Grazing receivers would otherwise drop to tiny mips and over blur
+		glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY, 8.0f);
+
+		glGenTextures(1, &m_blurTemp);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_blurTemp);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, internalFormat(m_format), resolution, resolution, layers);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+
+	/// <summary>
+	/// Two compute passes over every active cascade: depth to moments with a horizontal blur, then a vertical blur
+	/// into level 0 of the moments array. The rest of the mip chain is generated from it.
+	/// </summary>
+	/// <param name="shadowMap">Shadow map whose depth was rendered this frame</param>
+	void ShadowMoments::generate(const CascadedShadowMap& shadowMap)
+	{
+		EW_PROFILE_GPU_SCOPE("Shadow moments");
+		int numCascades = shadowMap.getNumCascades();
+		if (m_moments == 0 || m_resolution != shadowMap.getResolution() || m_textureFormat != m_format) {
+			createTextures(shadowMap.getResolution(), CascadedShadowMap::MAX_CASCADES);
+		}
+		GLenum format = internalFormat(m_format);
+		unsigned int groups = (m_resolution + 7) / 8;
+
+		m_shader.use();
+		m_shader.setInt("_Src", 0);
+		m_shader.setInt("_Format", (int)m_format);
+		m_shader.setVec2("_Exponents", glm::min(positiveExponent, MAX_EXPONENT_16F), glm::min(negativeExponent, MAX_EXPONENT_16F));
+		m_shader.setInt("_BlurRadius", glm::max(blurRadius, 0));
+		glActiveTexture(GL_TEXTURE0);
+		glBindSampler(0, m_pointSampler);
+
+		//Depth to moments, blurred along x
+		glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap.getTexture());
+		glBindImageTexture(0, m_blurTemp, 0, GL_TRUE, 0, GL_WRITE_ONLY, format);
+		m_shader.setBool("_ConvertDepth", true);
+		m_shader.setVec2("_Direction", 1.0f, 0.0f);
+		m_shader.dispatch(groups, groups, numCascades);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		//Blurred along y into the top mip
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_blurTemp);
+		glBindImageTexture(0, m_moments, 0, GL_TRUE, 0, GL_WRITE_ONLY, format);
+		m_shader.setBool("_ConvertDepth", false);
+		m_shader.setVec2("_Direction", 0.0f, 1.0f);
+		m_shader.dispatch(groups, groups, numCascades);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+		glBindSampler(0, 0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_moments);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+
+	void ShadowMoments::setSampleUniforms(const Shader& shader, int textureUnit) const
+	{
+		glActiveTexture(GL_TEXTURE0 + textureUnit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_moments);
+		shader.setInt("_ShadowMoments", textureUnit);
+		shader.setVec2("_Exponents", glm::min(positiveExponent, MAX_EXPONENT_16F), glm::min(negativeExponent, MAX_EXPONENT_16F));
+		shader.setFloat("_MinVariance", minVariance);
+		shader.setFloat("_LightBleedReduction", lightBleedReduction);
+	}
+}
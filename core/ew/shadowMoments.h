@@ -0,0 +1,46 @@
+#pragma once
+#include "shader.h"
+#include "cascadedShadowMap.h"
+#include <glm/glm.hpp>
+
+namespace ew {
+	enum class MomentFormat {
+		VSM, //Depth and depth squared in RG32F
+		EVSM //Positive and negative exponentially warped depth and their squares in RGBA16F
+	};
+
+	//Filterable shadow maps built from a cascaded shadow map's depth layers. Every layer is converted to
+	//moments, blurred with a separable Gaussian and mipmapped, so a single trilinear fetch gives a soft
+	//shadow whose cost doesn't depend on the penumbra size.
+	class ShadowMoments {
+	public:
+		//Largest EVSM exponent whose squared warp still fits in a 16 bit float
+		static constexpr float MAX_EXPONENT_16F = 5.54f;
+
+		ShadowMoments(const std::string& momentsShader, MomentFormat format = MomentFormat::EVSM);
+		//Converts, blurs and mipmaps every active cascade of shadowMap. Call after its depth has been rendered.
+		void generate(const CascadedShadowMap& shadowMap);
+		//Binds the moments to textureUnit and sets the uniforms lit shaders filter them with
+		void setSampleUniforms(const Shader& shader, int textureUnit)const;
+		inline void setFormat(MomentFormat format) { m_format = format; }
+		inline MomentFormat getFormat()const { return m_format; }
+		inline unsigned int getTexture()const { return m_moments; }
+
+		int blurRadius = 2; //Texels each side of the blur kernel, 0 disables it
+		float positiveExponent = 5.0f; //EVSM only, clamped to MAX_EXPONENT_16F
+		float negativeExponent = 5.0f; //EVSM only, clamped to MAX_EXPONENT_16F
+		float minVariance = 0.00002f; //Keeps flat receivers from self shadowing
+		float lightBleedReduction = 0.2f; //Cuts off the low end of the Chebyshev bound, 0-1
+	private:
+		void createTextures(int resolution, int layers);
+
+		ew::Shader m_shader;
+		MomentFormat m_format;
+		MomentFormat m_textureFormat = MomentFormat::VSM; //Format the textures were created with
+		unsigned int m_moments = 0; //Mipmapped array read by lit shaders
+		unsigned int m_blurTemp = 0; //Horizontally blurred moments, one level
+		unsigned int m_pointSampler = 0; //Turns off depth comparison so the shadow map's raw depth can be fetched
+		int m_resolution = 0;
+		int m_layers = 0;
+	};
+}
@@ -5,6 +5,11 @@
 #include "texture.h"
 #include "external/glad.h"
 #include "external/stb_image.h"
+#include "uploadManager.h"
+#include "profiler.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 static int getTextureFormat(int numComponents) {
 	switch (numComponents) {
@@ -18,12 +23,28 @@ static int getTextureFormat(int numComponents) {
 		return GL_RED;
 	}
 }
+//No sRGB formats for one and two channel images, those are data rather than color
+static int getSrgbTextureFormat(int numComponents) {
+	switch (numComponents) {
+	default:
+		return GL_SRGB8_ALPHA8;
+	case 3:
+		return GL_SRGB8;
+	case 2:
+		return GL_RG;
+	case 1:
+		return GL_RED;
+	}
+}
 namespace ew {
 	unsigned int loadTexture(const char* filePath) {
 		stbi_set_flip_vertically_on_load(true);
 		return loadTexture(filePath, GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, true);
 	}
 	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap) {
+		return loadTexture(filePath, wrapMode, magFilter, minFilter, mipmap, false);
+	}
+	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap, bool srgb) {
 		int width, height, numComponents;
 		unsigned char* data = stbi_load(filePath, &width, &height, &numComponents, 0);
 		if (data == NULL) {
@@ -35,7 +56,9 @@ namespace ew {
 		glGenTextures(1, &texture);
 		glBindTexture(GL_TEXTURE_2D, texture);
 		int format = getTextureFormat(numComponents);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		int internalFormat = srgb ? getSrgbTextureFormat(numComponents) : format;
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+		ew::getUploadManager().uploadTexture2D(texture, 0, width, height, format, GL_UNSIGNED_BYTE, data);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
@@ -53,5 +76,110 @@ namespace ew {
 		stbi_image_free(data);
 		return texture;
 	}
-}
 
+	/// <summary>
+	/// Worker threads take images off a shared counter, so a large image doesn't hold up the rest.
+	/// GL calls only happen on the calling thread, after every worker has finished.
+	/// </summary>
+	/// <param name="filePaths">Images to load, flipped vertically like loadTexture</param>
+	/// <param name="filter">Mip downsampling filter</param>
+	/// <param name="srgb">Filter color in linear space and store as sRGB. Use for color textures, not for normal or data maps.</param>
+	/// <param name="stats">Optional timings and sizes</param>
+	/// <returns>One texture per path, in the same order</returns>
+	std::vector<unsigned int> loadTextures(const std::vector<const char*>& filePaths, MipFilter filter, bool srgb, TextureLoadStats* stats) {
+		typedef std::chrono::high_resolution_clock Clock;
+		struct DecodedImage {
+			MipChain mips;
+			double decodeMs = 0.0;
+			double mipMs = 0.0;
+		};
+		int numImages = (int)filePaths.size();
+		std::vector<DecodedImage> images(numImages);
+		int hardwareThreads = (int)std::thread::hardware_concurrency();
+		hardwareThreads = hardwareThreads > 0 ? hardwareThreads : 1;
+		int numWorkers = numImages < hardwareThreads ? numImages : hardwareThreads;
+		//Threads left over when there are fewer images than cores split each image's rows
+		int mipThreads = numWorkers > 0 ? hardwareThreads / numWorkers : 1;
+
+		Clock::time_point cpuStart = Clock::now();
+		std::atomic<int> nextImage(0);
+		auto worker = [&]() {
+			stbi_set_flip_vertically_on_load_thread(true);
+			for (int i = nextImage++; i < numImages; i = nextImage++)
+			{
+				EW_PROFILE_SCOPE("Load image");
+				Clock::time_point start = Clock::now();
+				int width, height, numComponents;
+				unsigned char* data = stbi_load(filePaths[i], &width, &height, &numComponents, 4);
+				if (data == NULL) {
+					printf("Failed to load image %s\n", filePaths[i]);
+					continue;
+				}
+				Clock::time_point decoded = Clock::now();
+				images[i].mips = generateMipChain(data, width, height, filter, srgb, mipThreads);
+				stbi_image_free(data);
+				images[i].decodeMs = std::chrono::duration<double, std::milli>(decoded - start).count();
+				images[i].mipMs = std::chrono::duration<double, std::milli>(Clock::now() - decoded).count();
+			}
+		};
+		std::vector<std::thread> workers;
+		for (int i = 1; i < numWorkers; i++)
+		{
+			workers.emplace_back(worker);
+		}
+		worker();
+		for (std::thread& thread : workers)
+		{
+			thread.join();
+		}
+		double cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - cpuStart).count();
+
+		Clock::time_point uploadStart = Clock::now();
+		std::vector<unsigned int> textures(numImages, 0);
+		for (int i = 0; i < numImages; i++)
+		{
+			const MipChain& mips = images[i].mips;
+			if (mips.levels.empty()) {
+				continue;
+			}
+			textures[i] = createTexture(mips, 0, GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, srgb);
+		}
+
+		if (stats != nullptr) {
+			*stats = TextureLoadStats();
+			stats->cpuMs = cpuMs;
+			stats->uploadMs = std::chrono::duration<double, std::milli>(Clock::now() - uploadStart).count();
+			for (const DecodedImage& image : images)
+			{
+				if (image.mips.levels.empty()) {
+					continue;
+				}
+				stats->numTextures++;
+				stats->decodedBytes += image.mips.levels[0].data.size();
+				stats->mipBytes += image.mips.getSize() - image.mips.levels[0].data.size();
+				stats->decodeMs += image.decodeMs;
+				stats->mipMs += image.mipMs;
+			}
+		}
+		return textures;
+	}
+
+	unsigned int createTexture(const MipChain& mips, int firstLevel, int wrapMode, int magFilter, int minFilter, bool srgb) {
+		int numLevels = (int)mips.levels.size() - firstLevel;
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexStorage2D(GL_TEXTURE_2D, numLevels, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, mips.levels[firstLevel].width, mips.levels[firstLevel].height);
+		for (int level = 0; level < numLevels; level++)
+		{
+			const MipLevel& mip = mips.levels[firstLevel + level];
+			ew::getUploadManager().uploadTexture2D(texture, level, mip.width, mip.height, GL_RGBA, GL_UNSIGNED_BYTE, mip.data.data());
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture;
+	}
+}
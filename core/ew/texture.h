@@ -3,8 +3,32 @@
 */
 
 #pragma once
+#include "mipGenerator.h"
+#include <vector>
 
 namespace ew {
 	unsigned int loadTexture(const char* filePath);
 	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap);
+	//srgb stores RGB and RGBA images as GL_SRGB8(_ALPHA8), so sampling returns linear color. Output then needs
+	//GL_FRAMEBUFFER_SRGB or a gamma correcting pass.
+	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap, bool srgb);
+
+	struct TextureLoadStats {
+		int numTextures = 0;
+		size_t decodedBytes = 0; //Level 0 of every texture as RGBA8
+		size_t mipBytes = 0; //Every other level
+		double decodeMs = 0.0; //Summed over threads
+		double mipMs = 0.0; //Summed over threads
+		double cpuMs = 0.0; //Wall time of the parallel decode and mip generation
+		double uploadMs = 0.0;
+		//Decoded and generated bytes per second of wall time
+		inline double getThroughputMBs()const { return cpuMs > 0.0 ? (decodedBytes + mipBytes) / (cpuMs * 1000.0) : 0.0; }
+	};
+
+	//Decodes the images and builds their mip chains on the CPU, one thread per image and the remaining hardware
+	//threads split across each image's rows. Each texture gets immutable RGBA8 storage with every level uploaded,
+	//instead of glGenerateMipmap, as GL_SRGB8_ALPHA8 when srgb is set. Textures that fail to load are 0.
+	std::vector<unsigned int> loadTextures(const std::vector<const char*>& filePaths, MipFilter filter, bool srgb, TextureLoadStats* stats = nullptr);
+	//Immutable RGBA8 or SRGB8_ALPHA8 texture from the levels of a mip chain starting at firstLevel
+	unsigned int createTexture(const MipChain& mips, int firstLevel, int wrapMode, int magFilter, int minFilter, bool srgb = false);
 }
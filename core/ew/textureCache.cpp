@@ -0,0 +1,362 @@
+#include "textureCache.h"
+#include "texture.h"
+#include "compressedTexture.h"
+#include "profiler.h"
+#include "external/glad.h"
+#include "external/stb_image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+namespace ew {
+	TextureParams::TextureParams()
+		: wrapMode(GL_REPEAT), magFilter(GL_LINEAR), minFilter(GL_LINEAR_MIPMAP_LINEAR)
+	{
+	}
+
+	TextureHandle::TextureHandle(TextureEntry* entry)
+		: m_entry(entry)
+	{
+		m_entry->refCount++;
+	}
+
+	TextureHandle::TextureHandle(const TextureHandle& other)
+		: m_entry(other.m_entry)
+	{
+		if (m_entry != nullptr) {
+			m_entry->refCount++;
+		}
+	}
+
+	TextureHandle& TextureHandle::operator=(const TextureHandle& other)
+	{
+		if (other.m_entry != nullptr) {
+			other.m_entry->refCount++;
+		}
+		if (m_entry != nullptr) {
+			m_entry->refCount--;
+		}
+		m_entry = other.m_entry;
+		return *this;
+	}
+
+	TextureHandle::~TextureHandle()
+	{
+		if (m_entry != nullptr) {
+			m_entry->refCount--;
+		}
+	}
+
+	unsigned int TextureHandle::get() const
+	{
+		if (m_entry == nullptr) {
+			return 0;
+		}
+		m_entry->lastUsedFrame = m_entry->cache->getFrame();
+		return m_entry->texture;
+	}
+
+	void TextureHandle::bind(int unit) const
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, get());
+	}
+
+	//Absolute path, so "assets/a.jpg" and "./assets/a.jpg" share an entry. Unchanged if the file doesn't exist.
+	static std::string canonicalizePath(const char* filePath) {
+#if defined(_WIN32)
+		char buffer[_MAX_PATH];
+		if (_fullpath(buffer, filePath, _MAX_PATH) != NULL) {
+			std::string path = buffer;
+			for (char& c : path)
+			{
+				c = c == '\\' ? '/' : (char)tolower(c);
+			}
+			return path;
+		}
+#else
+		char* resolved = realpath(filePath, NULL);
+		if (resolved != NULL) {
+			std::string path = resolved;
+			free(resolved);
+			return path;
+		}
+#endif
+		return filePath;
+	}
+
+	static bool isCompressedPath(const std::string& path) {
+		const char* extension = ".ewtx";
+		size_t length = strlen(extension);
+		return path.size() >= length && path.compare(path.size() - length, length, extension) == 0;
+	}
+
+	TextureHandle TextureCache::acquire(const char* filePath, const TextureParams& params)
+	{
+		std::string path = canonicalizePath(filePath);
+		char paramKey[64];
+		snprintf(paramKey, sizeof(paramKey), "|%x|%x|%x|%d|%d|%d", params.wrapMode, params.magFilter, params.minFilter, params.mipmap, params.srgb, params.srgbFormat);
+		std::string key = path + paramKey;
+
+		auto it = m_entries.find(key);
+		if (it != m_entries.end() && it->second->texture != 0) {
+			m_stats.hits++;
+			TextureHandle handle(it->second);
+			handle.get();
+			return handle;
+		}
+		m_stats.misses++;
+		TextureEntry* entry;
+		if (it != m_entries.end()) {
+			//Kept alive by handles across a clear()
+			entry = it->second;
+		}
+		else {
+			entry = new TextureEntry();
+			entry->cache = this;
+			entry->path = path;
+			entry->params = params;
+		}
+		if (!load(entry, 0)) {
+			if (it == m_entries.end()) {
+				delete entry;
+			}
+			return TextureHandle();
+		}
+		m_entries[key] = entry;
+		TextureHandle handle(entry);
+		handle.get();
+		enforceBudget();
+		return handle;
+	}
+
+	/// <summary>
+	/// (Re)loads a texture from disk without its first firstLevel levels and replaces its GL texture
+	/// </summary>
+	/// <returns>False if the file couldn't be read, the entry is unchanged then</returns>
+	bool TextureCache::load(TextureEntry* entry, int firstLevel)
+	{
+		const TextureParams& params = entry->params;
+		unsigned int texture = 0;
+		std::vector<size_t> levelBytes;
+		bool srgbFormat = params.srgb && params.srgbFormat;
+		const char* formatName = srgbFormat ? "SRGB8_ALPHA8" : "RGBA8";
+		if (isCompressedPath(entry->path)) {
+			CompressedImage image;
+			if (!readCompressedTexture(entry->path.c_str(), image)) {
+				printf("Failed to load compressed texture %s\n", entry->path.c_str());
+				return false;
+			}
+			bool supported = isBlockFormatSupported(image.format, srgbFormat);
+			for (const CompressedLevel& level : image.levels)
+			{
+				levelBytes.push_back(supported ? level.data.size() : (size_t)level.width * level.height * 4);
+			}
+			formatName = supported ? getBlockFormatName(image.format) : formatName;
+			entry->width = image.width;
+			entry->height = image.height;
+			firstLevel = firstLevel < (int)image.levels.size() ? firstLevel : (int)image.levels.size() - 1;
+			image.levels.erase(image.levels.begin(), image.levels.begin() + firstLevel);
+			texture = createCompressedTexture(image, params.wrapMode, params.magFilter, params.minFilter, srgbFormat);
+		}
+		else {
+			stbi_set_flip_vertically_on_load(true);
+			int width, height, numComponents;
+			unsigned char* data = stbi_load(entry->path.c_str(), &width, &height, &numComponents, 4);
+			if (data == NULL) {
+				printf("Failed to load image %s\n", entry->path.c_str());
+				return false;
+			}
+			MipChain mips;
+			if (params.mipmap) {
+				mips = generateMipChain(data, width, height, MipFilter::BOX, params.srgb);
+			}
+			else {
+				mips.levels.push_back({ width, height, std::vector<unsigned char>(data, data + (size_t)width * height * 4) });
+			}
+			stbi_image_free(data);
+			for (const MipLevel& level : mips.levels)
+			{
+				levelBytes.push_back(level.data.size());
+			}
+			entry->width = width;
+			entry->height = height;
+			firstLevel = firstLevel < (int)mips.levels.size() ? firstLevel : (int)mips.levels.size() - 1;
+			texture = createTexture(mips, firstLevel, params.wrapMode, params.magFilter, params.minFilter, srgbFormat);
+		}
+
+		int internalFormat = 0;
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		if (entry->texture != 0) {
+			glDeleteTextures(1, &entry->texture);
+			m_resident -= entry->bytes;
+		}
+		entry->texture = texture;
+		entry->internalFormat = internalFormat;
+		entry->formatName = formatName;
+		entry->numLevels = (int)levelBytes.size();
+		entry->firstLevel = firstLevel;
+		entry->bytes = 0;
+		for (int i = firstLevel; i < (int)levelBytes.size(); i++)
+		{
+			entry->bytes += levelBytes[i];
+		}
+		entry->levelBytes = levelBytes;
+		m_resident += entry->bytes;
+		return true;
+	}
+
+	/// <summary>
+	/// Moves a texture into smaller storage without its current top level. The remaining levels are
+	/// copied on the GPU, so nothing is read from disk.
+	/// </summary>
+	/// <returns>False if the texture is already at the smallest allowed size</returns>
+	bool TextureCache::dropLevel(TextureEntry* entry)
+	{
+		int numLevels = entry->numLevels - entry->firstLevel;
+		int width = entry->width >> (entry->firstLevel + 1);
+		int height = entry->height >> (entry->firstLevel + 1);
+		if (numLevels <= 1 || width < MIN_DROPPED_SIZE || height < MIN_DROPPED_SIZE) {
+			return false;
+		}
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexStorage2D(GL_TEXTURE_2D, numLevels - 1, entry->internalFormat, width, height);
+		for (int i = 0; i < numLevels - 1; i++)
+		{
+			int levelWidth = width >> i > 0 ? width >> i : 1;
+			int levelHeight = height >> i > 0 ? height >> i : 1;
+			glCopyImageSubData(entry->texture, GL_TEXTURE_2D, i + 1, 0, 0, 0, texture, GL_TEXTURE_2D, i, 0, 0, 0, levelWidth, levelHeight, 1);
+		}
+		const TextureParams& params = entry->params;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glDeleteTextures(1, &entry->texture);
+
+		size_t topBytes = entry->levelBytes[entry->firstLevel];
+		m_resident -= topBytes;
+		entry->bytes -= topBytes;
+		entry->texture = texture;
+		entry->firstLevel++;
+		m_stats.mipDrops++;
+		return true;
+	}
+
+	void TextureCache::enforceBudget()
+	{
+		while (m_resident > m_budget) {
+			//Unreferenced textures go first
+			auto victim = m_entries.end();
+			for (auto it = m_entries.begin(); it != m_entries.end(); it++)
+			{
+				if (it->second->refCount == 0 && (victim == m_entries.end() || it->second->lastUsedFrame < victim->second->lastUsedFrame)) {
+					victim = it;
+				}
+			}
+			if (victim != m_entries.end()) {
+				TextureEntry* entry = victim->second;
+				glDeleteTextures(1, &entry->texture);
+				m_resident -= entry->bytes;
+				delete entry;
+				m_entries.erase(victim);
+				m_stats.evictions++;
+				continue;
+			}
+
+			//Then the top mip of the least recently used texture that still has one to spare
+			TextureEntry* dropped = nullptr;
+			for (auto& pair : m_entries)
+			{
+				TextureEntry* entry = pair.second;
+				if (entry->texture == 0 || entry->numLevels - entry->firstLevel <= 1) {
+					continue;
+				}
+				if ((entry->width >> (entry->firstLevel + 1)) < MIN_DROPPED_SIZE || (entry->height >> (entry->firstLevel + 1)) < MIN_DROPPED_SIZE) {
+					continue;
+				}
+				if (dropped == nullptr || entry->lastUsedFrame < dropped->lastUsedFrame) {
+					dropped = entry;
+				}
+			}
+			if (dropped == nullptr || !dropLevel(dropped)) {
+				break;
+			}
+		}
+	}
+
+	void TextureCache::update()
+	{
+		EW_PROFILE_SCOPE("Texture cache update");
+		m_frame++;
+		enforceBudget();
+
+		//Restore the most recently used reduced texture if its full chain fits again
+		TextureEntry* restore = nullptr;
+		for (auto& pair : m_entries)
+		{
+			TextureEntry* entry = pair.second;
+			if (entry->texture != 0 && entry->firstLevel > 0 && entry->refCount > 0 && (restore == nullptr || entry->lastUsedFrame > restore->lastUsedFrame)) {
+				restore = entry;
+			}
+		}
+		if (restore != nullptr) {
+			size_t fullBytes = 0;
+			for (size_t levelBytes : restore->levelBytes)
+			{
+				fullBytes += levelBytes;
+			}
+			if (m_resident - restore->bytes + fullBytes <= m_budget && load(restore, 0)) {
+				m_stats.restores++;
+			}
+		}
+	}
+
+	void TextureCache::clear()
+	{
+		for (auto it = m_entries.begin(); it != m_entries.end();)
+		{
+			TextureEntry* entry = it->second;
+			glDeleteTextures(1, &entry->texture);
+			entry->texture = 0;
+			entry->bytes = 0;
+			if (entry->refCount == 0) {
+				delete entry;
+				it = m_entries.erase(it);
+			}
+			else {
+				it++;
+			}
+		}
+		m_resident = 0;
+	}
+
+	void TextureCache::setBudget(size_t budgetBytes)
+	{
+		m_budget = budgetBytes;
+		enforceBudget();
+	}
+
+	std::vector<const TextureEntry*> TextureCache::getEntries() const
+	{
+		std::vector<const TextureEntry*> entries;
+		for (auto& pair : m_entries)
+		{
+			entries.push_back(pair.second);
+		}
+		return entries;
+	}
+
+	TextureCache& getTextureCache()
+	{
+		static TextureCache cache;
+		return cache;
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace ew {
+	//Sampler state and how the image is processed. Part of the cache key, so the same file with different
+	//parameters is a different texture.
+	struct TextureParams {
+		int wrapMode;
+		int magFilter;
+		int minFilter;
+		bool mipmap = true;
+		bool srgb = true; //Color data, mips are filtered in linear space
+		bool srgbFormat = false; //Store color data as sRGB so sampling returns linear color, needs sRGB output
+		TextureParams(); //GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR
+	};
+
+	class TextureCache;
+
+	//One cached texture. The GL texture is replaced when mips are dropped or restored, so it shouldn't be held onto.
+	struct TextureEntry {
+		TextureCache* cache;
+		std::string path; //Canonical
+		TextureParams params;
+		unsigned int texture = 0;
+		int width = 0; //Full resolution
+		int height = 0;
+		int numLevels = 0; //Full chain
+		int firstLevel = 0; //Levels dropped to save memory
+		unsigned int internalFormat = 0;
+		const char* formatName = "";
+		std::vector<size_t> levelBytes; //Every level of the full chain
+		size_t bytes = 0; //Resident levels
+		int refCount = 0;
+		unsigned long long lastUsedFrame = 0;
+	};
+
+	//Shared reference to a cached texture. Copies add a reference. The cache keeps textures after their last
+	//reference is gone until it needs the memory. Entries are never freed while referenced, so handles may
+	//outlive the GL context, e.g. as globals.
+	class TextureHandle {
+	public:
+		TextureHandle() {}
+		TextureHandle(const TextureHandle& other);
+		TextureHandle& operator=(const TextureHandle& other);
+		~TextureHandle();
+		//Current GL texture, also marks it used this frame
+		unsigned int get()const;
+		void bind(int unit)const;
+		inline bool isValid()const { return m_entry != nullptr && m_entry->texture != 0; }
+		inline const TextureEntry* getEntry()const { return m_entry; }
+	private:
+		friend class TextureCache;
+		explicit TextureHandle(TextureEntry* entry);
+		TextureEntry* m_entry = nullptr;
+	};
+
+	struct TextureCacheStats {
+		unsigned int hits = 0;
+		unsigned int misses = 0;
+		unsigned int evictions = 0; //Unreferenced textures deleted
+		unsigned int mipDrops = 0; //Levels dropped from referenced textures
+		unsigned int restores = 0; //Textures reloaded at full resolution
+	};
+
+	//Loads textures once per canonical path and parameters. When resident memory goes over the budget,
+	//unreferenced textures are deleted least recently used first. Referenced textures then lose their top
+	//mip, again least recently used first, and are reloaded at full resolution once there is room.
+	//Paths ending in .ewtx load as block compressed textures, others through stb_image with CPU mips.
+	class TextureCache {
+	public:
+		static const size_t DEFAULT_BUDGET = 256 * 1024 * 1024;
+		//Referenced textures keep at least this many texels along their smaller side
+		static const int MIN_DROPPED_SIZE = 64;
+
+		TextureCache(size_t budgetBytes = DEFAULT_BUDGET) : m_budget(budgetBytes) {}
+		//Returns an invalid handle if the file couldn't be loaded
+		TextureHandle acquire(const char* filePath, const TextureParams& params = TextureParams());
+		//Call once per frame. Advances the LRU clock, enforces the budget and restores at most one texture.
+		void update();
+		//Deletes every texture. Handles still alive become invalid.
+		void clear();
+		void setBudget(size_t budgetBytes);
+		inline size_t getBudget()const { return m_budget; }
+		inline size_t getResidentBytes()const { return m_resident; }
+		inline unsigned long long getFrame()const { return m_frame; }
+		inline const TextureCacheStats& getStats()const { return m_stats; }
+		std::vector<const TextureEntry*> getEntries()const;
+	private:
+		bool load(TextureEntry* entry, int firstLevel);
+		bool dropLevel(TextureEntry* entry);
+		void enforceBudget();
+
+		size_t m_budget;
+		size_t m_resident = 0;
+		unsigned long long m_frame = 1;
+		std::unordered_map<std::string, TextureEntry*> m_entries;
+		TextureCacheStats m_stats;
+	};
+
+	//Shared texture cache for the assignments. GL textures are deleted by clear(), not at exit.
+	TextureCache& getTextureCache();
+}
@@ -0,0 +1,275 @@
+#include "uploadManager.h"
+#include "external/glad.h"
+#include <string.h>
+#include <stdio.h>
+
+namespace ew {
+	static size_t alignUp(size_t v, size_t alignment) {
+		return (v + alignment - 1) / alignment * alignment;
+	}
+
+	static size_t getComponentCount(int format) {
+		switch (format) {
+		case GL_RED:
+		case GL_DEPTH_COMPONENT:
+			return 1;
+		case GL_RG:
+			return 2;
+		case GL_RGB:
+		case GL_BGR:
+			return 3;
+		default:
+			return 4;
+		}
+	}
+
+	static size_t getTypeSize(int type) {
+		switch (type) {
+		case GL_UNSIGNED_BYTE:
+		case GL_BYTE:
+			return 1;
+		case GL_UNSIGNED_SHORT:
+		case GL_SHORT:
+		case GL_HALF_FLOAT:
+			return 2;
+		default:
+			return 4;
+		}
+	}
+
+	/// <summary>
+	/// Creates the ring buffer with immutable, persistently and coherently mapped storage.
+	/// Falls back to direct uploads if the context does not support glBufferStorage (GL 4.4)
+	/// </summary>
+	/// <param name="capacity">Ring size in bytes</param>
+	void UploadManager::init(size_t capacity)
+	{
+		if (m_buffer != 0) {
+			shutdown();
+		}
+		m_capacity = capacity;
+		m_head = m_used = m_pending = 0;
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+		if (GLAD_GL_VERSION_4_4) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_COPY_WRITE_BUFFER, m_capacity, NULL, flags);
+			m_mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_capacity, flags);
+		}
+		if (m_mapped == nullptr) {
+			printf("Upload ring could not be persistently mapped, using direct uploads\n");
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void UploadManager::shutdown()
+	{
+		for (size_t i = 0; i < m_fences.size(); i++)
+		{
+			glDeleteSync((GLsync)m_fences[i].sync);
+		}
+		m_fences.clear();
+		if (m_buffer != 0) {
+			if (m_mapped != nullptr) {
+				glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+				glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			}
+			glDeleteBuffers(1, &m_buffer);
+		}
+		m_buffer = 0;
+		m_mapped = nullptr;
+		m_capacity = m_head = m_used = m_pending = 0;
+	}
+
+	/// <summary>
+	/// Reserves space in the ring, waiting on the oldest fences if the GPU still reads the memory we need.
+	/// </summary>
+	/// <param name="size">Bytes to reserve</param>
+	/// <param name="alignment">Required alignment of the returned offset</param>
+	/// <returns>Mapped pointer and buffer offset. ptr is null if the ring is unavailable or too small.</returns>
+	UploadAllocation UploadManager::allocate(size_t size, size_t alignment)
+	{
+		if (m_buffer == 0) {
+			init();
+		}
+		UploadAllocation allocation;
+		if (m_mapped == nullptr || size == 0 || size > m_capacity) {
+			return allocation;
+		}
+		if (m_used == 0) {
+			m_head = 0;
+		}
+		size_t offset = alignUp(m_head, alignment);
+		size_t needed = offset - m_head + size;
+		if (offset + size > m_capacity) {
+			//Skip the tail of the ring and wrap around to the start
+			offset = 0;
+			needed = (m_capacity - m_head) + size;
+		}
+		if (needed > m_capacity) {
+			return allocation;
+		}
+		while (m_capacity - m_used < needed) {
+			if (m_fences.empty()) {
+				fencePending();
+			}
+			waitOldest();
+		}
+		m_used += needed;
+		m_pending += needed;
+		m_head = offset + size;
+
+		allocation.ptr = m_mapped + offset;
+		allocation.offset = offset;
+		allocation.size = size;
+		return allocation;
+	}
+
+	/// <summary>
+	/// Copies client memory into a buffer object through the ring. Large uploads are split into chunks.
+	/// </summary>
+	void UploadManager::uploadBuffer(unsigned int dstBuffer, size_t dstOffset, const void* data, size_t size)
+	{
+		if (m_buffer == 0) {
+			init();
+		}
+		recordUpload(size);
+		if (m_mapped == nullptr) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, dstBuffer);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, dstOffset, size, data);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			return;
+		}
+		const unsigned char* src = (const unsigned char*)data;
+		//Quarter of the ring per chunk so a single upload never has to wait on itself
+		size_t maxChunk = m_capacity / 4;
+		glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, dstBuffer);
+		for (size_t done = 0; done < size;)
+		{
+			size_t chunk = size - done < maxChunk ? size - done : maxChunk;
+			UploadAllocation allocation = allocate(chunk);
+			memcpy(allocation.ptr, src + done, chunk);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.offset, dstOffset + done, chunk);
+			done += chunk;
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	/// <summary>
+	/// Uploads tightly packed pixel data into an already allocated 2D texture level via a pixel unpack buffer.
+	/// Leaves the texture bound to GL_TEXTURE_2D.
+	/// </summary>
+	void UploadManager::uploadTexture2D(unsigned int texture, int level, int width, int height, int format, int type, const void* data)
+	{
+		if (m_buffer == 0) {
+			init();
+		}
+		size_t rowPitch = (size_t)width * getComponentCount(format) * getTypeSize(type);
+		size_t size = rowPitch * height;
+		recordUpload(size);
+
+		int prevAlignment;
+		glGetIntegerv(GL_UNPACK_ALIGNMENT, &prevAlignment);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glBindTexture(GL_TEXTURE_2D, texture);
+
+		size_t maxChunk = m_capacity / 4;
+		if (m_mapped == nullptr || rowPitch > maxChunk) {
+			glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format, type, data);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, prevAlignment);
+			return;
+		}
+		const unsigned char* src = (const unsigned char*)data;
+		int rowsPerChunk = (int)(maxChunk / rowPitch);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+		for (int row = 0; row < height; row += rowsPerChunk)
+		{
+			int rows = height - row < rowsPerChunk ? height - row : rowsPerChunk;
+			UploadAllocation allocation = allocate(rowPitch * rows);
+			memcpy(allocation.ptr, src + rowPitch * row, rowPitch * rows);
+			glTexSubImage2D(GL_TEXTURE_2D, level, 0, row, width, rows, format, type, (const void*)allocation.offset);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, prevAlignment);
+	}
+
+	/// <summary>
+	/// Rolls per-frame stats and releases any regions the GPU has already finished with
+	/// </summary>
+	void UploadManager::beginFrame()
+	{
+		m_stats.bytesLastFrame = m_stats.bytesThisFrame;
+		m_stats.uploadsLastFrame = m_stats.uploadsThisFrame;
+		m_stats.stallsLastFrame = m_stats.stallsThisFrame;
+		m_stats.bytesThisFrame = 0;
+		m_stats.uploadsThisFrame = 0;
+		m_stats.stallsThisFrame = 0;
+		retireCompleted();
+	}
+
+	/// <summary>
+	/// Fences everything written this frame. Call after the frame's draw calls have been issued.
+	/// </summary>
+	void UploadManager::endFrame()
+	{
+		fencePending();
+	}
+
+	void UploadManager::fencePending()
+	{
+		if (m_pending == 0) {
+			return;
+		}
+		FencedRegion region;
+		region.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		region.size = m_pending;
+		m_fences.push_back(region);
+		m_pending = 0;
+	}
+
+	void UploadManager::waitOldest()
+	{
+		FencedRegion region = m_fences.front();
+		m_fences.pop_front();
+		GLenum result = glClientWaitSync((GLsync)region.sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			m_stats.stallsThisFrame++;
+			m_stats.totalStalls++;
+			//1ms timeout, loop until the GPU catches up
+			do {
+				result = glClientWaitSync((GLsync)region.sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			} while (result == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync((GLsync)region.sync);
+		m_used -= region.size;
+	}
+
+	void UploadManager::retireCompleted()
+	{
+		while (!m_fences.empty()) {
+			GLenum result = glClientWaitSync((GLsync)m_fences.front().sync, 0, 0);
+			if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+				break;
+			}
+			glDeleteSync((GLsync)m_fences.front().sync);
+			m_used -= m_fences.front().size;
+			m_fences.pop_front();
+		}
+	}
+
+	void UploadManager::recordUpload(size_t size)
+	{
+		m_stats.bytesThisFrame += size;
+		m_stats.totalBytes += size;
+		m_stats.uploadsThisFrame++;
+	}
+
+	UploadManager& getUploadManager()
+	{
+		static UploadManager uploadManager;
+		return uploadManager;
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stddef.h>
+#include <deque>
+
+namespace ew {
+	struct UploadStats {
+		size_t bytesThisFrame = 0; //Bytes staged since beginFrame()
+		size_t bytesLastFrame = 0; //Bytes staged during the previous frame
+		unsigned int uploadsThisFrame = 0; //Number of upload calls since beginFrame()
+		unsigned int uploadsLastFrame = 0;
+		unsigned int stallsThisFrame = 0; //Times the CPU had to wait on the GPU for ring space
+		unsigned int stallsLastFrame = 0;
+		unsigned int totalStalls = 0;
+		size_t totalBytes = 0;
+	};
+
+	struct UploadAllocation {
+		void* ptr = nullptr; //Write-only pointer into the mapped ring
+		size_t offset = 0; //Offset of ptr from the start of the ring buffer object
+		size_t size = 0;
+	};
+
+	//Persistently mapped, fence-guarded ring buffer that all CPU->GPU data is staged through.
+	//Allocations are valid until the next fence covering them is signaled, so per-frame data
+	//should be written, consumed and then released with endFrame().
+	class UploadManager {
+	public:
+		static const size_t DEFAULT_CAPACITY = 16 * 1024 * 1024;
+
+		UploadManager() {};
+		void init(size_t capacity = DEFAULT_CAPACITY);
+		void shutdown();
+		inline bool isInitialized()const { return m_buffer != 0; }
+		//Returns nullptr ptr if size can never fit in the ring
+		UploadAllocation allocate(size_t size, size_t alignment = 16);
+		void uploadBuffer(unsigned int dstBuffer, size_t dstOffset, const void* data, size_t size);
+		void uploadTexture2D(unsigned int texture, int level, int width, int height, int format, int type, const void* data);
+		void beginFrame();
+		void endFrame();
+		inline unsigned int getBuffer()const { return m_buffer; }
+		inline size_t getCapacity()const { return m_capacity; }
+		inline size_t getBytesInFlight()const { return m_used; }
+		inline const UploadStats& getStats()const { return m_stats; }
+	private:
+		struct FencedRegion {
+			void* sync; //GLsync guarding this region
+			size_t size; //Bytes released once sync is signaled
+		};
+		void fencePending();
+		void waitOldest();
+		void retireCompleted();
+		void recordUpload(size_t size);
+
+		unsigned int m_buffer = 0;
+		unsigned char* m_mapped = nullptr;
+		size_t m_capacity = 0;
+		size_t m_head = 0; //Next write position
+		size_t m_used = 0; //Bytes written but not yet released by a fence
+		size_t m_pending = 0; //Bytes written since the last fence was inserted
+		std::deque<FencedRegion> m_fences;
+		UploadStats m_stats;
+	};
+
+	//Shared upload manager used by Mesh and loadTexture. Initialized on first use.
+	UploadManager& getUploadManager();
+}
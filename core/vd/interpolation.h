@@ -10,26 +10,6 @@ namespace vd
 		Exponential
 	};
 
-	template<typename T>
-	T PickInterpolation(T a, T b, float t, IntMethod interpolation)
-	{
-		switch (interpolation)
-		{
-		case vd::Linear:
-			return Lerp(a, b, t);
-			break;
-		case vd::Cubic:
-			return CubicInterpolate(a, b, t);
-			break;
-		case vd::Cosine:
-			return CosineInterpolate(a, b, t);
-		case vd::Exponential:
-			return ExponentialInterpolate(a, b, t);
-		default:
-			break;
-		}
-	}
-
 	template<typename T>
 	T Lerp(T a, T b, float t)
 	{
@@ -56,6 +36,23 @@ namespace vd
 		return a + (b - a) * s;
 	}
 
+	//Declared after the methods it picks between, GCC and Clang only look up earlier declarations here
+	template<typename T>
+	T PickInterpolation(T a, T b, float t, IntMethod interpolation)
+	{
+		switch (interpolation)
+		{
+		case vd::Cubic:
+			return CubicInterpolate(a, b, t);
+		case vd::Cosine:
+			return CosineInterpolate(a, b, t);
+		case vd::Exponential:
+			return ExponentialInterpolate(a, b, t);
+		default:
+			return Lerp(a, b, t);
+		}
+	}
+
 	template<typename T>
 	T InvLerp(T a, T b, T t)
 	{
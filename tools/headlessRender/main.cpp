@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <ew/headlessContext.h>
+#include <ew/external/glad.h>
+#include <ew/shader.h>
+#include <ew/model.h>
+#include <ew/camera.h>
+#include <ew/transform.h>
+#include <ew/textureCache.h>
+
+//Renders assignment 0's scene without a window, for render regressions and timing on machines without a GPU.
+//The monkey turns at a fixed step per frame, so frame N is the same image on every run.
+//Usage: headlessRender [-frames N] [-size WxH] [-every K] [-out dir] [-backend egl|osmesa] [-reference dir] [-minpsnr dB]
+//Run from bin, assets are read from bin/headlessAssets. Writes frame_NNNN.ppm every K frames and after the last
+//one, plus stats.json. With -reference, every image is compared to the one with the same name in dir and the
+//exit code is 1 if any falls below -minpsnr.
+
+typedef std::chrono::high_resolution_clock Clock;
+
+const float TIME_STEP = 1.0f / 60.0f;
+
+struct Options {
+	int numFrames = 120;
+	int width = 1080;
+	int height = 720;
+	int imageInterval = 30;
+	std::string outputDir = ".";
+	ew::HeadlessBackend backend = ew::HeadlessBackend::NONE;
+	std::string referenceDir;
+	double minPSNR = 40.0;
+};
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+	for (int i = 1; i < argc; i++)
+	{
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (value == nullptr) {
+			printf("Missing value for %s\n", argv[i]);
+			return false;
+		}
+		if (strcmp(argv[i], "-frames") == 0) {
+			options.numFrames = atoi(value);
+		}
+		else if (strcmp(argv[i], "-size") == 0) {
+			if (sscanf(value, "%dx%d", &options.width, &options.height) != 2) {
+				printf("Size should be WxH\n");
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "-every") == 0) {
+			options.imageInterval = atoi(value);
+		}
+		else if (strcmp(argv[i], "-out") == 0) {
+			options.outputDir = value;
+		}
+		else if (strcmp(argv[i], "-backend") == 0) {
+			options.backend = strcmp(value, "osmesa") == 0 ? ew::HeadlessBackend::OSMESA : ew::HeadlessBackend::EGL;
+		}
+		else if (strcmp(argv[i], "-reference") == 0) {
+			options.referenceDir = value;
+		}
+		else if (strcmp(argv[i], "-minpsnr") == 0) {
+			options.minPSNR = atof(value);
+		}
+		else {
+			printf("Unknown option %s\n", argv[i]);
+			return false;
+		}
+		i++;
+	}
+	return options.numFrames > 0 && options.width > 0 && options.height > 0;
+}
+
+//Binary PPM as written by ew::writePPM, into RGBA8
+bool readPPM(const char* filePath, std::vector<unsigned char>& rgba, int& width, int& height) {
+	FILE* file = fopen(filePath, "rb");
+	if (file == NULL) {
+		return false;
+	}
+	int maxValue = 0;
+	if (fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) != 3 || maxValue != 255 || fgetc(file) == EOF) {
+		fclose(file);
+		return false;
+	}
+	std::vector<unsigned char> rgb((size_t)width * height * 3);
+	bool read = fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+	fclose(file);
+	rgba.resize((size_t)width * height * 4);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		rgba[i * 4 + 0] = rgb[i * 3 + 0];
+		rgba[i * 4 + 1] = rgb[i * 3 + 1];
+		rgba[i * 4 + 2] = rgb[i * 3 + 2];
+		rgba[i * 4 + 3] = 255;
+	}
+	return read;
+}
+
+//Over RGB, infinite for identical images. Software and hardware rasterizers differ slightly at edges, so
+//a threshold is used rather than an exact match.
+double computePSNR(const unsigned char* a, const unsigned char* b, int numPixels) {
+	double squaredError = 0.0;
+	for (int i = 0; i < numPixels; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			double d = (double)a[i * 4 + c] - b[i * 4 + c];
+			squaredError += d * d;
+		}
+	}
+	double mse = squaredError / ((double)numPixels * 3);
+	return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+}
+
+int main(int argc, char* argv[]) {
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		printf("Usage: headlessRender [-frames N] [-size WxH] [-every K] [-out dir] [-backend egl|osmesa] [-reference dir] [-minpsnr dB]\n");
+		return 1;
+	}
+	ew::HeadlessContext context;
+	if (!context.create(options.width, options.height, options.backend)) {
+		return 1;
+	}
+
+	ew::Shader shader = ew::Shader("headlessAssets/lit.vert", "headlessAssets/lit.frag");
+	ew::Model monkeyModel = ew::Model("headlessAssets/Suzanne.obj");
+	ew::TextureHandle brickTexture = ew::getTextureCache().acquire("headlessAssets/brick_color.jpg");
+	ew::Transform monkeyTransform;
+	ew::Camera camera;
+	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
+	camera.target = glm::vec3(0.0f, 0.0f, 0.0f);
+	camera.aspectRatio = (float)options.width / options.height;
+	camera.fov = 60.0f;
+
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+	glEnable(GL_DEPTH_TEST);
+
+	GLuint query;
+	glGenQueries(1, &query);
+	std::vector<double> cpuMs(options.numFrames);
+	std::vector<double> gpuMs(options.numFrames);
+	int numImages = 0;
+	int numFailed = 0;
+	double minPSNR = INFINITY;
+
+	for (int frame = 0; frame < options.numFrames; frame++)
+	{
+		Clock::time_point start = Clock::now();
+		monkeyTransform.rotation = glm::rotate(monkeyTransform.rotation, TIME_STEP, glm::vec3(0.0f, 1.0f, 0.0f));
+
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		context.bindFramebuffer();
+		glClearColor(0.6f, 0.8f, 0.92f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, brickTexture.get());
+		shader.use();
+		shader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+		shader.setMat4("_Model", monkeyTransform.modelMatrix());
+		shader.setInt("_MainTex", 0);
+		shader.setVec3("_EyePos", camera.position);
+		shader.setFloat("_Material.Ka", 1.0f);
+		shader.setFloat("_Material.Kd", 0.5f);
+		shader.setFloat("_Material.Ks", 0.5f);
+		shader.setFloat("_Material.Shininess", 128.0f);
+		monkeyModel.draw();
+		glEndQuery(GL_TIME_ELAPSED);
+
+		//Waiting on the query every frame keeps frames from overlapping, so CPU time covers the whole frame
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+		gpuMs[frame] = ns / 1000000.0;
+		cpuMs[frame] = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		bool lastFrame = frame == options.numFrames - 1;
+		if (!lastFrame && (options.imageInterval <= 0 || frame % options.imageInterval != 0)) {
+			continue;
+		}
+		char name[32];
+		snprintf(name, sizeof(name), "frame_%04d.ppm", frame);
+		std::vector<unsigned char> pixels = context.readPixels();
+		ew::writePPM((options.outputDir + "/" + name).c_str(), pixels.data(), options.width, options.height);
+		numImages++;
+		if (!options.referenceDir.empty()) {
+			std::vector<unsigned char> reference;
+			int width, height;
+			std::string referencePath = options.referenceDir + "/" + name;
+			if (!readPPM(referencePath.c_str(), reference, width, height) || width != options.width || height != options.height) {
+				printf("%s: no matching reference image\n", name);
+				numFailed++;
+				continue;
+			}
+			double psnr = computePSNR(pixels.data(), reference.data(), width * height);
+			minPSNR = psnr < minPSNR ? psnr : minPSNR;
+			bool passed = psnr >= options.minPSNR;
+			numFailed += passed ? 0 : 1;
+			printf("%s: PSNR %.2f dB %s\n", name, psnr, passed ? "" : "FAILED");
+		}
+	}
+	glDeleteQueries(1, &query);
+
+	double cpuTotal = 0.0, gpuTotal = 0.0, cpuMax = 0.0, gpuMax = 0.0;
+	for (int i = 0; i < options.numFrames; i++)
+	{
+		cpuTotal += cpuMs[i];
+		gpuTotal += gpuMs[i];
+		cpuMax = cpuMs[i] > cpuMax ? cpuMs[i] : cpuMax;
+		gpuMax = gpuMs[i] > gpuMax ? gpuMs[i] : gpuMax;
+	}
+	printf("%d frames at %dx%d, CPU %.3f ms avg, GPU %.3f ms avg, %d images\n",
+		options.numFrames, options.width, options.height, cpuTotal / options.numFrames, gpuTotal / options.numFrames, numImages);
+
+	std::string statsPath = options.outputDir + "/stats.json";
+	FILE* file = fopen(statsPath.c_str(), "w");
+	if (file == NULL) {
+		printf("Failed to open %s for writing\n", statsPath.c_str());
+		return 1;
+	}
+	fprintf(file, "{\n");
+	fprintf(file, "  \"backend\": \"%s\",\n", ew::getHeadlessBackendName(context.getBackend()));
+	fprintf(file, "  \"renderer\": \"%s\",\n", (const char*)glGetString(GL_RENDERER));
+	fprintf(file, "  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %d,\n", options.width, options.height, options.numFrames);
+	fprintf(file, "  \"cpuMsAvg\": %.4f,\n  \"cpuMsMax\": %.4f,\n", cpuTotal / options.numFrames, cpuMax);
+	fprintf(file, "  \"gpuMsAvg\": %.4f,\n  \"gpuMsMax\": %.4f,\n", gpuTotal / options.numFrames, gpuMax);
+	if (!options.referenceDir.empty()) {
+		fprintf(file, "  \"minPSNR\": %.2f,\n  \"failedImages\": %d,\n", isinf(minPSNR) ? 999.0 : minPSNR, numFailed);
+	}
+	fprintf(file, "  \"cpuMs\": [");
+	for (int i = 0; i < options.numFrames; i++)
+	{
+		fprintf(file, "%s%.4f", i > 0 ? ", " : "", cpuMs[i]);
+	}
+	fprintf(file, "],\n  \"gpuMs\": [");
+	for (int i = 0; i < options.numFrames; i++)
+	{
+		fprintf(file, "%s%.4f", i > 0 ? ", " : "", gpuMs[i]);
+	}
+	fprintf(file, "]\n}\n");
+	fclose(file);
+	return numFailed > 0 ? 1 : 0;
+}
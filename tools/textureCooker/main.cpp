@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+#include <ew/compressedTexture.h>
+#include <ew/external/stb_image.h>
+
+//Compresses an image into an .ewtx file with a full mip chain, so the app uploads blocks directly instead of decoding and mipmapping at startup.
+//Usage: textureCooker input.jpg output.ewtx [bc1|bc3|bc5|bc7] [--linear]
+//--linear is for normal and data maps, their mips average the stored values instead of linear light. BC5 always does.
+
+typedef std::chrono::high_resolution_clock Clock;
+
+bool parseFormat(const char* name, ew::BlockFormat& format) {
+	const ew::BlockFormat formats[4] = { ew::BlockFormat::BC1, ew::BlockFormat::BC3, ew::BlockFormat::BC5, ew::BlockFormat::BC7 };
+	for (ew::BlockFormat f : formats)
+	{
+		const char* formatName = ew::getBlockFormatName(f);
+		bool match = strlen(name) == strlen(formatName);
+		for (int i = 0; match && name[i]; i++)
+		{
+			match = (name[i] | 0x20) == (formatName[i] | 0x20);
+		}
+		if (match) {
+			format = f;
+			return true;
+		}
+	}
+	return false;
+}
+
+//Peak signal to noise ratio of the top level over the channels the format stores
+double computePSNR(const unsigned char* original, const std::vector<unsigned char>& decoded, int numTexels, ew::BlockFormat format) {
+	int numChannels = format == ew::BlockFormat::BC5 ? 2 : (format == ew::BlockFormat::BC1 ? 3 : 4);
+	double squaredError = 0.0;
+	for (int i = 0; i < numTexels; i++)
+	{
+		for (int c = 0; c < numChannels; c++)
+		{
+			double d = (double)original[i * 4 + c] - decoded[i * 4 + c];
+			squaredError += d * d;
+		}
+	}
+	double mse = squaredError / ((double)numTexels * numChannels);
+	return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		printf("Usage: textureCooker input output.ewtx [bc1|bc3|bc5|bc7] [--linear]\n");
+		return 1;
+	}
+	ew::BlockFormat format = ew::BlockFormat::BC7;
+	bool srgb = true;
+	for (int i = 3; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--linear") == 0) {
+			srgb = false;
+		}
+		else if (!parseFormat(argv[i], format)) {
+			printf("Unknown format %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	//Flipped like ew::loadTexture so UVs match
+	stbi_set_flip_vertically_on_load(true);
+	int width, height, numComponents;
+	unsigned char* rgba = stbi_load(argv[1], &width, &height, &numComponents, 4);
+	if (rgba == NULL) {
+		printf("Failed to load image %s\n", argv[1]);
+		return 1;
+	}
+
+	Clock::time_point start = Clock::now();
+	ew::CompressedImage image = ew::cookTexture(rgba, width, height, format, srgb);
+	double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::vector<unsigned char> decoded = ew::decompressImage(image.levels[0].data.data(), width, height, format);
+	double psnr = computePSNR(rgba, decoded, width * height, format);
+	stbi_image_free(rgba);
+
+	if (!ew::writeCompressedTexture(argv[2], image)) {
+		return 1;
+	}
+	//Uncompressed size includes a full mip chain, roughly 4/3 of the top level
+	double uncompressedMB = width * height * 4 * (4.0 / 3.0) / (1024.0 * 1024.0);
+	double compressedMB = image.getSize() / (1024.0 * 1024.0);
+	printf("%s: %dx%d %s, %d levels\n", argv[2], width, height, ew::getBlockFormatName(format), (int)image.levels.size());
+	printf("  %.2f MB -> %.2f MB (%.1fx), %.0f ms, PSNR %.2f dB\n", uncompressedMB, compressedMB, uncompressedMB / compressedMB, ms, psnr);
+	return 0;
+}